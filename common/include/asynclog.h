@@ -0,0 +1,168 @@
+/*!
+ * \ingroup common_group
+ * \file asynclog.h
+ * \brief Asynchronous standard error output
+ *
+ * Redirects the standard error output to a log file and writes the
+ * messages of the program from a background thread.
+ *
+ * Each thread copies its messages into its own ring buffer, without
+ * lock nor system call. The background thread gathers the pending
+ * messages of all rings with a single
+ * [writev(int fd, const struct iovec\* iov, int iovcnt)](https://man7.org/linux/man-pages/man2/writev.2.html)
+ * and rotates the log file once it exceeds its maximum size. The
+ * messages of a thread keep their order, the messages of different
+ * threads are never interleaved but may be reordered.
+ *
+ * The pending messages are written when the program exits and when
+ * it receives a fatal signal. The writes made directly on the
+ * standard error output still reach the log file, synchronously.
+ *
+ * \author H. Decoudras
+ * \version 1
+ */
+
+#ifndef DEF_ASYNCLOG_H
+#define DEF_ASYNCLOG_H
+
+#include <sys/types.h>
+#include <stddef.h>
+
+
+/*!
+ * \brief Size of the ring buffer of each thread, a power of two.
+ */
+#define ASYNCLOG_RING_SIZE (1 << 16)
+
+/*!
+ * \brief Maximum number of threads owning a ring buffer at the same
+ *        time, the other ones write synchronously.
+ */
+#define ASYNCLOG_MAX_RINGS 64
+
+/*!
+ * \brief Maximum length of a message formatted by asynclog_printf().
+ */
+#define ASYNCLOG_MAX_MESSAGE 1024
+
+
+/*!
+ * \struct asynclog_stats
+ * \brief Counters of the asynchronous standard error output.
+ */
+typedef struct asynclog_stats
+{
+    /*!
+     * \brief Number of messages copied into a ring buffer.
+     */
+    size_t messages;
+
+    /*!
+     * \brief Number of bytes written into the log file.
+     */
+    size_t bytes;
+
+    /*!
+     * \brief Number of writes made by the background thread.
+     */
+    size_t flushes;
+
+    /*!
+     * \brief Number of messages written synchronously, because they
+     *        did not fit in a ring buffer or no ring was available.
+     */
+    size_t direct;
+
+    /*!
+     * \brief Number of messages which waited for free space in a
+     *        full ring buffer.
+     */
+    size_t stalls;
+
+    /*!
+     * \brief Number of rotations of the log file.
+     */
+    size_t rotations;
+} AsyncLogStats;
+
+
+/*!
+ * \brief The asynclog_open() function redirects the standard error
+ *        output to a log file and starts the background thread.
+ *
+ *        The messages are appended to the log file. Once it exceeds
+ *        \p max_size bytes, `<path>` is renamed `<path>.1`,
+ *        `<path>.1` is renamed `<path>.2`, and so on up to
+ *        `<path>.<max_files>`, and a new `<path>` is created.
+ *
+ * \param path Path of the log file.
+ * \param max_size Size of the log file triggering a rotation, `0` to
+ *                 never rotate it.
+ * \param max_files Number of rotated log files kept.
+ *
+ * \return `0` in case of success, `-1` otherwise, with
+ *         [errno](https://man7.org/linux/man-pages/man3/errno.3.html)
+ *         set.
+ */
+int asynclog_open(const char* path, off_t max_size, unsigned int max_files);
+
+/*!
+ * \brief The asynclog_write() function copies a message into the
+ *        ring buffer of the calling thread.
+ *
+ *        The message is written synchronously if the log is not
+ *        open, if it is larger than a ring buffer or if no ring
+ *        buffer is available. If the ring buffer is full, the
+ *        function waits for the background thread to empty it.
+ *
+ * \param message Message to write.
+ * \param length Length of the message.
+ *
+ * \return The length of the message, or `-1` if a synchronous write
+ *         failed.
+ */
+ssize_t asynclog_write(const char* message, size_t length);
+
+/*!
+ * \brief The asynclog_printf() function formats a message, as
+ *        [printf(const char\* format, ...)](https://man7.org/linux/man-pages/man3/printf.3.html)
+ *        does, and writes it with asynclog_write().
+ *
+ *        The message is truncated to \ref ASYNCLOG_MAX_MESSAGE bytes.
+ *
+ * \param format Format of the message.
+ *
+ * \return The length of the message, or `-1` in case of error.
+ */
+int asynclog_printf(const char* format, ...)
+    __attribute__((format(printf, 1, 2)));
+
+/*!
+ * \brief The asynclog_flush() function writes the pending messages
+ *        of all ring buffers from the calling thread.
+ */
+void asynclog_flush(void);
+
+/*!
+ * \brief The asynclog_stats() function reads the counters of the
+ *        asynchronous standard error output.
+ *
+ * \param stats Counters.
+ */
+void asynclog_stats(AsyncLogStats* stats);
+
+/*!
+ * \brief The asynclog_close() function stops the background thread,
+ *        writes the pending messages and restores the standard error
+ *        output.
+ *
+ *        This function is called when the program exits.
+ *
+ * \return `0` in case of success, `-1` otherwise, with
+ *         [errno](https://man7.org/linux/man-pages/man3/errno.3.html)
+ *         set.
+ */
+int asynclog_close(void);
+
+
+#endif // DEF_ASYNCLOG_H
@@ -0,0 +1,123 @@
+/*!
+ * \ingroup common_group
+ * \file convert.h
+ * \brief Conversion of numbers into text
+ *
+ * Converts natural and rational numbers into their decimal
+ * representation, without the null terminating caracter, two
+ * digits at a time.
+ *
+ * \author H. Decoudras
+ * \version 2
+ */
+
+#ifndef DEF_CONVERT_H
+#define DEF_CONVERT_H
+
+#include <stddef.h>
+
+
+/*!
+ * \brief Maximum length of the decimal representation of a
+ *        natural number, followed by a separator.
+ */
+#define UINT_TEXT_LENGTH 11
+
+/*!
+ * \brief Maximum precision of the conversion of a rational
+ *        number, larger precisions are reduced to it so that its
+ *        representation holds on \ref DOUBLE_TEXT_LENGTH bytes.
+ */
+#define DOUBLE_MAX_FAST_PRECISION 18
+
+/*!
+ * \brief Maximum length of the decimal representation of a
+ *        rational number with a precision of \ref
+ *        DOUBLE_MAX_FAST_PRECISION, followed by a separator.
+ */
+#define DOUBLE_TEXT_LENGTH 330
+
+
+/*!
+ * \brief The uint_length() function counts the decimal digits
+ *        of a natural number without branching.
+ *
+ * \param value Natural number.
+ *
+ * \return The number of digits, from 1 to 10.
+ */
+size_t uint_length(unsigned int value);
+
+/*!
+ * \brief The uint_to_chars() function writes the decimal
+ *        representation of a natural number.
+ *
+ * \param buffer Destination of at least \ref UINT_TEXT_LENGTH
+ *               bytes.
+ * \param value Natural number to convert.
+ *
+ * \return The number of bytes written.
+ */
+size_t uint_to_chars(char* buffer, unsigned int value);
+
+/*!
+ * \brief The double_to_chars() function writes the decimal
+ *        representation of a rational number, as
+ *        [printf(const char\* format, ...)](https://man7.org/linux/man-pages/man3/printf.3.html)
+ *        does with the `%.<precision>lf` format.
+ *
+ *        The rational numbers whose integer part holds on 53 bits
+ *        are rounded exactly, to the nearest even, with integer
+ *        arithmetic. The other ones, as well as infinities and
+ *        NaN, are formatted by
+ *        [snprintf(char\* str, size_t size, const char\* format, ...)](https://man7.org/linux/man-pages/man3/printf.3.html).
+ *
+ * \param buffer Destination of at least \ref DOUBLE_TEXT_LENGTH
+ *               bytes.
+ * \param value Rational number to convert.
+ * \param precision Number of digits after the decimal point, at
+ *                  most \ref DOUBLE_MAX_FAST_PRECISION.
+ *
+ * \return The number of bytes written, at most
+ *         \ref DOUBLE_TEXT_LENGTH minus one.
+ */
+size_t double_to_chars(char* buffer, double value, unsigned int precision);
+
+/*!
+ * \brief The uints_to_text() function writes the decimal
+ *        representations of an array of natural numbers into
+ *        a contiguous buffer, each one followed by a separator.
+ *
+ * \param buffer Destination of at least \p count times
+ *               \ref UINT_TEXT_LENGTH bytes.
+ * \param values Natural numbers to convert.
+ * \param count Number of natural numbers.
+ * \param separator Caracter following each natural number.
+ *
+ * \return The number of bytes written.
+ */
+size_t uints_to_text(char* buffer, const unsigned int* values,
+                     size_t count, char separator);
+
+/*!
+ * \brief The doubles_to_text() function writes the decimal
+ *        representations of an array of rational numbers into
+ *        a contiguous buffer, each one followed by a separator.
+ *
+ * \param buffer Destination of at least \p count times
+ *               \ref DOUBLE_TEXT_LENGTH bytes.
+ * \param values Rational numbers to convert.
+ * \param count Number of rational numbers.
+ * \param precision Number of digits after the decimal point, at
+ *                  most \ref DOUBLE_MAX_FAST_PRECISION.
+ * \param separator Caracter following each rational number.
+ *
+ * \return The number of bytes written.
+ *
+ * \see double_to_chars()
+ */
+size_t doubles_to_text(char* buffer, const double* values, size_t count,
+                       unsigned int precision, char separator);
+
+
+#endif // DEF_CONVERT_H
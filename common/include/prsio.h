@@ -0,0 +1,303 @@
+/*!
+ * \ingroup common_group
+ * \file prsio.h
+ * \brief Input and output runtime
+ *
+ * Gathers the error handling and the input and output loops shared
+ * by the exercises:
+ *
+ * - exit_on_error(), formerly copied in each exercise
+ * - read_full(), write_full() and writev_full(), which resume after
+ *   short transfers and interrupted system calls
+ * - a buffered reader and a buffered writer, of configurable
+ *   capacity, which turn small reads and writes into few system
+ *   calls
+ * - optional counters of the system calls, bytes and stalls
+ *
+ * The counters are enabled by io_stats_enable(), or by setting the
+ * `PRS_IO_STATS` environment variable, in which case they are
+ * displayed on the standard error output when the program exits.
+ * The `PRS_IO_CAPACITY` environment variable sets the capacity, in
+ * bytes, of the readers and writers opened with the default one.
+ *
+ * \author H. Decoudras
+ * \version 1
+ */
+
+#ifndef DEF_PRSIO_H
+#define DEF_PRSIO_H
+
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <stddef.h>
+
+
+/*!
+ * \brief Default capacity of the readers and writers.
+ */
+#define IO_DEFAULT_CAPACITY (1 << 16)
+
+
+/*!
+ * \struct io_stats
+ * \brief Counters of the input and output runtime.
+ */
+typedef struct io_stats
+{
+    /*!
+     * \brief Number of read and write system calls.
+     */
+    size_t syscalls;
+
+    /*!
+     * \brief Number of bytes read.
+     */
+    size_t bytes_read;
+
+    /*!
+     * \brief Number of bytes written.
+     */
+    size_t bytes_written;
+
+    /*!
+     * \brief Number of system calls which were interrupted or
+     *        transferred less than requested, and were resumed.
+     */
+    size_t stalls;
+} IoStats;
+
+/*!
+ * \struct io_reader
+ * \brief Buffered reader.
+ */
+typedef struct io_reader
+{
+    /*!
+     * \brief File descriptor read.
+     */
+    int fd;
+
+    /*!
+     * \brief Buffered bytes.
+     */
+    char* buffer;
+
+    /*!
+     * \brief Size of the buffer.
+     */
+    size_t capacity;
+
+    /*!
+     * \brief Position of the first buffered byte not yet read.
+     */
+    size_t start;
+
+    /*!
+     * \brief Number of bytes of the buffer.
+     */
+    size_t end;
+} IoReader;
+
+/*!
+ * \struct io_writer
+ * \brief Buffered writer.
+ */
+typedef struct io_writer
+{
+    /*!
+     * \brief File descriptor written.
+     */
+    int fd;
+
+    /*!
+     * \brief Bytes not yet written.
+     */
+    char* buffer;
+
+    /*!
+     * \brief Size of the buffer.
+     */
+    size_t capacity;
+
+    /*!
+     * \brief Number of bytes of the buffer.
+     */
+    size_t length;
+} IoWriter;
+
+
+/*!
+ * \brief The exit_on_error() function exits the program
+ *        if the \p assertion parameter is evaluated
+ *        to `TRUE`.
+ *
+ * If the assertion is evaluated to `TRUE` and
+ * [errno](https://man7.org/linux/man-pages/man3/errno.3.html)
+ * is set, then the error number and its associated message
+ * are displayed. Otherwise, a generic message is displayed.
+ *
+ * \param assertion Assertion to be evaluated.
+ */
+void exit_on_error(int assertion);
+
+/*!
+ * \brief The read_full() function reads until \p count bytes are
+ *        read or the end of the file is reached.
+ *
+ * \param fd File descriptor.
+ * \param buffer Destination of the bytes.
+ * \param count Number of bytes to read.
+ *
+ * \return The number of bytes read, less than \p count only at
+ *         the end of the file, or `-1` in case of error.
+ */
+ssize_t read_full(int fd, void* buffer, size_t count);
+
+/*!
+ * \brief The write_full() function writes \p count bytes,
+ *        resuming after short writes.
+ *
+ * \param fd File descriptor.
+ * \param buffer Bytes to write.
+ * \param count Number of bytes to write.
+ *
+ * \return \p count, or `-1` in case of error.
+ */
+ssize_t write_full(int fd, const void* buffer, size_t count);
+
+/*!
+ * \brief The writev_full() function writes a vector of buffers,
+ *        resuming after short writes.
+ *
+ * \param fd File descriptor.
+ * \param vectors Buffers to write, modified.
+ * \param count Number of buffers.
+ *
+ * \return The number of bytes written, or `-1` in case of error.
+ */
+ssize_t writev_full(int fd, struct iovec* vectors, int count);
+
+/*!
+ * \brief The io_reader_open() function allocates the buffer of a
+ *        reader.
+ *
+ * \param reader Reader.
+ * \param fd File descriptor to read.
+ * \param capacity Size of the buffer, `0` for the default one.
+ *
+ * \return `0` in case of success, `-1` otherwise.
+ */
+int io_reader_open(IoReader* reader, int fd, size_t capacity);
+
+/*!
+ * \brief The io_reader_read() function reads until \p count bytes
+ *        are read or the end of the file is reached.
+ *
+ *        Large reads fill the destination and the buffer with a
+ *        single
+ *        [readv(int fd, const struct iovec\* iov, int iovcnt)](https://man7.org/linux/man-pages/man2/readv.2.html).
+ *
+ * \param reader Reader.
+ * \param buffer Destination of the bytes.
+ * \param count Number of bytes to read.
+ *
+ * \return The number of bytes read, less than \p count only at
+ *         the end of the file or when an error interrupts the
+ *         read, or `-1` in case of error before any byte is read.
+ */
+ssize_t io_reader_read(IoReader* reader, void* buffer, size_t count);
+
+/*!
+ * \brief The io_reader_close() function frees the buffer of a
+ *        reader, without closing its file descriptor.
+ *
+ * \param reader Reader.
+ */
+void io_reader_close(IoReader* reader);
+
+/*!
+ * \brief The io_writer_open() function allocates the buffer of a
+ *        writer.
+ *
+ * \param writer Writer.
+ * \param fd File descriptor to write.
+ * \param capacity Size of the buffer, `0` for the default one.
+ *
+ * \return `0` in case of success, `-1` otherwise.
+ */
+int io_writer_open(IoWriter* writer, int fd, size_t capacity);
+
+/*!
+ * \brief The io_writer_write() function appends bytes to a writer.
+ *
+ *        Bytes which do not fit in the buffer are written along
+ *        with it by a single
+ *        [writev(int fd, const struct iovec\* iov, int iovcnt)](https://man7.org/linux/man-pages/man2/writev.2.html).
+ *
+ * \param writer Writer.
+ * \param buffer Bytes to write.
+ * \param count Number of bytes to write.
+ *
+ * \return \p count, or `-1` in case of error.
+ */
+ssize_t io_writer_write(IoWriter* writer, const void* buffer, size_t count);
+
+/*!
+ * \brief The io_writer_reserve() function returns room for
+ *        \p count contiguous bytes in the buffer of a writer,
+ *        flushing it if needed.
+ *
+ *        The bytes are appended by io_writer_commit().
+ *
+ * \param writer Writer.
+ * \param count Number of bytes, at most the capacity.
+ *
+ * \return The room, or `NULL` in case of error.
+ */
+char* io_writer_reserve(IoWriter* writer, size_t count);
+
+/*!
+ * \brief The io_writer_commit() function appends the bytes written
+ *        in the room returned by io_writer_reserve().
+ *
+ * \param writer Writer.
+ * \param count Number of bytes written in the room.
+ */
+void io_writer_commit(IoWriter* writer, size_t count);
+
+/*!
+ * \brief The io_writer_flush() function writes the buffer of a
+ *        writer.
+ *
+ * \param writer Writer.
+ *
+ * \return `0` in case of success, `-1` otherwise.
+ */
+int io_writer_flush(IoWriter* writer);
+
+/*!
+ * \brief The io_writer_close() function flushes a writer and frees
+ *        its buffer, without closing its file descriptor.
+ *
+ * \param writer Writer.
+ *
+ * \return `0` in case of success, `-1` otherwise.
+ */
+int io_writer_close(IoWriter* writer);
+
+/*!
+ * \brief The io_stats_enable() function starts counting the system
+ *        calls, bytes and stalls of the runtime.
+ */
+void io_stats_enable(void);
+
+/*!
+ * \brief The io_stats_get() function reads the counters of the
+ *        runtime.
+ *
+ * \param stats Counters.
+ */
+void io_stats_get(IoStats* stats);
+
+
+#endif // DEF_PRSIO_H
@@ -0,0 +1,901 @@
+/*!
+ * \ingroup common_group
+ * \file asynclog.c
+ * \brief Asynchronous standard error output
+ *
+ * \author H. Decoudras
+ * \version 1
+ */
+
+#define _GNU_SOURCE
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <sched.h>
+#include <errno.h>
+#include <time.h>
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "asynclog.h"
+
+
+/*!
+ * \brief Maximum delay between two writes of the background thread,
+ *        in milliseconds.
+ */
+#define FLUSH_INTERVAL_MS 10
+
+/*!
+ * \brief Number of attempts of a signal handler to wait for the
+ *        background thread before writing the pending messages.
+ */
+#define SIGNAL_LOCK_ATTEMPTS 1000
+
+
+/*!
+ * \enum ring_state
+ * \brief States of a ring buffer.
+ */
+typedef enum ring_state
+{
+    /*!
+     * \brief The ring buffer can be claimed by a thread.
+     */
+    RING_FREE,
+
+    /*!
+     * \brief The ring buffer belongs to a running thread.
+     */
+    RING_OWNED,
+
+    /*!
+     * \brief The owner of the ring buffer has exited, the ring
+     *        buffer is freed once empty.
+     */
+    RING_RELEASED
+} RingState;
+
+/*!
+ * \struct log_ring
+ * \brief Single producer, single consumer ring buffer of messages.
+ *
+ * The owning thread is the only one to move \ref head and the
+ * background thread is the only one to move \ref tail, so that
+ * neither of them takes a lock.
+ */
+typedef struct log_ring
+{
+    /*!
+     * \brief Bytes of the messages.
+     */
+    char buffer[ASYNCLOG_RING_SIZE];
+
+    /*!
+     * \brief Number of bytes ever copied into the ring buffer.
+     */
+    size_t head __attribute__((aligned(64)));
+
+    /*!
+     * \brief Number of messages ever copied into the ring buffer.
+     */
+    size_t messages;
+
+    /*!
+     * \brief Number of messages which waited for free space.
+     */
+    size_t stalls;
+
+    /*!
+     * \brief Number of bytes ever written into the log file.
+     */
+    size_t tail __attribute__((aligned(64)));
+
+    /*!
+     * \brief State of the ring buffer.
+     */
+    int state;
+} LogRing;
+
+/*!
+ * \struct async_log
+ * \brief State of the asynchronous standard error output.
+ */
+typedef struct async_log
+{
+    /*!
+     * \brief Ring buffers of the threads.
+     */
+    LogRing rings[ASYNCLOG_MAX_RINGS];
+
+    /*!
+     * \brief Number of ring buffers ever claimed.
+     */
+    unsigned int ring_count;
+
+    /*!
+     * \brief Incremented each time the log is opened, so that threads
+     *        claim a new ring buffer.
+     */
+    unsigned int generation;
+
+    /*!
+     * \brief Whether the messages are copied into ring buffers.
+     */
+    int running;
+
+    /*!
+     * \brief Whether the background thread must stop.
+     */
+    int stop;
+
+    /*!
+     * \brief Held by the thread writing the pending messages.
+     */
+    int flush_lock;
+
+    /*!
+     * \brief Posted to wake the background thread up.
+     */
+    sem_t wakeup;
+
+    /*!
+     * \brief Background thread.
+     */
+    pthread_t flusher;
+
+    /*!
+     * \brief Duplicate of the original standard error output.
+     */
+    int saved_stderr;
+
+    /*!
+     * \brief Path of the log file.
+     */
+    char path[PATH_MAX];
+
+    /*!
+     * \brief Size of the log file triggering a rotation.
+     */
+    off_t max_size;
+
+    /*!
+     * \brief Number of rotated log files kept.
+     */
+    unsigned int max_files;
+
+    /*!
+     * \brief Current size of the log file.
+     */
+    off_t size;
+
+    /*!
+     * \brief Counters which do not belong to a ring buffer.
+     */
+    AsyncLogStats stats;
+} AsyncLog;
+
+
+/*!
+ * \brief State of the asynchronous standard error output.
+ */
+static AsyncLog async_log;
+
+/*!
+ * \brief Ring buffer of the calling thread.
+ */
+static __thread LogRing* thread_ring;
+
+/*!
+ * \brief Generation of the log in which \ref thread_ring was
+ *        claimed.
+ */
+static __thread unsigned int thread_generation;
+
+/*!
+ * \brief Key whose destructor releases the ring buffer of an exiting
+ *        thread.
+ */
+static pthread_key_t ring_key;
+
+/*!
+ * \brief Creates \ref ring_key and registers the exit handler once.
+ */
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+
+/*!
+ * \brief Signals whose default action terminates the program.
+ */
+static const int fatal_signals[] =
+{
+    SIGINT, SIGQUIT, SIGTERM, SIGABRT, SIGSEGV, SIGBUS, SIGFPE, SIGILL
+};
+
+
+/*!
+ * \brief The init() function creates \ref ring_key and registers
+ *        the exit handler.
+ */
+static void init(void);
+
+/*!
+ * \brief The release_ring() function marks the ring buffer of an
+ *        exiting thread as released.
+ *
+ * \param ring Ring buffer of the thread.
+ */
+static void release_ring(void* ring);
+
+/*!
+ * \brief The acquire_ring() function returns the ring buffer of the
+ *        calling thread, claiming a free one if needed.
+ *
+ * \return The ring buffer, or `NULL` if none is available.
+ */
+static LogRing* acquire_ring(void);
+
+/*!
+ * \brief The write_direct() function writes a message synchronously
+ *        on the standard error output.
+ *
+ * \param message Message to write.
+ * \param length Length of the message.
+ *
+ * \return The length of the message, or `-1` in case of error.
+ */
+static ssize_t write_direct(const char* message, size_t length);
+
+/*!
+ * \brief The writev_all() function writes a vector of buffers on the
+ *        standard error output, resuming after short writes.
+ *
+ *        This function is async-signal-safe.
+ *
+ * \param iov Buffers to write, modified.
+ * \param count Number of buffers.
+ *
+ * \return `0` in case of success, `-1` otherwise.
+ */
+static int writev_all(struct iovec* iov, int count);
+
+/*!
+ * \brief The drain() function writes the pending messages of all
+ *        ring buffers with a single write.
+ *
+ *        The caller must hold the flush lock. This function is
+ *        async-signal-safe when \p rotate_log is `0`.
+ *
+ * \param rotate_log Whether the log file may be rotated.
+ */
+static void drain(int rotate_log);
+
+/*!
+ * \brief The rotate() function renames the log files and creates a
+ *        new one.
+ */
+static void rotate(void);
+
+/*!
+ * \brief The lock_flush() function takes the flush lock.
+ *
+ * \param attempts Number of attempts, `0` to wait indefinitely.
+ *
+ * \return Whether the lock was taken.
+ */
+static int lock_flush(unsigned int attempts);
+
+/*!
+ * \brief The unlock_flush() function releases the flush lock.
+ */
+static void unlock_flush(void);
+
+/*!
+ * \brief The flusher_main() function is the entry point of the
+ *        background thread.
+ *
+ *        The thread writes the pending messages every
+ *        \ref FLUSH_INTERVAL_MS milliseconds, or sooner when a ring
+ *        buffer is half full.
+ *
+ * \param arg Unused.
+ *
+ * \return `NULL`.
+ */
+static void* flusher_main(void* arg);
+
+/*!
+ * \brief The handle_fatal_signal() function writes the pending
+ *        messages before the default action of a fatal signal.
+ *
+ * \param signum Number of the signal.
+ */
+static void handle_fatal_signal(int signum);
+
+/*!
+ * \brief The install_signal_handlers() function installs
+ *        handle_fatal_signal() for the fatal signals whose action is
+ *        the default one.
+ */
+static void install_signal_handlers(void);
+
+/*!
+ * \brief The exit_handler() function closes the log when the program
+ *        exits.
+ */
+static void exit_handler(void);
+
+
+int asynclog_open(const char* path, off_t max_size, unsigned int max_files)
+{
+    struct stat     st;
+    sigset_t        all;
+    sigset_t        previous;
+    int             fd;
+    int             result;
+
+    pthread_once(&init_once, init);
+
+    if (__atomic_load_n(&async_log.running, __ATOMIC_ACQUIRE) ||
+        strlen(path) + 12 > sizeof(async_log.path))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0666);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    result = fstat(fd, &st);
+    if (result < 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    /* Redirect the standard error output to the log file */
+
+    async_log.saved_stderr = dup(STDERR_FILENO);
+    if (async_log.saved_stderr < 0 || dup2(fd, STDERR_FILENO) < 0)
+    {
+        if (async_log.saved_stderr >= 0)
+        {
+            close(async_log.saved_stderr);
+        }
+        close(fd);
+        return -1;
+    }
+    close(fd);
+
+    strcpy(async_log.path, path);
+    async_log.max_size = max_size;
+    async_log.max_files = max_files;
+    async_log.size = st.st_size;
+    memset(&async_log.stats, 0, sizeof(async_log.stats));
+
+    /* Rings of a previous generation are claimed again */
+
+    for (unsigned int i = 0; i < ASYNCLOG_MAX_RINGS; ++i)
+    {
+        async_log.rings[i].head = 0;
+        async_log.rings[i].tail = 0;
+        async_log.rings[i].messages = 0;
+        async_log.rings[i].stalls = 0;
+        async_log.rings[i].state = RING_FREE;
+    }
+    async_log.ring_count = 0;
+    async_log.stop = 0;
+    __atomic_add_fetch(&async_log.generation, 1, __ATOMIC_RELEASE);
+
+    sem_init(&async_log.wakeup, 0, 0);
+
+    /* The background thread does not handle asynchronous signals */
+
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &previous);
+    result = pthread_create(&async_log.flusher, NULL, flusher_main, NULL);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    if (result != 0)
+    {
+        dup2(async_log.saved_stderr, STDERR_FILENO);
+        close(async_log.saved_stderr);
+        sem_destroy(&async_log.wakeup);
+        errno = result;
+        return -1;
+    }
+
+    install_signal_handlers();
+    __atomic_store_n(&async_log.running, 1, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+ssize_t asynclog_write(const char* message, size_t length)
+{
+    LogRing*    ring;
+    size_t      head;
+    size_t      used;
+    size_t      needed;
+    size_t      offset;
+    size_t      first;
+
+    if (!__atomic_load_n(&async_log.running, __ATOMIC_ACQUIRE))
+    {
+        return write_direct(message, length);
+    }
+
+    ring = acquire_ring();
+    if (ring == NULL)
+    {
+        __atomic_add_fetch(&async_log.stats.direct, 1, __ATOMIC_RELAXED);
+        return write_direct(message, length);
+    }
+
+    /*
+        Wait for enough free space, or for an empty ring when the
+        message is too large, so that the messages keep their order
+    */
+
+    head = ring->head;
+    needed = length > ASYNCLOG_RING_SIZE ? ASYNCLOG_RING_SIZE : length;
+    used = head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+    if (used + needed > ASYNCLOG_RING_SIZE)
+    {
+        ++ring->stalls;
+        sem_post(&async_log.wakeup);
+
+        while (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) +
+                needed > ASYNCLOG_RING_SIZE)
+        {
+            sched_yield();
+        }
+    }
+
+    if (length > ASYNCLOG_RING_SIZE)
+    {
+        __atomic_add_fetch(&async_log.stats.direct, 1, __ATOMIC_RELAXED);
+        return write_direct(message, length);
+    }
+
+    /* Copy the message, wrapping around the end of the buffer */
+
+    offset = head & (ASYNCLOG_RING_SIZE - 1);
+    first = ASYNCLOG_RING_SIZE - offset < length ?
+                ASYNCLOG_RING_SIZE - offset : length;
+
+    memcpy(&ring->buffer[offset], message, first);
+    memcpy(ring->buffer, message + first, length - first);
+
+    ++ring->messages;
+    __atomic_store_n(&ring->head, head + length, __ATOMIC_RELEASE);
+
+    /* Wake the background thread up when crossing half of the ring */
+
+    if (used < ASYNCLOG_RING_SIZE / 2 &&
+        used + length >= ASYNCLOG_RING_SIZE / 2)
+    {
+        sem_post(&async_log.wakeup);
+    }
+
+    return length;
+}
+
+int asynclog_printf(const char* format, ...)
+{
+    char    message[ASYNCLOG_MAX_MESSAGE];
+    va_list args;
+    int     length;
+
+    va_start(args, format);
+    length = vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+
+    if (length < 0)
+    {
+        return -1;
+    }
+
+    if ((size_t)length >= sizeof(message))
+    {
+        length = sizeof(message) - 1;
+    }
+
+    return asynclog_write(message, length);
+}
+
+void asynclog_flush(void)
+{
+    lock_flush(0);
+    drain(0);
+    unlock_flush();
+}
+
+void asynclog_stats(AsyncLogStats* stats)
+{
+    unsigned int count = __atomic_load_n(&async_log.ring_count,
+                                         __ATOMIC_ACQUIRE);
+
+    stats->messages = 0;
+    stats->stalls = 0;
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        stats->messages += __atomic_load_n(&async_log.rings[i].messages,
+                                           __ATOMIC_RELAXED);
+        stats->stalls += __atomic_load_n(&async_log.rings[i].stalls,
+                                         __ATOMIC_RELAXED);
+    }
+
+    stats->bytes = __atomic_load_n(&async_log.stats.bytes, __ATOMIC_RELAXED);
+    stats->flushes = __atomic_load_n(&async_log.stats.flushes,
+                                     __ATOMIC_RELAXED);
+    stats->direct = __atomic_load_n(&async_log.stats.direct,
+                                    __ATOMIC_RELAXED);
+    stats->rotations = __atomic_load_n(&async_log.stats.rotations,
+                                       __ATOMIC_RELAXED);
+}
+
+int asynclog_close(void)
+{
+    int result;
+
+    if (!__atomic_exchange_n(&async_log.running, 0, __ATOMIC_ACQ_REL))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* Stop the background thread, then write what remains */
+
+    __atomic_store_n(&async_log.stop, 1, __ATOMIC_RELEASE);
+    sem_post(&async_log.wakeup);
+    pthread_join(async_log.flusher, NULL);
+    sem_destroy(&async_log.wakeup);
+
+    asynclog_flush();
+
+    /* Restore the standard error output */
+
+    result = dup2(async_log.saved_stderr, STDERR_FILENO);
+    close(async_log.saved_stderr);
+
+    return result < 0 ? -1 : 0;
+}
+
+
+void init(void)
+{
+    pthread_key_create(&ring_key, release_ring);
+    atexit(exit_handler);
+}
+
+void release_ring(void* ring)
+{
+    if (ring == thread_ring && thread_generation ==
+        __atomic_load_n(&async_log.generation, __ATOMIC_ACQUIRE))
+    {
+        __atomic_store_n(&((LogRing*)ring)->state, RING_RELEASED,
+                         __ATOMIC_RELEASE);
+    }
+
+    thread_ring = NULL;
+}
+
+LogRing* acquire_ring(void)
+{
+    unsigned int    generation = __atomic_load_n(&async_log.generation,
+                                                 __ATOMIC_ACQUIRE);
+    unsigned int    count;
+    int             expected;
+
+    if (thread_ring != NULL && thread_generation == generation)
+    {
+        return thread_ring;
+    }
+
+    for (unsigned int i = 0; i < ASYNCLOG_MAX_RINGS; ++i)
+    {
+        expected = RING_FREE;
+        if (__atomic_compare_exchange_n(&async_log.rings[i].state, &expected,
+                                        RING_OWNED, 0, __ATOMIC_ACQUIRE,
+                                        __ATOMIC_RELAXED))
+        {
+            /* Let the background thread scan this ring */
+
+            count = __atomic_load_n(&async_log.ring_count, __ATOMIC_RELAXED);
+            while (count < i + 1 &&
+                   !__atomic_compare_exchange_n(&async_log.ring_count,
+                                                &count, i + 1, 0,
+                                                __ATOMIC_RELEASE,
+                                                __ATOMIC_RELAXED))
+            {
+            }
+
+            thread_ring = &async_log.rings[i];
+            thread_generation = generation;
+            pthread_setspecific(ring_key, thread_ring);
+
+            return thread_ring;
+        }
+    }
+
+    return NULL;
+}
+
+ssize_t write_direct(const char* message, size_t length)
+{
+    struct iovec iov = { (void*)message, length };
+
+    return writev_all(&iov, 1) < 0 ? -1 : (ssize_t)length;
+}
+
+int writev_all(struct iovec* iov, int count)
+{
+    ssize_t rw_result;
+
+    while (count > 0)
+    {
+        rw_result = writev(STDERR_FILENO, iov, count);
+        if (rw_result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (rw_result < 0)
+        {
+            return -1;
+        }
+
+        /* Skip the buffers written entirely */
+
+        while (count > 0 && (size_t)rw_result >= iov->iov_len)
+        {
+            rw_result -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+
+        if (count > 0)
+        {
+            iov->iov_base = (char*)iov->iov_base + rw_result;
+            iov->iov_len -= rw_result;
+        }
+    }
+
+    return 0;
+}
+
+void drain(int rotate_log)
+{
+    struct iovec    iov[2 * ASYNCLOG_MAX_RINGS];
+    size_t          heads[ASYNCLOG_MAX_RINGS];
+    unsigned int    count = __atomic_load_n(&async_log.ring_count,
+                                            __ATOMIC_ACQUIRE);
+    LogRing*        ring;
+    size_t          total = 0;
+    size_t          offset;
+    size_t          length;
+    int             iov_count = 0;
+    int             state;
+
+    /* Gather the published messages of every ring */
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        ring = &async_log.rings[i];
+        heads[i] = ring->tail;
+
+        state = __atomic_load_n(&ring->state, __ATOMIC_ACQUIRE);
+        if (state == RING_FREE)
+        {
+            continue;
+        }
+
+        heads[i] = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        length = heads[i] - ring->tail;
+
+        if (length == 0)
+        {
+            /* The owner has exited and everything is written */
+
+            if (state == RING_RELEASED)
+            {
+                ring->head = 0;
+                ring->tail = 0;
+                heads[i] = 0;
+                __atomic_store_n(&ring->state, RING_FREE, __ATOMIC_RELEASE);
+            }
+            continue;
+        }
+
+        offset = ring->tail & (ASYNCLOG_RING_SIZE - 1);
+
+        iov[iov_count].iov_base = &ring->buffer[offset];
+        iov[iov_count].iov_len = ASYNCLOG_RING_SIZE - offset < length ?
+                                    ASYNCLOG_RING_SIZE - offset : length;
+        length -= iov[iov_count].iov_len;
+        total += iov[iov_count].iov_len;
+        ++iov_count;
+
+        if (length > 0)
+        {
+            iov[iov_count].iov_base = ring->buffer;
+            iov[iov_count].iov_len = length;
+            total += length;
+            ++iov_count;
+        }
+    }
+
+    if (iov_count == 0)
+    {
+        return;
+    }
+
+    /* A failed write drops the messages rather than retrying forever */
+
+    writev_all(iov, iov_count);
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        if (heads[i] != async_log.rings[i].tail)
+        {
+            __atomic_store_n(&async_log.rings[i].tail, heads[i],
+                             __ATOMIC_RELEASE);
+        }
+    }
+
+    __atomic_add_fetch(&async_log.stats.bytes, total, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&async_log.stats.flushes, 1, __ATOMIC_RELAXED);
+    async_log.size += total;
+
+    if (rotate_log && async_log.max_size > 0 &&
+        async_log.size >= async_log.max_size)
+    {
+        rotate();
+    }
+}
+
+void rotate(void)
+{
+    char    from[PATH_MAX + 16];
+    char    to[PATH_MAX + 16];
+    int     fd;
+
+    for (unsigned int i = async_log.max_files; i > 1; --i)
+    {
+        snprintf(from, sizeof(from), "%s.%u", async_log.path, i - 1);
+        snprintf(to, sizeof(to), "%s.%u", async_log.path, i);
+        rename(from, to);
+    }
+
+    if (async_log.max_files > 0)
+    {
+        snprintf(to, sizeof(to), "%s.1", async_log.path);
+        rename(async_log.path, to);
+    }
+
+    /* Replace the standard error output atomically */
+
+    fd = open(async_log.path, O_WRONLY | O_CREAT | O_APPEND | O_TRUNC, 0666);
+    if (fd < 0)
+    {
+        return;
+    }
+
+    dup2(fd, STDERR_FILENO);
+    close(fd);
+
+    async_log.size = 0;
+    __atomic_add_fetch(&async_log.stats.rotations, 1, __ATOMIC_RELAXED);
+}
+
+int lock_flush(unsigned int attempts)
+{
+    for (unsigned int i = 0; attempts == 0 || i < attempts; ++i)
+    {
+        if (!__atomic_exchange_n(&async_log.flush_lock, 1, __ATOMIC_ACQUIRE))
+        {
+            return 1;
+        }
+
+        sched_yield();
+    }
+
+    return 0;
+}
+
+void unlock_flush(void)
+{
+    __atomic_store_n(&async_log.flush_lock, 0, __ATOMIC_RELEASE);
+}
+
+void* flusher_main(void* arg)
+{
+    struct timespec deadline;
+
+    (void)arg;
+
+    while (!__atomic_load_n(&async_log.stop, __ATOMIC_ACQUIRE))
+    {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += FLUSH_INTERVAL_MS * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L)
+        {
+            deadline.tv_nsec -= 1000000000L;
+            ++deadline.tv_sec;
+        }
+
+        sem_timedwait(&async_log.wakeup, &deadline);
+
+        lock_flush(0);
+        drain(1);
+        unlock_flush();
+    }
+
+    return NULL;
+}
+
+void handle_fatal_signal(int signum)
+{
+    int saved_errno = errno;
+    int locked;
+
+    /*
+        The background thread may be writing, or may be the thread
+        which received the signal: write anyway after a while
+    */
+
+    locked = lock_flush(SIGNAL_LOCK_ATTEMPTS);
+    drain(0);
+    if (locked)
+    {
+        unlock_flush();
+    }
+
+    /* The handler was reset, the default action now applies */
+
+    errno = saved_errno;
+    raise(signum);
+}
+
+void install_signal_handlers(void)
+{
+    struct sigaction act;
+    struct sigaction old;
+
+    memset(&act, 0, sizeof(act));
+    act.sa_handler = handle_fatal_signal;
+    act.sa_flags = SA_RESETHAND;
+    sigemptyset(&act.sa_mask);
+
+    for (size_t i = 0; i < sizeof(fatal_signals) / sizeof(int); ++i)
+    {
+        if (sigaction(fatal_signals[i], NULL, &old) == 0 &&
+            old.sa_handler == SIG_DFL && !(old.sa_flags & SA_SIGINFO))
+        {
+            sigaction(fatal_signals[i], &act, NULL);
+        }
+    }
+}
+
+void exit_handler(void)
+{
+    if (__atomic_load_n(&async_log.running, __ATOMIC_ACQUIRE))
+    {
+        asynclog_close();
+    }
+}
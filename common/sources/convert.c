@@ -0,0 +1,249 @@
+/*!
+ * \ingroup common_group
+ * \file convert.c
+ * \brief Conversion of numbers into text
+ *
+ * \author H. Decoudras
+ * \version 2
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "convert.h"
+
+
+/*!
+ * \brief Two-digit decimal representations of the numbers
+ *        from 0 to 99.
+ */
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/*!
+ * \brief Powers of ten representable on 64 bits.
+ */
+static const unsigned long long powers_of_ten[20] =
+{
+    1ULL,
+    10ULL,
+    100ULL,
+    1000ULL,
+    10000ULL,
+    100000ULL,
+    1000000ULL,
+    10000000ULL,
+    100000000ULL,
+    1000000000ULL,
+    10000000000ULL,
+    100000000000ULL,
+    1000000000000ULL,
+    10000000000000ULL,
+    100000000000000ULL,
+    1000000000000000ULL,
+    10000000000000000ULL,
+    100000000000000000ULL,
+    1000000000000000000ULL,
+    10000000000000000000ULL
+};
+
+
+/*!
+ * \brief The ulong_length() function counts the decimal digits
+ *        of a 64-bit natural number without branching.
+ *
+ *        The binary logarithm gives an estimate of the decimal
+ *        one (1233 / 4096 approximates log10(2)), corrected by
+ *        a single comparison.
+ *
+ * \param value Natural number.
+ *
+ * \return The number of digits, from 1 to 20.
+ */
+static size_t ulong_length(unsigned long long value);
+
+/*!
+ * \brief The ulong_to_chars_length() function writes the
+ *        \p length last decimal digits of a 64-bit natural
+ *        number, two at a time from the end.
+ *
+ * \param buffer Destination of \p length bytes.
+ * \param value Natural number to convert.
+ * \param length Number of digits to write, leading zeros
+ *               included.
+ */
+static void ulong_to_chars_length(char* buffer, unsigned long long value,
+                                  size_t length);
+
+
+size_t ulong_length(unsigned long long value)
+{
+    unsigned long long  nonzero = value | 1;
+    size_t              estimate = ((64 - __builtin_clzll(nonzero)) * 1233)
+                                        >> 12;
+
+    return estimate + 1 - (nonzero < powers_of_ten[estimate]);
+}
+
+void ulong_to_chars_length(char* buffer, unsigned long long value,
+                           size_t length)
+{
+    size_t pos = length;
+
+    while (pos >= 2)
+    {
+        pos -= 2;
+        memcpy(&buffer[pos], &digit_pairs[(value % 100) * 2], 2);
+        value /= 100;
+    }
+
+    if (pos == 1)
+    {
+        buffer[0] = '0' + value % 10;
+    }
+}
+
+size_t uint_length(unsigned int value)
+{
+    return ulong_length(value);
+}
+
+size_t uint_to_chars(char* buffer, unsigned int value)
+{
+    char    digits[UINT_TEXT_LENGTH - 1];
+    size_t  length = uint_length(value);
+
+    /* A fixed number of steps does not depend on the length */
+
+    memcpy(&digits[8], &digit_pairs[(value % 100) * 2], 2);
+    value /= 100;
+    memcpy(&digits[6], &digit_pairs[(value % 100) * 2], 2);
+    value /= 100;
+    memcpy(&digits[4], &digit_pairs[(value % 100) * 2], 2);
+    value /= 100;
+    memcpy(&digits[2], &digit_pairs[(value % 100) * 2], 2);
+    value /= 100;
+    memcpy(&digits[0], &digit_pairs[value * 2], 2);
+
+    memcpy(buffer, &digits[UINT_TEXT_LENGTH - 1 - length], length);
+
+    return length;
+}
+
+size_t double_to_chars(char* buffer, double value, unsigned int precision)
+{
+    unsigned __int128   scaled;
+    unsigned __int128   remainder;
+    unsigned __int128   half;
+    unsigned long long  mantissa;
+    unsigned long long  integer;
+    unsigned long long  fraction;
+    size_t              length = 0;
+    int                 exponent;
+    int                 shift;
+
+    /* A larger precision would not hold on DOUBLE_TEXT_LENGTH bytes */
+
+    if (precision > DOUBLE_MAX_FAST_PRECISION)
+    {
+        precision = DOUBLE_MAX_FAST_PRECISION;
+    }
+
+    if (!isfinite(value) || fabs(value) >= 0x1p53)
+    {
+        return snprintf(buffer, DOUBLE_TEXT_LENGTH, "%.*f", precision, value);
+    }
+
+    if (signbit(value))
+    {
+        buffer[length++] = '-';
+        value = -value;
+    }
+
+    /* The value is mantissa * 2^(exponent - 53) exactly */
+
+    mantissa = (unsigned long long)ldexp(frexp(value, &exponent), 53);
+    shift = 53 - exponent;
+
+    /* Scale by 10^precision and round to the nearest even */
+
+    scaled = (unsigned __int128)mantissa * powers_of_ten[precision];
+
+    if (shift <= 0)
+    {
+        scaled <<= -shift;
+    }
+    else if (shift >= 127)
+    {
+        /* Below half of the last digit */
+
+        scaled = 0;
+    }
+    else
+    {
+        remainder = scaled & (((unsigned __int128)1 << shift) - 1);
+        half = (unsigned __int128)1 << (shift - 1);
+        scaled >>= shift;
+
+        if (remainder > half || (remainder == half && (scaled & 1)))
+        {
+            ++scaled;
+        }
+    }
+
+    integer = scaled / powers_of_ten[precision];
+    fraction = scaled % powers_of_ten[precision];
+
+    /* Integer part, decimal point and zero-padded fraction */
+
+    shift = ulong_length(integer);
+    ulong_to_chars_length(&buffer[length], integer, shift);
+    length += shift;
+
+    if (precision > 0)
+    {
+        buffer[length++] = '.';
+        ulong_to_chars_length(&buffer[length], fraction, precision);
+        length += precision;
+    }
+
+    return length;
+}
+
+size_t uints_to_text(char* buffer, const unsigned int* values,
+                     size_t count, char separator)
+{
+    size_t length = 0;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        length += uint_to_chars(&buffer[length], values[i]);
+        buffer[length++] = separator;
+    }
+
+    return length;
+}
+
+size_t doubles_to_text(char* buffer, const double* values, size_t count,
+                       unsigned int precision, char separator)
+{
+    size_t length = 0;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        length += double_to_chars(&buffer[length], values[i], precision);
+        buffer[length++] = separator;
+    }
+
+    return length;
+}
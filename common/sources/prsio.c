@@ -0,0 +1,453 @@
+/*!
+ * \ingroup common_group
+ * \file prsio.c
+ * \brief Input and output runtime
+ *
+ * \author H. Decoudras
+ * \version 1
+ */
+
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "prsio.h"
+
+
+/*!
+ * \brief Whether the environment variables have been read.
+ */
+static int config_ready;
+
+/*!
+ * \brief Capacity of the readers and writers opened with the
+ *        default one.
+ */
+static size_t default_capacity = IO_DEFAULT_CAPACITY;
+
+/*!
+ * \brief Whether the counters are updated.
+ */
+static int stats_enabled;
+
+/*!
+ * \brief Counters of the runtime.
+ */
+static IoStats stats;
+
+
+/*!
+ * \brief The load_config() function reads the `PRS_IO_CAPACITY`
+ *        and `PRS_IO_STATS` environment variables once.
+ */
+static void load_config(void);
+
+/*!
+ * \brief The print_stats() function displays the counters on the
+ *        standard error output.
+ */
+static void print_stats(void);
+
+/*!
+ * \brief The count_call() function counts a system call.
+ *
+ * \param bytes_read Number of bytes read.
+ * \param bytes_written Number of bytes written.
+ * \param stalled Whether the system call had to be resumed.
+ */
+static void count_call(size_t bytes_read, size_t bytes_written,
+                       int stalled);
+
+
+void exit_on_error(int assertion)
+{
+    if (assertion)
+    {
+        if (errno)
+        {
+            fprintf(stderr, "[%d]: %s\n", errno, strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+
+        fprintf(stderr, "An error occured!\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+ssize_t read_full(int fd, void* buffer, size_t count)
+{
+    size_t  total = 0;
+    ssize_t rw_result;
+
+    load_config();
+
+    while (total < count)
+    {
+        rw_result = read(fd, (char*)buffer + total, count - total);
+        count_call(rw_result > 0 ? rw_result : 0, 0,
+                   (rw_result < 0 && errno == EINTR) ||
+                   (rw_result > 0 && (size_t)rw_result < count - total));
+
+        if (rw_result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (rw_result < 0)
+        {
+            return -1;
+        }
+
+        if (rw_result == 0)
+        {
+            break;
+        }
+
+        total += rw_result;
+    }
+
+    return total;
+}
+
+ssize_t write_full(int fd, const void* buffer, size_t count)
+{
+    struct iovec vector = { (void*)buffer, count };
+
+    return writev_full(fd, &vector, 1);
+}
+
+ssize_t writev_full(int fd, struct iovec* vectors, int count)
+{
+    size_t  total = 0;
+    size_t  remaining = 0;
+    ssize_t rw_result;
+
+    load_config();
+
+    for (int i = 0; i < count; ++i)
+    {
+        remaining += vectors[i].iov_len;
+    }
+
+    while (remaining > 0)
+    {
+        rw_result = count == 1 ?
+                        write(fd, vectors->iov_base, vectors->iov_len) :
+                        writev(fd, vectors, count);
+        count_call(0, rw_result > 0 ? rw_result : 0,
+                   (rw_result < 0 && errno == EINTR) ||
+                   (rw_result >= 0 && (size_t)rw_result < remaining));
+
+        if (rw_result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (rw_result < 0)
+        {
+            return -1;
+        }
+
+        total += rw_result;
+        remaining -= rw_result;
+
+        /* Skip the buffers written entirely */
+
+        while (count > 0 && (size_t)rw_result >= vectors->iov_len)
+        {
+            rw_result -= vectors->iov_len;
+            ++vectors;
+            --count;
+        }
+
+        if (count > 0)
+        {
+            vectors->iov_base = (char*)vectors->iov_base + rw_result;
+            vectors->iov_len -= rw_result;
+        }
+    }
+
+    return total;
+}
+
+int io_reader_open(IoReader* reader, int fd, size_t capacity)
+{
+    load_config();
+
+    reader->fd = fd;
+    reader->capacity = capacity > 0 ? capacity : default_capacity;
+    reader->start = 0;
+    reader->end = 0;
+    reader->buffer = malloc(reader->capacity);
+
+    return reader->buffer == NULL ? -1 : 0;
+}
+
+ssize_t io_reader_read(IoReader* reader, void* buffer, size_t count)
+{
+    struct iovec    vectors[2];
+    size_t          copied;
+    size_t          remaining;
+    ssize_t         rw_result;
+    int             attempts = 0;
+
+    /* Buffered bytes first */
+
+    copied = reader->end - reader->start < count ?
+                reader->end - reader->start : count;
+    memcpy(buffer, &reader->buffer[reader->start], copied);
+    reader->start += copied;
+
+    while (copied < count)
+    {
+        remaining = count - copied;
+
+        if (remaining >= reader->capacity)
+        {
+            /* Fill the destination, then the buffer, at once */
+
+            vectors[0].iov_base = (char*)buffer + copied;
+            vectors[0].iov_len = remaining;
+            vectors[1].iov_base = reader->buffer;
+            vectors[1].iov_len = reader->capacity;
+
+            rw_result = readv(reader->fd, vectors, 2);
+        }
+        else
+        {
+            rw_result = read(reader->fd, reader->buffer, reader->capacity);
+        }
+
+        count_call(rw_result > 0 ? rw_result : 0, 0, attempts++ > 0);
+
+        if (rw_result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (rw_result < 0)
+        {
+            /* The bytes already copied are no longer buffered, so
+               they are returned and the error is left to the next
+               call */
+
+            return copied > 0 ? (ssize_t)copied : -1;
+        }
+
+        if (rw_result == 0)
+        {
+            break;
+        }
+
+        if (remaining >= reader->capacity)
+        {
+            if ((size_t)rw_result <= remaining)
+            {
+                copied += rw_result;
+                reader->start = 0;
+                reader->end = 0;
+            }
+            else
+            {
+                copied = count;
+                reader->start = 0;
+                reader->end = rw_result - remaining;
+            }
+        }
+        else
+        {
+            reader->start = (size_t)rw_result < remaining ?
+                                (size_t)rw_result : remaining;
+            reader->end = rw_result;
+            memcpy((char*)buffer + copied, reader->buffer, reader->start);
+            copied += reader->start;
+        }
+    }
+
+    return copied;
+}
+
+void io_reader_close(IoReader* reader)
+{
+    free(reader->buffer);
+    reader->buffer = NULL;
+}
+
+int io_writer_open(IoWriter* writer, int fd, size_t capacity)
+{
+    load_config();
+
+    writer->fd = fd;
+    writer->capacity = capacity > 0 ? capacity : default_capacity;
+    writer->length = 0;
+    writer->buffer = malloc(writer->capacity);
+
+    return writer->buffer == NULL ? -1 : 0;
+}
+
+ssize_t io_writer_write(IoWriter* writer, const void* buffer, size_t count)
+{
+    struct iovec vectors[2];
+
+    if (count <= writer->capacity - writer->length)
+    {
+        memcpy(&writer->buffer[writer->length], buffer, count);
+        writer->length += count;
+        return count;
+    }
+
+    /* Write the buffer and the bytes which do not fit at once */
+
+    vectors[0].iov_base = writer->buffer;
+    vectors[0].iov_len = writer->length;
+    vectors[1].iov_base = (void*)buffer;
+    vectors[1].iov_len = count;
+
+    if (writev_full(writer->fd, vectors, 2) < 0)
+    {
+        return -1;
+    }
+
+    writer->length = 0;
+
+    return count;
+}
+
+char* io_writer_reserve(IoWriter* writer, size_t count)
+{
+    if (count > writer->capacity)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if (count > writer->capacity - writer->length &&
+        io_writer_flush(writer) < 0)
+    {
+        return NULL;
+    }
+
+    return &writer->buffer[writer->length];
+}
+
+void io_writer_commit(IoWriter* writer, size_t count)
+{
+    writer->length += count;
+}
+
+int io_writer_flush(IoWriter* writer)
+{
+    if (writer->length == 0)
+    {
+        return 0;
+    }
+
+    if (write_full(writer->fd, writer->buffer, writer->length) < 0)
+    {
+        return -1;
+    }
+
+    writer->length = 0;
+
+    return 0;
+}
+
+int io_writer_close(IoWriter* writer)
+{
+    int result = io_writer_flush(writer);
+
+    free(writer->buffer);
+    writer->buffer = NULL;
+
+    return result;
+}
+
+void io_stats_enable(void)
+{
+    __atomic_store_n(&stats_enabled, 1, __ATOMIC_RELAXED);
+}
+
+void io_stats_get(IoStats* counters)
+{
+    counters->syscalls = __atomic_load_n(&stats.syscalls, __ATOMIC_RELAXED);
+    counters->bytes_read = __atomic_load_n(&stats.bytes_read,
+                                           __ATOMIC_RELAXED);
+    counters->bytes_written = __atomic_load_n(&stats.bytes_written,
+                                              __ATOMIC_RELAXED);
+    counters->stalls = __atomic_load_n(&stats.stalls, __ATOMIC_RELAXED);
+}
+
+
+void load_config(void)
+{
+    const char*     value;
+    unsigned long   capacity;
+
+    if (__atomic_exchange_n(&config_ready, 1, __ATOMIC_ACQ_REL))
+    {
+        return;
+    }
+
+    value = getenv("PRS_IO_CAPACITY");
+    if (value != NULL)
+    {
+        capacity = strtoul(value, NULL, 10);
+        if (capacity > 0)
+        {
+            default_capacity = capacity;
+        }
+    }
+
+    if (getenv("PRS_IO_STATS") != NULL)
+    {
+        io_stats_enable();
+        atexit(print_stats);
+    }
+}
+
+void print_stats(void)
+{
+    IoStats counters;
+    char    message[256];
+    int     length;
+
+    io_stats_get(&counters);
+
+    length = snprintf(
+        message,
+        sizeof(message),
+        "[io] syscalls: %zu, read: %zu B, written: %zu B, stalls: %zu\n",
+        counters.syscalls,
+        counters.bytes_read,
+        counters.bytes_written,
+        counters.stalls
+    );
+
+    if (length > 0 && write(STDERR_FILENO, message, length) < 0)
+    {
+        return;
+    }
+}
+
+void count_call(size_t bytes_read, size_t bytes_written, int stalled)
+{
+    if (!__atomic_load_n(&stats_enabled, __ATOMIC_RELAXED))
+    {
+        return;
+    }
+
+    __atomic_add_fetch(&stats.syscalls, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&stats.bytes_read, bytes_read, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&stats.bytes_written, bytes_written,
+                       __ATOMIC_RELAXED);
+
+    if (stalled)
+    {
+        __atomic_add_fetch(&stats.stalls, 1, __ATOMIC_RELAXED);
+    }
+}
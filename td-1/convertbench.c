@@ -0,0 +1,319 @@
+/*!
+ * \ingroup td_1_group
+ * \file convertbench.c
+ * \brief Exercise 1.2
+ *
+ * Measures the conversion of natural and rational numbers into
+ * text with the digit loop of `readuint`, with
+ * [snprintf(char\* str, size_t size, const char\* format, ...)](https://man7.org/linux/man-pages/man3/printf.3.html)
+ * and with the conversion library.
+ *
+ * Each conversion fills a contiguous buffer with the numbers
+ * followed by a line feed. The outputs of all conversions are
+ * compared before their durations are displayed.
+ *
+ * \author H. Decoudras
+ * \version 1
+ */
+
+#include <errno.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+#include "convert.h"
+#include "prsio.h"
+
+
+/*!
+ * \brief Default number of converted numbers.
+ */
+#define DEFAULT_COUNT 10000000
+
+/*!
+ * \brief Number of digits displayed after the decimal point.
+ */
+#define PRECISION 10
+
+
+/*!
+ * \brief The use() function displays how to use the
+ *        program.
+ *
+ *        This function always exits the program.
+ *
+ * \param program Name of the program.
+ */
+static void use(const char* program);
+
+/*!
+ * \brief The exit_on_argv_error() function exits the
+ *        program if the provided arguments are not
+ *        valid.
+ *
+ *        This function calls the use() one.
+ *
+ * \param argc Number of arguments of the program.
+ * \param argv Arguments of the program.
+ *
+ * \see use()
+ */
+static void exit_on_argv_error(int argc, char** argv);
+
+/*!
+ * \brief The uint_to_string() function converts a natural
+ *        number into a string representation.
+ *
+ *        This is the digit loop formerly used by `readuint`
+ *        and `printuintgen`: the string representation of the
+ *        natural number is stored in the \p buffer parameter
+ *        and is inverted.
+ *
+ * \param buffer String representation of the natural number.
+ * \param value Natural number to convert.
+ *
+ * \return The length of the string, including the null
+ *         terminating caracter.
+ */
+static size_t uint_to_string(char* buffer, unsigned int value);
+
+/*!
+ * \brief The now() function reads the monotonic clock.
+ *
+ * \return The current time in seconds.
+ */
+static double now(void);
+
+/*!
+ * \brief The report() function displays the duration of a
+ *        conversion and checks its output.
+ *
+ * \param name Name of the conversion.
+ * \param seconds Duration of the conversion.
+ * \param count Number of converted numbers.
+ * \param output Output of the conversion.
+ * \param length Length of the output.
+ * \param expected Output of the reference conversion.
+ * \param expected_length Length of the reference output.
+ */
+static void report(const char* name, double seconds, size_t count,
+                   const char* output, size_t length,
+                   const char* expected, size_t expected_length);
+
+
+/*!
+ * \brief Main entry point of the program.
+ *
+ * Measures the conversion of natural and rational numbers into
+ * text.
+ *
+ * \param argc Number of arguments of the program.
+ * \param argv Arguments of the program.
+ *
+ * \return The following values can be returned:
+ *          - [EXIT_SUCCESS](https://man7.org/linux/man-pages/man3/exit.3.html)
+ *            in case of success
+ *          - [EXIT_FAILURE](https://man7.org/linux/man-pages/man3/exit.3.html)
+ *            in case of error
+ */
+int main(int argc, char** argv)
+{
+    exit_on_argv_error(argc, argv);
+
+    size_t          count = argc == 2 ?
+                                strtoul(argv[1], NULL, 10) : DEFAULT_COUNT;
+    unsigned int*   uints;
+    double*         doubles;
+    char*           expected;
+    char*           output;
+    char            value_string[64];
+    size_t          expected_length;
+    size_t          length;
+    size_t          pos;
+    double          start;
+
+    uints = malloc(count * sizeof(unsigned int));
+    exit_on_error(uints == NULL);
+
+    doubles = malloc(count * sizeof(double));
+    exit_on_error(doubles == NULL);
+
+    expected = malloc(count * DOUBLE_TEXT_LENGTH);
+    exit_on_error(expected == NULL);
+
+    output = malloc(count * DOUBLE_TEXT_LENGTH);
+    exit_on_error(output == NULL);
+
+    /* Touch the buffers so that page faults are not measured */
+
+    memset(expected, 0, count * DOUBLE_TEXT_LENGTH);
+    memset(output, 0, count * DOUBLE_TEXT_LENGTH);
+
+    /* Numbers of every length */
+
+    srand(0);
+    for (size_t i = 0; i < count; ++i)
+    {
+        uints[i] = ((unsigned int)rand() << 1 ^ rand()) >> (rand() % 32);
+        doubles[i] = ((double)rand() - RAND_MAX / 2) /
+                     (double)(1 << (rand() % 24));
+    }
+
+    /* Natural numbers */
+
+    fprintf(stdout, "Natural numbers: [%zu]\n", count);
+
+    start = now();
+    expected_length = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        expected_length += snprintf(&expected[expected_length],
+                                    UINT_TEXT_LENGTH + 1, "%u\n", uints[i]);
+    }
+    report("snprintf", now() - start, count, expected, expected_length,
+           expected, expected_length);
+
+    start = now();
+    length = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        pos = uint_to_string(value_string, uints[i]);
+        while (pos)
+        {
+            output[length++] = value_string[pos--];
+        }
+    }
+    report("digit loop", now() - start, count, output, length,
+           expected, expected_length);
+
+    start = now();
+    length = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        length += uint_to_chars(&output[length], uints[i]);
+        output[length++] = '\n';
+    }
+    report("uint_to_chars", now() - start, count, output, length,
+           expected, expected_length);
+
+    start = now();
+    length = uints_to_text(output, uints, count, '\n');
+    report("uints_to_text", now() - start, count, output, length,
+           expected, expected_length);
+
+    /* Rational numbers */
+
+    fprintf(stdout, "Rational numbers: [%zu]\n", count);
+
+    start = now();
+    expected_length = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        expected_length += snprintf(&expected[expected_length],
+                                    DOUBLE_TEXT_LENGTH, "%.*f\n",
+                                    PRECISION, doubles[i]);
+    }
+    report("snprintf", now() - start, count, expected, expected_length,
+           expected, expected_length);
+
+    start = now();
+    length = doubles_to_text(output, doubles, count, PRECISION, '\n');
+    report("doubles_to_text", now() - start, count, output, length,
+           expected, expected_length);
+
+    free(uints);
+    free(doubles);
+    free(expected);
+    free(output);
+
+    return EXIT_SUCCESS;
+}
+
+
+void use(const char* program)
+{
+    fprintf(stderr, "Use:\n  %s [<count>]\n", program);
+    exit(EXIT_FAILURE);
+}
+
+void exit_on_argv_error(int argc, char** argv)
+{
+    if (argc > 2)
+    {
+        use(argv[0]);
+    }
+
+    if (argc == 2)
+    {
+        size_t len = strlen(argv[1]);
+        for (size_t i = 0; i < len; ++i)
+        {
+            if (!isdigit(argv[1][i]))
+            {
+                use(argv[0]);
+            }
+        }
+
+        if (len == 0 || strtoul(argv[1], NULL, 10) == 0)
+        {
+            use(argv[0]);
+        }
+    }
+}
+
+size_t uint_to_string(char* buffer, unsigned int value)
+{
+    unsigned int    digit;
+    size_t          count = 2;
+    buffer[0]       = '\0';
+    buffer[1]       = '\n';
+    while (value)
+    {
+        digit = value % 0xA;
+        buffer[count] = '0' + digit;
+        value /= 0xA;
+        ++count;
+    }
+
+    if (count == 2)
+    {
+        buffer[2] = '0';
+    }
+    else
+    {
+        --count;
+    }
+
+    return count;
+}
+
+double now(void)
+{
+    struct timespec time;
+    int             result;
+
+    result = clock_gettime(CLOCK_MONOTONIC, &time);
+    exit_on_error(result < 0);
+
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+void report(const char* name, double seconds, size_t count,
+            const char* output, size_t length,
+            const char* expected, size_t expected_length)
+{
+    int identical = length == expected_length &&
+                    memcmp(output, expected, length) == 0;
+
+    fprintf(
+        stdout,
+        "  %-16s [%7.2f ns/number] [%8.2f MB/s] [%s]\n",
+        name,
+        seconds * 1e9 / count,
+        seconds > 0 ? length / seconds / 1e6 : 0.0,
+        identical ? "identical" : "DIFFERENT"
+    );
+}
@@ -12,19 +12,157 @@
  * - [write(int fd, const void\* buf, size_t count)](https://man7.org/linux/man-pages/man2/write.2.html)
  * - [close(int fd)](https://man7.org/linux/man-pages/man2/close.2.html)
  *
+ * The `engine` copy mode relies on the following system calls:
+ *
+ * - [copy_file_range(int fd_in, off64_t\* off_in, int fd_out, off64_t\* off_out, size_t len, unsigned int flags)](https://man7.org/linux/man-pages/man2/copy_file_range.2.html)
+ * - [sendfile(int out_fd, int in_fd, off_t\* offset, size_t count)](https://man7.org/linux/man-pages/man2/sendfile.2.html)
+ * - [splice(int fd_in, off64_t\* off_in, int fd_out, off64_t\* off_out, size_t len, unsigned int flags)](https://man7.org/linux/man-pages/man2/splice.2.html)
+ *
+ * The `uring` copy mode relies on the following system calls:
+ *
+ * - [io_uring_setup(u32 entries, struct io_uring_params\* p)](https://man7.org/linux/man-pages/man2/io_uring_setup.2.html)
+ * - [io_uring_register(unsigned int fd, unsigned int opcode, void\* arg, unsigned int nr_args)](https://man7.org/linux/man-pages/man2/io_uring_register.2.html)
+ * - [io_uring_enter(unsigned int fd, unsigned int to_submit, unsigned int min_complete, unsigned int flags, sigset_t\* sig)](https://man7.org/linux/man-pages/man2/io_uring_enter.2.html)
+ *
+ * The `threads` copy mode relies on the following functions:
+ *
+ * - [pthread_create(pthread_t\* thread, const pthread_attr_t\* attr, void\* (\*start_routine)(void\*), void\* arg](https://man7.org/linux/man-pages/man3/pthread_create.3.html)
+ * - [pthread_join(pthread_t thread, void\*\* retval)](https://man7.org/linux/man-pages/man3/pthread_join.3.html)
+ *
+ * The `sparse` copy mode relies on the following system calls:
+ *
+ * - [lseek(int fd, off_t offset, int whence)](https://man7.org/linux/man-pages/man2/lseek.2.html)
+ * - [ftruncate(int fd, off_t length)](https://man7.org/linux/man-pages/man2/ftruncate.2.html)
+ * - [pread(int fd, void\* buf, size_t count, off_t offset)](https://man7.org/linux/man-pages/man2/pread.2.html)
+ * - [pwrite(int fd, const void\* buf, size_t count, off_t offset)](https://man7.org/linux/man-pages/man2/pwrite.2.html)
+ *
+ * The `direct` and `dontneed` copy modes rely on the following
+ * system calls:
+ *
+ * - [fcntl(int fd, int cmd, ...)](https://man7.org/linux/man-pages/man2/fcntl.2.html)
+ * - [statx(int dirfd, const char\* pathname, int flags, unsigned int mask, struct statx\* statxbuf)](https://man7.org/linux/man-pages/man2/statx.2.html)
+ * - [sync_file_range(int fd, off64_t offset, off64_t nbytes, unsigned int flags)](https://man7.org/linux/man-pages/man2/sync_file_range.2.html)
+ * - [posix_fadvise(int fd, off_t offset, off_t len, int advice)](https://man7.org/linux/man-pages/man2/posix_fadvise.2.html)
+ *
+ * The length of the buffer is tuned when `auto` is given instead of
+ * its binary logarithm.
+ *
  * \author H. Decoudras
- * \version 1
+ * \version 2
  */
 
+#define _GNU_SOURCE
+
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/sendfile.h>
+#include <sys/sysmacros.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
 #include <errno.h>
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include <time.h>
+
+#include "prsio.h"
+
+
+/*!
+ * \brief Maximum number of bytes requested by each call
+ *        to the zero-copy system calls.
+ */
+#define ENGINE_CHUNK_SIZE (1 << 30)
+
+/*!
+ * \brief Maximum number of bytes moved through the pipe
+ *        by each call to
+ *        [splice(int fd_in, off64_t\* off_in, int fd_out, off64_t\* off_out, size_t len, unsigned int flags)](https://man7.org/linux/man-pages/man2/splice.2.html).
+ */
+#define SPLICE_CHUNK_SIZE (1 << 16)
+
+/*!
+ * \brief Default number of buffers in flight in the
+ *        `uring` and `threads` copy modes.
+ */
+#define DEFAULT_IN_FLIGHT 8
+
+/*!
+ * \brief Maximum number of buffers in flight in the
+ *        `uring` and `threads` copy modes.
+ */
+#define MAX_IN_FLIGHT 1024
+
+/*!
+ * \brief Size of a cache line, used to keep the indexes
+ *        written by different threads apart.
+ */
+#define CACHE_LINE_SIZE 64
+
+/*!
+ * \brief Default number of workers in the `sparse` copy mode.
+ */
+#define DEFAULT_WORKERS 4
+
+/*!
+ * \brief Maximum number of workers in the `sparse` copy mode.
+ */
+#define MAX_WORKERS 256
+
+/*!
+ * \brief Maximum length of a range of data copied by a worker
+ *        in the `sparse` copy mode.
+ */
+#define EXTENT_MAX_LENGTH ((off_t)1 << 26)
+
+/*!
+ * \brief Maximum binary logarithm of the length of a buffer.
+ */
+#define MAX_POWER 30
+
+/*!
+ * \brief Binary logarithm of the minimum length of a buffer
+ *        chosen without measuring the throughput.
+ */
+#define AUTO_MIN_POWER 16
+
+/*!
+ * \brief Binary logarithm of the maximum length of a buffer
+ *        probed by the auto-tuning.
+ */
+#define AUTO_MAX_POWER 24
+
+/*!
+ * \brief Minimum number of bytes copied to measure the
+ *        throughput of a buffer length.
+ */
+#define AUTO_PROBE_LENGTH ((off_t)1 << 24)
+
+/*!
+ * \brief Size of a huge page.
+ */
+#define HUGE_PAGE_SIZE ((size_t)1 << 21)
+
+/*!
+ * \brief Length given to copy_range_with_buffer() in order
+ *        to copy until the end of the input file.
+ */
+#define COPY_UNTIL_EOF ((off_t)-1)
+
+/*!
+ * \brief Number of bytes copied before being dropped from
+ *        the page cache in the `dontneed` copy mode.
+ */
+#define DONTNEED_WINDOW ((off_t)1 << 25)
 
 
 /*!
@@ -51,21 +189,6 @@ static void use(const char* program);
  */
 static void exit_on_argv_error(int argc, char** argv);
 
-/*!
- * \brief The exit_on_error() function exits the program
- *        if the \p assertion parameter is evaluated
- *        to `TRUE`.
- *
- * If the assertion is evaluated to `TRUE` and 
- * [errno](https://man7.org/linux/man-pages/man3/errno.3.html)
- * is set, then the error number and its associated message
- * are displayed. Otherwise, a generic message is displayed. 
- *
- * \param assertion Assertion to be evaluated.
- */
-static void exit_on_error(int assertion);
-
-
 /*!
  * \struct io_buffer
  * \brief The io_buffer structure represents a buffer.
@@ -86,6 +209,12 @@ struct io_buffer
      * \brief Buffer size.
      */
     size_t buff_size;
+
+    /*!
+     * \brief Determines if the bytes are backed by an
+     *        anonymous mapping of huge pages.
+     */
+    int mapped;
 };
 
 
@@ -107,6 +236,25 @@ typedef struct io_buffer IOBuffer;
  */
 static IOBuffer* new_io_buffer(size_t power);
 
+/*!
+ * \brief The new_io_buffer_with_size() functions allocates a
+ *        page-aligned buffer.
+ *
+ *        The buffer is aligned on the alignment of \ref options
+ *        when it is larger than a page, as required by direct
+ *        I/O.
+ *
+ *        When huge pages are requested and the buffer is large
+ *        enough, the bytes are mapped from the reserved huge
+ *        pages, or advised to be backed by transparent huge
+ *        pages if none is reserved.
+ *
+ * \param size Size of the buffer.
+ *
+ * \return An allocated buffer.
+ */
+static IOBuffer* new_io_buffer_with_size(size_t size);
+
 /*!
  * \brief The delete_io_buffer() function de-allocates a buffer.
  *
@@ -155,163 +303,2948 @@ static size_t get_io_buffer_size(const IOBuffer* buffer);
 
 
 /*!
- * \brief Main entry point of the program.
- *
- * Copies the content of a file to another one.
- *  
- * This program uses the following system calls:
- *
- * - [open(const char\* pathname, int flags, mode_t mode)](https://man7.org/linux/man-pages/man2/open.2.html)
- * - [read(int fd, void\* buf, size_t count)](https://man7.org/linux/man-pages/man2/read.2.html)
- * - [write(int fd, const void\* buf, size_t count)](https://man7.org/linux/man-pages/man2/write.2.html)
- * - [close(int fd)](https://man7.org/linux/man-pages/man2/close.2.html)
- *
- * \param argc Number of arguments of the program.
- * \param argv Arguments of the program.
- *
- * \return The following values can be returned:
- *          - [EXIT_SUCCESS](https://man7.org/linux/man-pages/man3/exit.3.html)
- *            in case of success
- *          - [EXIT_FAILURE](https://man7.org/linux/man-pages/man3/exit.3.html) 
- *            in case of error
+ * \enum copy_mode
+ * \brief The \ref copy_mode enumeration represents the
+ *        strategies used to copy the input file.
  */
-int main(int argc, char** argv)
+enum copy_mode
 {
-    exit_on_argv_error(argc, argv);
+    /*!
+     * \brief Copy through the \ref io_buffer structure
+     *        with a read and write loop.
+     */
+    COPY_MODE_BUFFER,
 
-    IOBuffer*   io_buffer;
-    int         fd_in;
-    int         fd_out;
-    int         result;
-    ssize_t     rw_result;
-    
-    io_buffer = new_io_buffer(strtoul(argv[3], NULL, 10));
-    fprintf(stdout, "Buffer size: [%zu]\n", get_io_buffer_size(io_buffer));
+    /*!
+     * \brief Copy with the zero-copy system calls and
+     *        fall back to the \ref io_buffer structure
+     *        when the kernel refuses them.
+     */
+    COPY_MODE_ENGINE,
 
-    /* Open the input file in read only mode */
+    /*!
+     * \brief Copy with a ring of \ref io_buffer structures
+     *        kept in flight by `io_uring` and fall back to
+     *        the read and write loop when `io_uring` is
+     *        not available.
+     */
+    COPY_MODE_URING,
 
-    fd_in = open(argv[1], O_RDONLY);
-    exit_on_error(fd_in < 0);
+    /*!
+     * \brief Copy with a reader and a writer threads
+     *        connected by a ring of \ref io_buffer
+     *        structures.
+     */
+    COPY_MODE_THREADS,
 
-    /* 
-        Open the output file in write only mode
+    /*!
+     * \brief Copy the ranges of data with a pool of workers
+     *        and preserve the holes of the input file.
+     */
+    COPY_MODE_SPARSE,
 
-        Create the file if it does not exist and trunc
-        its content
-    */
+    /*!
+     * \brief Copy with direct I/O and fall back to the
+     *        `dontneed` copy mode when it is refused.
+     */
+    COPY_MODE_DIRECT,
 
-    fd_out = open(argv[2], O_CREAT | O_WRONLY | O_TRUNC, 0666);
-    exit_on_error(fd_out < 0);
-    
-    /* Read the input file */
+    /*!
+     * \brief Copy through the \ref io_buffer structure and
+     *        drop the copied ranges from the page cache.
+     */
+    COPY_MODE_DONTNEED
+};
 
-    while ((rw_result = read(fd_in, 
-           (void*)get_io_buffer_value(io_buffer, 0),
-           get_io_buffer_size(io_buffer))) != 0)
-    {
-        exit_on_error(rw_result < 0);
 
-        set_io_buffer_read_length(io_buffer, rw_result);
-        
-        /* Write to the output file */
+/*!
+ * \brief Type definition of the \ref copy_mode enumeration.
+ *
+ * \see copy_mode
+ */
+typedef enum copy_mode CopyMode;
 
-        rw_result = write(
-            fd_out, 
-            get_io_buffer_value(io_buffer, 0),
-            get_io_buffer_read_length(io_buffer)
-        );
-        exit_on_error(rw_result < 0);
-    }
 
-    delete_io_buffer(io_buffer);
-    
-    /* Close the files */
+/*!
+ * \enum copy_path
+ * \brief The \ref copy_path enumeration represents the
+ *        path actually taken to copy the input file.
+ */
+enum copy_path
+{
+    /*!
+     * \brief User-space copy through the \ref io_buffer
+     *        structure.
+     */
+    COPY_PATH_BUFFER,
 
-    result = close(fd_in);
-    exit_on_error(result < 0);
-    
-    result = close(fd_out);
-    exit_on_error(fd_out < 0);
+    /*!
+     * \brief In-kernel copy with
+     *        [copy_file_range(int fd_in, off64_t\* off_in, int fd_out, off64_t\* off_out, size_t len, unsigned int flags)](https://man7.org/linux/man-pages/man2/copy_file_range.2.html).
+     */
+    COPY_PATH_COPY_FILE_RANGE,
 
-    return EXIT_SUCCESS;
-}
+    /*!
+     * \brief In-kernel copy with
+     *        [sendfile(int out_fd, int in_fd, off_t\* offset, size_t count)](https://man7.org/linux/man-pages/man2/sendfile.2.html).
+     */
+    COPY_PATH_SENDFILE,
 
+    /*!
+     * \brief In-kernel copy with
+     *        [splice(int fd_in, off64_t\* off_in, int fd_out, off64_t\* off_out, size_t len, unsigned int flags)](https://man7.org/linux/man-pages/man2/splice.2.html)
+     *        through a pipe.
+     */
+    COPY_PATH_SPLICE,
 
-void use(const char* program)
-{
-    fprintf(
-        stderr, 
-        "Use:\n  %s <filename_in> <filename_out> "
-        "<log2_of_buffer_length>\n",
-        program
-    );
-    exit(EXIT_FAILURE);
-}
+    /*!
+     * \brief Asynchronous copy with `io_uring`.
+     */
+    COPY_PATH_URING,
 
-void exit_on_argv_error(int argc, char** argv)
-{
-    if (argc != 4)
-    {
-        use(argv[0]);
-    }
-}
+    /*!
+     * \brief Overlapped copy with a reader and a writer
+     *        threads.
+     */
+    COPY_PATH_THREADS,
 
-void exit_on_error(int assertion)
-{
-    if (assertion)
-    {
-        if (errno) 
-        {
-            fprintf(stderr, "[%d]: %s\n", errno, strerror(errno));
-            exit(EXIT_FAILURE);
-        }
-        
-        fprintf(stderr, "An error occured!\n");
-        exit(EXIT_FAILURE);
-    }
-}
+    /*!
+     * \brief Parallel copy of the ranges of data with
+     *        positional reads and writes.
+     */
+    COPY_PATH_SPARSE,
 
-IOBuffer* new_io_buffer(size_t power)
-{
-    IOBuffer* buff = malloc(sizeof(IOBuffer));
-    exit_on_error(buff == NULL);
+    /*!
+     * \brief Copy with direct I/O.
+     */
+    COPY_PATH_DIRECT,
 
-    buff->buff_size = 1 << power;
+    /*!
+     * \brief User-space copy dropping the page cache behind it.
+     */
+    COPY_PATH_DONTNEED
+};
 
-    buff->values = malloc(buff->buff_size * sizeof(unsigned char));
-    exit_on_error(buff->values == NULL);
 
-    return buff;
-}
+/*!
+ * \brief Type definition of the \ref copy_path enumeration.
+ *
+ * \see copy_path
+ */
+typedef enum copy_path CopyPath;
 
-void delete_io_buffer(IOBuffer* buffer)
-{
-    free(buffer->values);
-    free(buffer);
-}
 
-unsigned char* get_io_buffer_value(const IOBuffer* buffer, size_t index)
+/*!
+ * \struct copy_options
+ * \brief The \ref copy_options structure represents the
+ *        options given on the command line.
+ */
+struct copy_options
 {
-    if (buffer->buff_size > index)
-    {
-        return (buffer->values + index);
-    }
+    /*!
+     * \brief Strategy used to copy the input file.
+     */
+    CopyMode mode;
 
-    return NULL;
-}
+    /*!
+     * \brief Number of buffers in flight in the `uring`
+     *        and `threads` copy modes.
+     */
+    unsigned int in_flight;
 
-ssize_t get_io_buffer_read_length(const IOBuffer* buffer) 
-{
-    return buffer->read_len;
-}
+    /*!
+     * \brief Number of workers in the `sparse` copy mode.
+     */
+    unsigned int workers;
 
-void set_io_buffer_read_length(IOBuffer* buffer, ssize_t length)
-{
-    buffer->read_len = length;
-}
+    /*!
+     * \brief Determines if the length of the buffers is tuned.
+     */
+    int auto_tune;
 
-size_t get_io_buffer_size(const IOBuffer* buffer)
-{
-    return buffer->buff_size;
-}
+    /*!
+     * \brief Determines if the buffers are backed by huge pages.
+     */
+    int huge_pages;
+
+    /*!
+     * \brief Minimum alignment of the buffers, in addition to
+     *        the size of a page.
+     */
+    size_t alignment;
+};
+
+
+/*!
+ * \brief Type definition of the \ref copy_options structure.
+ *
+ * \see copy_options
+ */
+typedef struct copy_options CopyOptions;
+
+
+/*!
+ * \brief String representation of the copy modes.
+ *
+ * \see copy_mode
+ */
+static const char* string_mode[] = {
+    "buffer",
+    "engine",
+    "uring",
+    "threads",
+    "sparse",
+    "direct",
+    "dontneed"
+};
+
+/*!
+ * \brief String representation of the copy paths.
+ *
+ * \see copy_path
+ */
+static const char* string_path[] = {
+    "read/write",
+    "copy_file_range",
+    "sendfile",
+    "splice",
+    "io_uring",
+    "reader/writer threads",
+    "sparse extents",
+    "O_DIRECT",
+    "read/write + fadvise"
+};
+
+/*!
+ * \brief Options given on the command line.
+ */
+static CopyOptions options = {
+    COPY_MODE_BUFFER,
+    DEFAULT_IN_FLIGHT,
+    DEFAULT_WORKERS,
+    0,
+    0,
+    0
+};
+
+
+/*!
+ * \brief The parse_options() function parses the options
+ *        of the program and stores them in \ref options.
+ *
+ *        This function calls the use() one if an option
+ *        is not valid.
+ *
+ * \param argc Number of arguments of the program.
+ * \param argv Arguments of the program.
+ *
+ * \see use()
+ */
+static void parse_options(int argc, char** argv);
 
+/*!
+ * \brief The is_unsupported_error() function determines
+ *        if an error number means that the kernel refuses
+ *        a zero-copy system call for the given files.
+ *
+ * \param error Error number.
+ *
+ * \return This function can return the following values:
+ *          - **0** if the error is a genuine failure
+ *          - **1** if another copy path should be tried
+ */
+static int is_unsupported_error(int error);
+
+/*!
+ * \brief The copy_with_buffer() function copies the input
+ *        file through a buffer with a read and write loop.
+ *
+ *        Partial writes are resumed until the whole buffer
+ *        is written.
+ *
+ * \param fd_in Input file descriptor.
+ * \param fd_out Output file descriptor.
+ * \param buffer An allocated buffer.
+ *
+ * \return The number of bytes copied.
+ */
+static off_t copy_with_buffer(int fd_in, int fd_out, IOBuffer* buffer);
+
+/*!
+ * \brief The copy_with_copy_file_range() function copies the
+ *        input file with
+ *        [copy_file_range(int fd_in, off64_t\* off_in, int fd_out, off64_t\* off_out, size_t len, unsigned int flags)](https://man7.org/linux/man-pages/man2/copy_file_range.2.html).
+ *
+ * \param fd_in Input file descriptor.
+ * \param fd_out Output file descriptor.
+ * \param copied Incremented by the number of bytes copied.
+ *
+ * \return This function can return the following values:
+ *          - **0** if the kernel refused the copy
+ *          - **1** if the end of the input file has been reached
+ */
+static int copy_with_copy_file_range(int fd_in, int fd_out, off_t* copied);
+
+/*!
+ * \brief The copy_with_sendfile() function copies the input
+ *        file with
+ *        [sendfile(int out_fd, int in_fd, off_t\* offset, size_t count)](https://man7.org/linux/man-pages/man2/sendfile.2.html).
+ *
+ * \param fd_in Input file descriptor.
+ * \param fd_out Output file descriptor.
+ * \param copied Incremented by the number of bytes copied.
+ *
+ * \return This function can return the following values:
+ *          - **0** if the kernel refused the copy
+ *          - **1** if the end of the input file has been reached
+ */
+static int copy_with_sendfile(int fd_in, int fd_out, off_t* copied);
+
+/*!
+ * \brief The copy_with_splice() function copies the input
+ *        file with
+ *        [splice(int fd_in, off64_t\* off_in, int fd_out, off64_t\* off_out, size_t len, unsigned int flags)](https://man7.org/linux/man-pages/man2/splice.2.html)
+ *        through a pipe.
+ *
+ *        If the output file refuses the content of the pipe,
+ *        the pipe is drained with a read and write loop
+ *        before returning.
+ *
+ * \param fd_in Input file descriptor.
+ * \param fd_out Output file descriptor.
+ * \param copied Incremented by the number of bytes copied.
+ *
+ * \return This function can return the following values:
+ *          - **0** if the kernel refused the copy
+ *          - **1** if the end of the input file has been reached
+ */
+static int copy_with_splice(int fd_in, int fd_out, off_t* copied);
+
+/*!
+ * \brief The copy_with_engine() function copies the input file
+ *        with the fastest path accepted by the kernel.
+ *
+ *        The following paths are tried in order, each one
+ *        resuming where the previous one stopped:
+ *
+ *        - copy_with_copy_file_range()
+ *        - copy_with_sendfile()
+ *        - copy_with_splice()
+ *        - copy_with_buffer()
+ *
+ * \param fd_in Input file descriptor.
+ * \param fd_out Output file descriptor.
+ * \param buffer An allocated buffer.
+ * \param copied Incremented by the number of bytes copied.
+ *
+ * \return The path that completed the copy.
+ */
+static CopyPath copy_with_engine(int fd_in, int fd_out,
+                                 IOBuffer* buffer, off_t* copied);
+
+/*!
+ * \struct uring
+ * \brief The \ref uring structure represents an `io_uring`
+ *        instance whose rings are mapped in user space.
+ */
+struct uring
+{
+    /*!
+     * \brief File descriptor of the instance.
+     */
+    int fd;
+
+    /*!
+     * \brief Head of the submission queue.
+     */
+    unsigned int* sq_head;
+
+    /*!
+     * \brief Tail of the submission queue.
+     */
+    unsigned int* sq_tail;
+
+    /*!
+     * \brief Mask applied to the indexes of the submission queue.
+     */
+    unsigned int* sq_mask;
+
+    /*!
+     * \brief Number of entries of the submission queue.
+     */
+    unsigned int* sq_entries;
+
+    /*!
+     * \brief Indexes of the submission queue entries.
+     */
+    unsigned int* sq_array;
+
+    /*!
+     * \brief Tail of the submission queue entries filled
+     *        but not yet published to the kernel.
+     */
+    unsigned int sqe_tail;
+
+    /*!
+     * \brief Submission queue entries.
+     */
+    struct io_uring_sqe* sqes;
+
+    /*!
+     * \brief Head of the completion queue.
+     */
+    unsigned int* cq_head;
+
+    /*!
+     * \brief Tail of the completion queue.
+     */
+    unsigned int* cq_tail;
+
+    /*!
+     * \brief Mask applied to the indexes of the completion queue.
+     */
+    unsigned int* cq_mask;
+
+    /*!
+     * \brief Completion queue entries.
+     */
+    struct io_uring_cqe* cqes;
+
+    /*!
+     * \brief Mapping of the submission queue.
+     */
+    void* sq_ring;
+
+    /*!
+     * \brief Size of the mapping of the submission queue.
+     */
+    size_t sq_ring_size;
+
+    /*!
+     * \brief Mapping of the completion queue.
+     */
+    void* cq_ring;
+
+    /*!
+     * \brief Size of the mapping of the completion queue.
+     */
+    size_t cq_ring_size;
+
+    /*!
+     * \brief Size of the mapping of the submission queue
+     *        entries.
+     */
+    size_t sqes_size;
+
+    /*!
+     * \brief Determines if the buffers are registered.
+     */
+    int fixed_buffers;
+
+    /*!
+     * \brief Determines if the files are registered.
+     */
+    int fixed_files;
+
+    /*!
+     * \brief Input and output file descriptors.
+     */
+    int fds[2];
+};
+
+
+/*!
+ * \brief Type definition of the \ref uring structure.
+ *
+ * \see uring
+ */
+typedef struct uring Uring;
+
+
+/*!
+ * \enum uring_slot_state
+ * \brief The \ref uring_slot_state enumeration represents
+ *        the operation pending on a slot of the ring.
+ */
+enum uring_slot_state
+{
+    /*!
+     * \brief No operation is pending.
+     */
+    SLOT_FREE,
+
+    /*!
+     * \brief The input file is being read into the slot.
+     */
+    SLOT_READING,
+
+    /*!
+     * \brief The slot is being written to the output file.
+     */
+    SLOT_WRITING
+};
+
+
+/*!
+ * \brief Type definition of the \ref uring_slot_state
+ *        enumeration.
+ *
+ * \see uring_slot_state
+ */
+typedef enum uring_slot_state UringSlotState;
+
+
+/*!
+ * \struct uring_slot
+ * \brief The \ref uring_slot structure represents a buffer
+ *        kept in flight by `io_uring`.
+ *
+ *        The read length of the buffer holds the length of
+ *        the block handled by the slot.
+ */
+struct uring_slot
+{
+    /*!
+     * \brief Buffer of the slot.
+     */
+    IOBuffer* buffer;
+
+    /*!
+     * \brief Offset of the block in both files.
+     */
+    off_t offset;
+
+    /*!
+     * \brief Number of bytes of the block already read
+     *        or written.
+     */
+    size_t done;
+
+    /*!
+     * \brief Operation pending on the slot.
+     */
+    UringSlotState state;
+};
+
+
+/*!
+ * \brief Type definition of the \ref uring_slot structure.
+ *
+ * \see uring_slot
+ */
+typedef struct uring_slot UringSlot;
+
+
+/*!
+ * \brief The uring_setup() function creates an `io_uring`
+ *        instance and maps its rings.
+ *
+ * \param ring Instance to initialize.
+ * \param entries Number of entries of the submission queue.
+ *
+ * \return This function can return the following values:
+ *          - **-1** if `io_uring` is not available,
+ *            [errno](https://man7.org/linux/man-pages/man3/errno.3.html)
+ *            is set accordingly
+ *          - **0** if the instance has been created
+ *
+ * \see uring_release()
+ */
+static int uring_setup(Uring* ring, unsigned int entries);
+
+/*!
+ * \brief The uring_release() function unmaps the rings and
+ *        closes an `io_uring` instance.
+ *
+ * \param ring Instance created by uring_setup().
+ */
+static void uring_release(Uring* ring);
+
+/*!
+ * \brief The uring_prepare_slot() function fills a submission
+ *        queue entry with the operation pending on a slot.
+ *
+ *        The operation resumes after the bytes already read
+ *        or written.
+ *
+ * \param ring An `io_uring` instance.
+ * \param slot Slot to submit.
+ * \param index Index of the slot, used as registered buffer
+ *              index and as user data.
+ */
+static void uring_prepare_slot(Uring* ring, UringSlot* slot,
+                               unsigned int index);
+
+/*!
+ * \brief The uring_assign_block() function assigns the block
+ *        starting at \p offset to a slot and marks it for
+ *        reading.
+ *
+ * \param slot Slot to assign.
+ * \param offset Offset of the block.
+ * \param file_size Size of the input file.
+ *
+ * \return The offset of the next block.
+ */
+static off_t uring_assign_block(UringSlot* slot, off_t offset,
+                                off_t file_size);
+
+/*!
+ * \brief The uring_submit_and_wait() function publishes the
+ *        filled submission queue entries and waits for at
+ *        least \p wait_nr completions.
+ *
+ * \param ring An `io_uring` instance.
+ * \param wait_nr Number of completions to wait for.
+ *
+ * \return The value returned by
+ *         [io_uring_enter(unsigned int fd, unsigned int to_submit, unsigned int min_complete, unsigned int flags, sigset_t\* sig)](https://man7.org/linux/man-pages/man2/io_uring_enter.2.html).
+ */
+static int uring_submit_and_wait(Uring* ring, unsigned int wait_nr);
+
+/*!
+ * \brief The copy_with_uring() function copies the input file
+ *        with a ring of \ref options buffers in flight.
+ *
+ *        The reads of the next blocks are overlapped with
+ *        the writes of the previous ones. Buffers and files
+ *        are registered when the kernel accepts it.
+ *
+ * \param fd_in Input file descriptor.
+ * \param fd_out Output file descriptor.
+ * \param power Binary logarithm of the length of the buffers.
+ * \param copied Incremented by the number of bytes copied.
+ *
+ * \return This function can return the following values:
+ *          - **0** if `io_uring` is not available
+ *          - **1** if the end of the input file has been reached
+ */
+static int copy_with_uring(int fd_in, int fd_out, size_t power,
+                           off_t* copied);
+
+/*!
+ * \struct io_buffer_ring
+ * \brief The \ref io_buffer_ring structure represents a
+ *        single-producer and single-consumer lock-free ring
+ *        of pre-allocated buffers.
+ *
+ *        The producer fills the buffer at \ref tail and
+ *        publishes it by incrementing \ref tail. The consumer
+ *        empties the buffer at \ref head and gives it back by
+ *        incrementing \ref head. A buffer whose read length is
+ *        null marks the end of the input file.
+ */
+struct io_buffer_ring
+{
+    /*!
+     * \brief Pre-allocated buffers.
+     */
+    IOBuffer** buffers;
+
+    /*!
+     * \brief Number of buffers.
+     */
+    size_t depth;
+
+    /*!
+     * \brief Number of buffers consumed, only written by
+     *        the consumer.
+     */
+    size_t head __attribute__((aligned(CACHE_LINE_SIZE)));
+
+    /*!
+     * \brief Number of buffers produced, only written by
+     *        the producer.
+     */
+    size_t tail __attribute__((aligned(CACHE_LINE_SIZE)));
+};
+
+
+/*!
+ * \brief Type definition of the \ref io_buffer_ring structure.
+ *
+ * \see io_buffer_ring
+ */
+typedef struct io_buffer_ring IOBufferRing;
+
+
+/*!
+ * \struct thread_pipeline
+ * \brief The \ref thread_pipeline structure represents the
+ *        state shared by the reader and the writer threads.
+ *
+ *        Each counter is only written by one thread and read
+ *        once both threads have been joined.
+ */
+struct thread_pipeline
+{
+    /*!
+     * \brief Ring connecting the reader to the writer.
+     */
+    IOBufferRing* ring;
+
+    /*!
+     * \brief Input file descriptor.
+     */
+    int fd_in;
+
+    /*!
+     * \brief Output file descriptor.
+     */
+    int fd_out;
+
+    /*!
+     * \brief Number of bytes written by the writer.
+     */
+    off_t copied;
+
+    /*!
+     * \brief Number of times the reader waited for a free
+     *        buffer.
+     */
+    unsigned long reader_stalls;
+
+    /*!
+     * \brief Number of times the writer waited for a filled
+     *        buffer.
+     */
+    unsigned long writer_stalls;
+};
+
+
+/*!
+ * \brief Type definition of the \ref thread_pipeline structure.
+ *
+ * \see thread_pipeline
+ */
+typedef struct thread_pipeline ThreadPipeline;
+
+
+/*!
+ * \brief The new_io_buffer_ring() function allocates a ring
+ *        of buffers.
+ *
+ * \param depth Number of buffers.
+ * \param power Binary logarithm of the length of the buffers.
+ *
+ * \return An allocated ring.
+ *
+ * \see new_io_buffer()
+ */
+static IOBufferRing* new_io_buffer_ring(size_t depth, size_t power);
+
+/*!
+ * \brief The delete_io_buffer_ring() function de-allocates
+ *        a ring of buffers.
+ *
+ * \param ring An allocated ring.
+ */
+static void delete_io_buffer_ring(IOBufferRing* ring);
+
+/*!
+ * \brief The reader() function fills the buffers of the ring
+ *        with the input file.
+ *
+ * \param p The \ref thread_pipeline structure.
+ *
+ * \return Always `NULL`.
+ */
+static void* reader(void* p);
+
+/*!
+ * \brief The writer() function writes the buffers of the ring
+ *        to the output file.
+ *
+ * \param p The \ref thread_pipeline structure.
+ *
+ * \return Always `NULL`.
+ */
+static void* writer(void* p);
+
+/*!
+ * \brief The copy_with_threads() function copies the input
+ *        file with a reader and a writer threads connected
+ *        by a ring of \ref options buffers.
+ *
+ *        The number of stalls of each thread is displayed
+ *        in order to size the ring.
+ *
+ * \param fd_in Input file descriptor.
+ * \param fd_out Output file descriptor.
+ * \param power Binary logarithm of the length of the buffers.
+ *
+ * \return The number of bytes copied.
+ */
+static off_t copy_with_threads(int fd_in, int fd_out, size_t power);
+
+/*!
+ * \struct extent
+ * \brief The \ref extent structure represents a range of
+ *        the input file holding data.
+ */
+struct extent
+{
+    /*!
+     * \brief Offset of the range.
+     */
+    off_t offset;
+
+    /*!
+     * \brief Length of the range.
+     */
+    off_t length;
+};
+
+
+/*!
+ * \brief Type definition of the \ref extent structure.
+ *
+ * \see extent
+ */
+typedef struct extent Extent;
+
+
+/*!
+ * \struct extent_pool
+ * \brief The \ref extent_pool structure represents the
+ *        ranges shared by the workers of the `sparse` copy
+ *        mode.
+ *
+ *        Each worker takes the next range by incrementing
+ *        \ref next atomically.
+ */
+struct extent_pool
+{
+    /*!
+     * \brief Ranges to copy.
+     */
+    Extent* extents;
+
+    /*!
+     * \brief Number of ranges.
+     */
+    size_t count;
+
+    /*!
+     * \brief Index of the next range to copy.
+     */
+    size_t next;
+
+    /*!
+     * \brief Input file descriptor.
+     */
+    int fd_in;
+
+    /*!
+     * \brief Output file descriptor.
+     */
+    int fd_out;
+
+    /*!
+     * \brief Binary logarithm of the length of the buffer
+     *        of each worker.
+     */
+    size_t power;
+
+    /*!
+     * \brief Number of bytes copied by all the workers.
+     */
+    off_t copied;
+};
+
+
+/*!
+ * \brief Type definition of the \ref extent_pool structure.
+ *
+ * \see extent_pool
+ */
+typedef struct extent_pool ExtentPool;
+
+
+/*!
+ * \brief The find_extents() function lists the ranges of the
+ *        input file holding data.
+ *
+ *        The holes are detected with
+ *        [lseek(int fd, off_t offset, int whence)](https://man7.org/linux/man-pages/man2/lseek.2.html)
+ *        and the `SEEK_DATA` and `SEEK_HOLE` values. The whole
+ *        file is considered as data if the file system does not
+ *        support them. Ranges longer than \ref EXTENT_MAX_LENGTH
+ *        are split so that they can be shared by the workers.
+ *
+ * \param fd_in Input file descriptor.
+ * \param file_size Size of the input file.
+ * \param count Number of ranges found.
+ *
+ * \return An allocated array of ranges.
+ */
+static Extent* find_extents(int fd_in, off_t file_size, size_t* count);
+
+/*!
+ * \brief The extent_worker() function copies the ranges of
+ *        the pool with
+ *        [pread(int fd, void\* buf, size_t count, off_t offset)](https://man7.org/linux/man-pages/man2/pread.2.html)
+ *        and
+ *        [pwrite(int fd, const void\* buf, size_t count, off_t offset)](https://man7.org/linux/man-pages/man2/pwrite.2.html)
+ *        until none is left.
+ *
+ * \param p The \ref extent_pool structure.
+ *
+ * \return Always `NULL`.
+ */
+static void* extent_worker(void* p);
+
+/*!
+ * \brief The copy_with_sparse() function copies the ranges
+ *        of the input file holding data with \ref options
+ *        workers and preserves its holes.
+ *
+ *        The output file is resized to the size of the input
+ *        file, so that the skipped ranges remain holes.
+ *
+ * \param fd_in Input file descriptor.
+ * \param fd_out Output file descriptor.
+ * \param power Binary logarithm of the length of the buffers.
+ * \param copied Incremented by the number of bytes copied.
+ *
+ * \return This function can return the following values:
+ *          - **0** if the input file is not a regular file
+ *          - **1** if the end of the input file has been reached
+ */
+static int copy_with_sparse(int fd_in, int fd_out, size_t power,
+                            off_t* copied);
+
+/*!
+ * \brief The probe_io_size() function probes the preferred
+ *        block size of both files and the optimal I/O size
+ *        of the device holding the input file.
+ *
+ *        The optimal I/O size is read from the `sysfs` file
+ *        system and is null when the device does not report
+ *        it.
+ *
+ * \param fd_in Input file descriptor.
+ * \param fd_out Output file descriptor.
+ * \param optimal_io_size Optimal I/O size of the device.
+ *
+ * \return The largest preferred block size of both files.
+ */
+static size_t probe_io_size(int fd_in, int fd_out,
+                            size_t* optimal_io_size);
+
+/*!
+ * \brief The probe_power() function computes the binary
+ *        logarithm of the smallest power of two greater
+ *        than or equal to \p size.
+ *
+ * \param size Size to round.
+ *
+ * \return The binary logarithm of the rounded size, bounded
+ *         by \ref MAX_POWER.
+ */
+static size_t probe_power(size_t size);
+
+/*!
+ * \brief The copy_range_with_buffer() function copies at most
+ *        \p length bytes of the input file through a buffer.
+ *
+ * \param fd_in Input file descriptor.
+ * \param fd_out Output file descriptor.
+ * \param buffer An allocated buffer.
+ * \param length Number of bytes to copy, or \ref COPY_UNTIL_EOF.
+ *
+ * \return The number of bytes copied.
+ *
+ * \see copy_with_buffer()
+ */
+static off_t copy_range_with_buffer(int fd_in, int fd_out,
+                                    IOBuffer* buffer, off_t length);
+
+/*!
+ * \brief The copy_with_auto_buffer() function copies the input
+ *        file through a buffer whose size is tuned on the
+ *        first bytes of the file.
+ *
+ *        A first probe of the input file is copied untimed, so
+ *        that the first candidate does not alone pay for the
+ *        cold start of the copy. Each candidate size, from the
+ *        preferred block size to \ref AUTO_MAX_POWER, then
+ *        copies a probe of the input file and its throughput is
+ *        displayed. The buffer is then reallocated with the
+ *        best-performing size to copy the remaining bytes. A
+ *        probe cut short by the end of the file is not
+ *        measured.
+ *
+ * \param fd_in Input file descriptor.
+ * \param fd_out Output file descriptor.
+ * \param buffer An allocated buffer, replaced by the buffer
+ *               of the chosen size.
+ *
+ * \return The number of bytes copied.
+ */
+static off_t copy_with_auto_buffer(int fd_in, int fd_out,
+                                   IOBuffer** buffer);
+
+/*!
+ * \brief The probe_direct_alignment() function computes the
+ *        alignment required by direct I/O on both files.
+ *
+ *        The alignment is read with
+ *        [statx(int dirfd, const char\* pathname, int flags, unsigned int mask, struct statx\* statxbuf)](https://man7.org/linux/man-pages/man2/statx.2.html)
+ *        when the kernel reports it. The size of a page is
+ *        used otherwise.
+ *
+ * \param fd_in Input file descriptor.
+ * \param fd_out Output file descriptor.
+ *
+ * \return The alignment of the buffers, offsets and lengths.
+ */
+static size_t probe_direct_alignment(int fd_in, int fd_out);
+
+/*!
+ * \brief The set_direct() function enables or disables direct
+ *        I/O on a file descriptor.
+ *
+ * \param fd File descriptor.
+ * \param enabled Determines if direct I/O is enabled.
+ *
+ * \return The value returned by
+ *         [fcntl(int fd, int cmd, ...)](https://man7.org/linux/man-pages/man2/fcntl.2.html).
+ */
+static int set_direct(int fd, int enabled);
+
+/*!
+ * \brief The copy_with_direct() function copies the input file
+ *        with direct I/O, bypassing the page cache.
+ *
+ *        The buffer is aligned on the logical block size. Once
+ *        a read returns a length that is not aligned, usually
+ *        the tail of the input file, direct I/O is disabled and
+ *        the remaining bytes go through the page cache.
+ *
+ * \param fd_in Input file descriptor.
+ * \param fd_out Output file descriptor.
+ * \param power Binary logarithm of the length of the buffer.
+ * \param copied Incremented by the number of bytes copied.
+ *
+ * \return This function can return the following values:
+ *          - **0** if direct I/O is refused for these files
+ *          - **1** if the end of the input file has been reached
+ */
+static int copy_with_direct(int fd_in, int fd_out, size_t power,
+                            off_t* copied);
+
+/*!
+ * \brief The copy_with_dontneed() function copies the input
+ *        file through a buffer and drops the copied ranges
+ *        from the page cache.
+ *
+ *        Every \ref DONTNEED_WINDOW bytes, the writeback of the
+ *        last window is started and the previous window is
+ *        waited for and released with
+ *        [posix_fadvise(int fd, off_t offset, off_t len, int advice)](https://man7.org/linux/man-pages/man2/posix_fadvise.2.html).
+ *
+ * \param fd_in Input file descriptor.
+ * \param fd_out Output file descriptor.
+ * \param buffer An allocated buffer.
+ *
+ * \return The number of bytes copied.
+ */
+static off_t copy_with_dontneed(int fd_in, int fd_out, IOBuffer* buffer);
+
+/*!
+ * \brief The release_window() function writes back a range of
+ *        the output file and drops it, as well as the same
+ *        range of the input file, from the page cache.
+ *
+ * \param fd_in Input file descriptor.
+ * \param fd_out Output file descriptor.
+ * \param offset Offset of the range.
+ * \param length Length of the range.
+ * \param flags Flags given to
+ *              [sync_file_range(int fd, off64_t offset, off64_t nbytes, unsigned int flags)](https://man7.org/linux/man-pages/man2/sync_file_range.2.html).
+ */
+static void release_window(int fd_in, int fd_out, off_t offset,
+                           off_t length, unsigned int flags);
+
+/*!
+ * \brief The read_page_cache_size() function reads the size of
+ *        the page cache from `/proc/meminfo`.
+ *
+ * \return The size of the page cache in kilobytes, or **-1**
+ *         if it is not available.
+ */
+static long read_page_cache_size(void);
+
+/*!
+ * \brief The elapsed_seconds() function computes the number
+ *        of seconds elapsed since \p start.
+ *
+ * \param start Start time read from the `CLOCK_MONOTONIC` clock.
+ *
+ * \return The number of seconds elapsed.
+ */
+static double elapsed_seconds(const struct timespec* start);
+
+/*!
+ * \brief The print_copy_report() function displays the path
+ *        taken and the throughput achieved by the copy.
+ *
+ * \param path Path that completed the copy.
+ * \param copied Number of bytes copied.
+ * \param seconds Duration of the copy.
+ */
+static void print_copy_report(CopyPath path, off_t copied,
+                              double seconds);
+
+
+/*!
+ * \brief Main entry point of the program.
+ *
+ * Copies the content of a file to another one.
+ *  
+ * This program uses the following system calls:
+ *
+ * - [open(const char\* pathname, int flags, mode_t mode)](https://man7.org/linux/man-pages/man2/open.2.html)
+ * - [read(int fd, void\* buf, size_t count)](https://man7.org/linux/man-pages/man2/read.2.html)
+ * - [write(int fd, const void\* buf, size_t count)](https://man7.org/linux/man-pages/man2/write.2.html)
+ * - [close(int fd)](https://man7.org/linux/man-pages/man2/close.2.html)
+ *
+ * \param argc Number of arguments of the program.
+ * \param argv Arguments of the program.
+ *
+ * \return The following values can be returned:
+ *          - [EXIT_SUCCESS](https://man7.org/linux/man-pages/man3/exit.3.html)
+ *            in case of success
+ *          - [EXIT_FAILURE](https://man7.org/linux/man-pages/man3/exit.3.html) 
+ *            in case of error
+ */
+int main(int argc, char** argv)
+{
+    exit_on_argv_error(argc, argv);
+
+    IOBuffer*       io_buffer;
+    int             fd_in;
+    int             fd_out;
+    int             result;
+    CopyPath        path;
+    off_t           copied = 0;
+    struct timespec start;
+    size_t          power;
+    size_t          block_size;
+    size_t          optimal_io_size;
+    long            cache_before;
+    long            cache_after;
+
+    /* Open the input file in read only mode */
+
+    fd_in = open(argv[optind], O_RDONLY);
+    exit_on_error(fd_in < 0);
+
+    /*
+        Open the output file in write only mode
+
+        Create the file if it does not exist and trunc
+        its content
+    */
+
+    fd_out = open(argv[optind + 1], O_CREAT | O_WRONLY | O_TRUNC, 0666);
+    exit_on_error(fd_out < 0);
+
+    /* Allocate the buffer */
+
+    if (options.auto_tune)
+    {
+        block_size = probe_io_size(fd_in, fd_out, &optimal_io_size);
+        if (optimal_io_size > block_size)
+        {
+            block_size = optimal_io_size;
+        }
+
+        power = probe_power(block_size);
+        if (power < AUTO_MIN_POWER)
+        {
+            power = AUTO_MIN_POWER;
+        }
+    }
+    else
+    {
+        power = strtoul(argv[optind + 2], NULL, 10);
+    }
+
+    io_buffer = new_io_buffer(power);
+
+    /* The size of a tuned buffer is only known once tuned */
+
+    if (!options.auto_tune || options.mode != COPY_MODE_BUFFER)
+    {
+        fprintf(stdout, "Buffer size: [%zu]\n",
+                get_io_buffer_size(io_buffer));
+    }
+
+    /* Copy the input file to the output file */
+
+    cache_before = read_page_cache_size();
+
+    result = clock_gettime(CLOCK_MONOTONIC, &start);
+    exit_on_error(result < 0);
+
+    switch (options.mode)
+    {
+        case COPY_MODE_ENGINE:
+        {
+            path = copy_with_engine(fd_in, fd_out, io_buffer, &copied);
+            break;
+        }
+
+        case COPY_MODE_URING:
+        {
+            fprintf(stdout, "Buffers in flight: [%u]\n", options.in_flight);
+
+            path = COPY_PATH_URING;
+            if (!copy_with_uring(fd_in, fd_out, power, &copied))
+            {
+                path = COPY_PATH_BUFFER;
+                copied = copy_with_buffer(fd_in, fd_out, io_buffer);
+            }
+
+            break;
+        }
+
+        case COPY_MODE_THREADS:
+        {
+            fprintf(stdout, "Ring depth: [%u]\n", options.in_flight);
+
+            path = COPY_PATH_THREADS;
+            copied = copy_with_threads(fd_in, fd_out, power);
+            break;
+        }
+
+        case COPY_MODE_SPARSE:
+        {
+            fprintf(stdout, "Workers: [%u]\n", options.workers);
+
+            path = COPY_PATH_SPARSE;
+            if (!copy_with_sparse(fd_in, fd_out, power, &copied))
+            {
+                path = COPY_PATH_BUFFER;
+                copied = copy_with_buffer(fd_in, fd_out, io_buffer);
+            }
+
+            break;
+        }
+
+        case COPY_MODE_DIRECT:
+        {
+            path = COPY_PATH_DIRECT;
+            if (!copy_with_direct(fd_in, fd_out, power, &copied))
+            {
+                path = COPY_PATH_DONTNEED;
+                copied = copy_with_dontneed(fd_in, fd_out, io_buffer);
+            }
+
+            break;
+        }
+
+        case COPY_MODE_DONTNEED:
+        {
+            path = COPY_PATH_DONTNEED;
+            copied = copy_with_dontneed(fd_in, fd_out, io_buffer);
+            break;
+        }
+
+        default:
+        {
+            path = COPY_PATH_BUFFER;
+            if (options.auto_tune)
+            {
+                copied = copy_with_auto_buffer(fd_in, fd_out, &io_buffer);
+                fprintf(stdout, "Buffer size: [%zu]\n",
+                        get_io_buffer_size(io_buffer));
+            }
+            else
+            {
+                copied = copy_with_buffer(fd_in, fd_out, io_buffer);
+            }
+
+            break;
+        }
+    }
+
+    print_copy_report(path, copied, elapsed_seconds(&start));
+
+    /* Display the page cache footprint of the copy */
+
+    cache_after = read_page_cache_size();
+    if (cache_before >= 0 && cache_after >= 0)
+    {
+        fprintf(
+            stdout,
+            "Page cache before: [%ld kB]\n"
+            "Page cache after: [%ld kB]\n",
+            cache_before,
+            cache_after
+        );
+    }
+
+    delete_io_buffer(io_buffer);
+
+    /* Close the files */
+
+    result = close(fd_in);
+    exit_on_error(result < 0);
+
+    result = close(fd_out);
+    exit_on_error(result < 0);
+
+    return EXIT_SUCCESS;
+}
+
+
+void use(const char* program)
+{
+    fprintf(
+        stderr,
+        "Use:\n  %s [-m <buffer|engine|uring|threads|sparse|direct|dontneed>] "
+        "[-n <buffers_in_flight>] [-t <workers>] [-H] "
+        "<filename_in> <filename_out> "
+        "<log2_of_buffer_length [<=%d]|auto>\n",
+        program,
+        MAX_POWER
+    );
+    exit(EXIT_FAILURE);
+}
+
+void exit_on_argv_error(int argc, char** argv)
+{
+    parse_options(argc, argv);
+
+    if (argc - optind != 3)
+    {
+        use(argv[0]);
+    }
+
+    /* The length of the buffer is tuned or given as a number */
+
+    if (strcmp(argv[optind + 2], "auto") == 0)
+    {
+        options.auto_tune = 1;
+        return;
+    }
+
+    size_t len = strlen(argv[optind + 2]);
+    for (size_t i = 0; i < len; ++i)
+    {
+        if (!isdigit(argv[optind + 2][i]))
+        {
+            use(argv[0]);
+        }
+    }
+
+    if (len == 0 || strtoul(argv[optind + 2], NULL, 10) > MAX_POWER)
+    {
+        use(argv[0]);
+    }
+}
+
+IOBuffer* new_io_buffer(size_t power)
+{
+    return new_io_buffer_with_size((size_t)1 << power);
+}
+
+IOBuffer* new_io_buffer_with_size(size_t size)
+{
+    IOBuffer*   buff = malloc(sizeof(IOBuffer));
+    size_t      alignment = sysconf(_SC_PAGESIZE);
+    int         huge_pages = options.huge_pages && size >= HUGE_PAGE_SIZE;
+    int         result;
+
+    exit_on_error(buff == NULL);
+
+    buff->buff_size = size;
+    buff->read_len = 0;
+    buff->mapped = 0;
+
+    if (huge_pages && size % HUGE_PAGE_SIZE == 0)
+    {
+        /* Huge pages must have been reserved by the administrator */
+
+        buff->values = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+                            -1, 0);
+        if (buff->values != MAP_FAILED)
+        {
+            buff->mapped = 1;
+            return buff;
+        }
+    }
+
+    if (huge_pages)
+    {
+        alignment = HUGE_PAGE_SIZE;
+    }
+
+    if (options.alignment > alignment)
+    {
+        alignment = options.alignment;
+    }
+
+    result = posix_memalign((void**)&buff->values, alignment, size);
+    errno = result;
+    exit_on_error(result != 0);
+
+    if (huge_pages)
+    {
+        /* Fall back to transparent huge pages, this is only a hint */
+
+        madvise(buff->values, size, MADV_HUGEPAGE);
+    }
+
+    return buff;
+}
+
+void delete_io_buffer(IOBuffer* buffer)
+{
+    if (buffer->mapped)
+    {
+        int result = munmap(buffer->values, buffer->buff_size);
+        exit_on_error(result < 0);
+    }
+    else
+    {
+        free(buffer->values);
+    }
+
+    free(buffer);
+}
+
+unsigned char* get_io_buffer_value(const IOBuffer* buffer, size_t index)
+{
+    if (buffer->buff_size > index)
+    {
+        return (buffer->values + index);
+    }
+
+    return NULL;
+}
+
+ssize_t get_io_buffer_read_length(const IOBuffer* buffer) 
+{
+    return buffer->read_len;
+}
+
+void set_io_buffer_read_length(IOBuffer* buffer, ssize_t length)
+{
+    buffer->read_len = length;
+}
+
+size_t get_io_buffer_size(const IOBuffer* buffer)
+{
+    return buffer->buff_size;
+}
+
+
+void parse_options(int argc, char** argv)
+{
+    int option;
+
+    while ((option = getopt(argc, argv, "m:n:t:H")) != -1)
+    {
+        switch (option)
+        {
+            case 'm':
+            {
+                if (strcmp(optarg, string_mode[COPY_MODE_BUFFER]) == 0)
+                {
+                    options.mode = COPY_MODE_BUFFER;
+                }
+                else if (strcmp(optarg,
+                         string_mode[COPY_MODE_ENGINE]) == 0)
+                {
+                    options.mode = COPY_MODE_ENGINE;
+                }
+                else if (strcmp(optarg,
+                         string_mode[COPY_MODE_URING]) == 0)
+                {
+                    options.mode = COPY_MODE_URING;
+                }
+                else if (strcmp(optarg,
+                         string_mode[COPY_MODE_THREADS]) == 0)
+                {
+                    options.mode = COPY_MODE_THREADS;
+                }
+                else if (strcmp(optarg,
+                         string_mode[COPY_MODE_SPARSE]) == 0)
+                {
+                    options.mode = COPY_MODE_SPARSE;
+                }
+                else if (strcmp(optarg,
+                         string_mode[COPY_MODE_DIRECT]) == 0)
+                {
+                    options.mode = COPY_MODE_DIRECT;
+                }
+                else if (strcmp(optarg,
+                         string_mode[COPY_MODE_DONTNEED]) == 0)
+                {
+                    options.mode = COPY_MODE_DONTNEED;
+                }
+                else
+                {
+                    use(argv[0]);
+                }
+
+                break;
+            }
+
+            case 'n':
+            {
+                options.in_flight = strtoul(optarg, NULL, 10);
+                if (options.in_flight == 0 ||
+                    options.in_flight > MAX_IN_FLIGHT)
+                {
+                    use(argv[0]);
+                }
+
+                break;
+            }
+
+            case 'H':
+            {
+                options.huge_pages = 1;
+                break;
+            }
+
+            case 't':
+            {
+                options.workers = strtoul(optarg, NULL, 10);
+                if (options.workers == 0 ||
+                    options.workers > MAX_WORKERS)
+                {
+                    use(argv[0]);
+                }
+
+                break;
+            }
+
+            default:
+            {
+                use(argv[0]);
+            }
+        }
+    }
+}
+
+int is_unsupported_error(int error)
+{
+    switch (error)
+    {
+        case ENOSYS:
+        case EXDEV:
+        case EINVAL:
+        case EOPNOTSUPP:
+        case EBADF:
+        case ESPIPE:
+        {
+            return 1;
+        }
+
+        default:
+        {
+            return 0;
+        }
+    }
+}
+
+off_t copy_with_buffer(int fd_in, int fd_out, IOBuffer* buffer)
+{
+    return copy_range_with_buffer(fd_in, fd_out, buffer, COPY_UNTIL_EOF);
+}
+
+int copy_with_copy_file_range(int fd_in, int fd_out, off_t* copied)
+{
+    struct stat st;
+    off_t       copied_here = 0;
+    int         result;
+    ssize_t     rw_result;
+
+    /* Only regular files are accepted by the kernel */
+
+    result = fstat(fd_in, &st);
+    exit_on_error(result < 0);
+
+    if (!S_ISREG(st.st_mode))
+    {
+        return 0;
+    }
+
+    while ((rw_result = copy_file_range(fd_in, NULL, fd_out, NULL,
+           ENGINE_CHUNK_SIZE, 0)) != 0)
+    {
+        if (rw_result < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            if (is_unsupported_error(errno))
+            {
+                return 0;
+            }
+
+            exit_on_error(1);
+        }
+
+        copied_here += rw_result;
+        *copied += rw_result;
+    }
+
+    /*
+        Some pseudo file systems report the end of the
+        file instead of refusing the copy
+    */
+
+    return copied_here >= st.st_size;
+}
+
+int copy_with_sendfile(int fd_in, int fd_out, off_t* copied)
+{
+    ssize_t rw_result;
+
+    while ((rw_result = sendfile(fd_out, fd_in, NULL,
+           ENGINE_CHUNK_SIZE)) != 0)
+    {
+        if (rw_result < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            if (is_unsupported_error(errno))
+            {
+                return 0;
+            }
+
+            exit_on_error(1);
+        }
+
+        *copied += rw_result;
+    }
+
+    return 1;
+}
+
+int copy_with_splice(int fd_in, int fd_out, off_t* copied)
+{
+    unsigned char   drain[4096];
+    int             fd_pipe[2];
+    int             completed = 1;
+    int             result;
+    ssize_t         in_pipe;
+    ssize_t         written;
+    ssize_t         rw_result;
+
+    result = pipe(fd_pipe);
+    exit_on_error(result < 0);
+
+    while (completed)
+    {
+        /* Move the input file into the pipe */
+
+        in_pipe = splice(fd_in, NULL, fd_pipe[1], NULL,
+                         SPLICE_CHUNK_SIZE, SPLICE_F_MOVE);
+        if (in_pipe < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            exit_on_error(!is_unsupported_error(errno));
+            completed = 0;
+            break;
+        }
+
+        if (in_pipe == 0)
+        {
+            break;
+        }
+
+        /* Move the pipe into the output file */
+
+        while (in_pipe > 0)
+        {
+            rw_result = splice(fd_pipe[0], NULL, fd_out, NULL,
+                               in_pipe, SPLICE_F_MOVE);
+            if (rw_result < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                exit_on_error(!is_unsupported_error(errno));
+                completed = 0;
+                break;
+            }
+
+            in_pipe -= rw_result;
+            *copied += rw_result;
+        }
+
+        /* Drain the pipe if the output file refused it */
+
+        while (in_pipe > 0)
+        {
+            rw_result = read(
+                fd_pipe[0],
+                drain,
+                (size_t)in_pipe < sizeof(drain) ?
+                    (size_t)in_pipe : sizeof(drain)
+            );
+            exit_on_error(rw_result <= 0);
+
+            in_pipe -= rw_result;
+            *copied += rw_result;
+
+            for (written = 0; written < rw_result; written += result)
+            {
+                result = write(fd_out, drain + written,
+                               rw_result - written);
+                exit_on_error(result < 0);
+            }
+        }
+    }
+
+    result = close(fd_pipe[0]);
+    exit_on_error(result < 0);
+
+    result = close(fd_pipe[1]);
+    exit_on_error(result < 0);
+
+    return completed;
+}
+
+CopyPath copy_with_engine(int fd_in, int fd_out,
+                          IOBuffer* buffer, off_t* copied)
+{
+    if (copy_with_copy_file_range(fd_in, fd_out, copied))
+    {
+        return COPY_PATH_COPY_FILE_RANGE;
+    }
+
+    if (copy_with_sendfile(fd_in, fd_out, copied))
+    {
+        return COPY_PATH_SENDFILE;
+    }
+
+    if (copy_with_splice(fd_in, fd_out, copied))
+    {
+        return COPY_PATH_SPLICE;
+    }
+
+    *copied += copy_with_buffer(fd_in, fd_out, buffer);
+    return COPY_PATH_BUFFER;
+}
+
+int uring_setup(Uring* ring, unsigned int entries)
+{
+    struct io_uring_params params;
+
+    memset(ring, 0, sizeof(Uring));
+    memset(&params, 0, sizeof(params));
+
+    ring->fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0)
+    {
+        return -1;
+    }
+
+    /* Map the submission and completion queues */
+
+    ring->sq_ring_size = params.sq_off.array +
+                         params.sq_entries * sizeof(unsigned int);
+    ring->cq_ring_size = params.cq_off.cqes +
+                         params.cq_entries * sizeof(struct io_uring_cqe);
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (ring->cq_ring_size > ring->sq_ring_size)
+        {
+            ring->sq_ring_size = ring->cq_ring_size;
+        }
+
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size,
+                         PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE,
+                         ring->fd, IORING_OFF_SQ_RING);
+    exit_on_error(ring->sq_ring == MAP_FAILED);
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        ring->cq_ring = ring->sq_ring;
+    }
+    else
+    {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size,
+                             PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE,
+                             ring->fd, IORING_OFF_CQ_RING);
+        exit_on_error(ring->cq_ring == MAP_FAILED);
+    }
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size,
+                      PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE,
+                      ring->fd, IORING_OFF_SQES);
+    exit_on_error(ring->sqes == MAP_FAILED);
+
+    ring->sq_head    = (unsigned int*)((char*)ring->sq_ring + params.sq_off.head);
+    ring->sq_tail    = (unsigned int*)((char*)ring->sq_ring + params.sq_off.tail);
+    ring->sq_mask    = (unsigned int*)((char*)ring->sq_ring + params.sq_off.ring_mask);
+    ring->sq_entries = (unsigned int*)((char*)ring->sq_ring + params.sq_off.ring_entries);
+    ring->sq_array   = (unsigned int*)((char*)ring->sq_ring + params.sq_off.array);
+    ring->sqe_tail   = *ring->sq_tail;
+
+    ring->cq_head    = (unsigned int*)((char*)ring->cq_ring + params.cq_off.head);
+    ring->cq_tail    = (unsigned int*)((char*)ring->cq_ring + params.cq_off.tail);
+    ring->cq_mask    = (unsigned int*)((char*)ring->cq_ring + params.cq_off.ring_mask);
+    ring->cqes       = (struct io_uring_cqe*)((char*)ring->cq_ring + params.cq_off.cqes);
+
+    return 0;
+}
+
+void uring_release(Uring* ring)
+{
+    int result;
+
+    result = munmap(ring->sqes, ring->sqes_size);
+    exit_on_error(result < 0);
+
+    if (ring->cq_ring != ring->sq_ring)
+    {
+        result = munmap(ring->cq_ring, ring->cq_ring_size);
+        exit_on_error(result < 0);
+    }
+
+    result = munmap(ring->sq_ring, ring->sq_ring_size);
+    exit_on_error(result < 0);
+
+    result = close(ring->fd);
+    exit_on_error(result < 0);
+}
+
+void uring_prepare_slot(Uring* ring, UringSlot* slot, unsigned int index)
+{
+    struct io_uring_sqe*    sqe;
+    unsigned int            sq_index;
+    int                     reading = slot->state == SLOT_READING;
+
+    /* The ring never holds more entries than slots */
+
+    exit_on_error(ring->sqe_tail -
+                  __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >=
+                  *ring->sq_entries);
+
+    sq_index = ring->sqe_tail & *ring->sq_mask;
+    sqe = &ring->sqes[sq_index];
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+
+    if (ring->fixed_buffers)
+    {
+        sqe->opcode = reading ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+        sqe->buf_index = index;
+    }
+    else
+    {
+        sqe->opcode = reading ? IORING_OP_READ : IORING_OP_WRITE;
+    }
+
+    if (ring->fixed_files)
+    {
+        sqe->fd = reading ? 0 : 1;
+        sqe->flags |= IOSQE_FIXED_FILE;
+    }
+    else
+    {
+        sqe->fd = ring->fds[reading ? 0 : 1];
+    }
+
+    sqe->addr = (unsigned long)get_io_buffer_value(slot->buffer, slot->done);
+    sqe->len = get_io_buffer_read_length(slot->buffer) - slot->done;
+    sqe->off = slot->offset + slot->done;
+    sqe->user_data = index;
+
+    ring->sq_array[sq_index] = sq_index;
+    ++ring->sqe_tail;
+}
+
+off_t uring_assign_block(UringSlot* slot, off_t offset, off_t file_size)
+{
+    off_t length = get_io_buffer_size(slot->buffer);
+
+    if (file_size - offset < length)
+    {
+        length = file_size - offset;
+    }
+
+    slot->state = SLOT_READING;
+    slot->offset = offset;
+    slot->done = 0;
+    set_io_buffer_read_length(slot->buffer, length);
+
+    return offset + length;
+}
+
+int uring_submit_and_wait(Uring* ring, unsigned int wait_nr)
+{
+    unsigned int    to_submit = ring->sqe_tail - *ring->sq_tail;
+    int             result;
+
+    /* Publish the filled entries to the kernel */
+
+    __atomic_store_n(ring->sq_tail, ring->sqe_tail, __ATOMIC_RELEASE);
+
+    do
+    {
+        result = syscall(__NR_io_uring_enter, ring->fd, to_submit,
+                         wait_nr, IORING_ENTER_GETEVENTS, NULL, 0);
+    }
+    while (result < 0 && errno == EINTR);
+
+    return result;
+}
+
+int copy_with_uring(int fd_in, int fd_out, size_t power, off_t* copied)
+{
+    struct stat             st;
+    Uring                   ring;
+    UringSlot*              slots;
+    UringSlot*              slot;
+    struct iovec*           iovecs;
+    struct io_uring_cqe*    cqe;
+    unsigned int            slots_count = options.in_flight;
+    unsigned int            busy = 0;
+    unsigned int            head;
+    unsigned int            index;
+    off_t                   next_offset = 0;
+    int                     cqe_result;
+    int                     result;
+
+    /* Positional operations require a regular input file */
+
+    result = fstat(fd_in, &st);
+    exit_on_error(result < 0);
+
+    if (!S_ISREG(st.st_mode) || uring_setup(&ring, slots_count) < 0)
+    {
+        return 0;
+    }
+
+    ring.fds[0] = fd_in;
+    ring.fds[1] = fd_out;
+
+    slots = malloc(slots_count * sizeof(UringSlot));
+    exit_on_error(slots == NULL);
+
+    iovecs = malloc(slots_count * sizeof(struct iovec));
+    exit_on_error(iovecs == NULL);
+
+    for (index = 0; index < slots_count; ++index)
+    {
+        slots[index].buffer = new_io_buffer(power);
+        slots[index].state = SLOT_FREE;
+        iovecs[index].iov_base = get_io_buffer_value(slots[index].buffer, 0);
+        iovecs[index].iov_len = get_io_buffer_size(slots[index].buffer);
+    }
+
+    /* Register the buffers and the files if the kernel accepts it */
+
+    ring.fixed_buffers = syscall(__NR_io_uring_register, ring.fd,
+                                 IORING_REGISTER_BUFFERS,
+                                 iovecs, slots_count) == 0;
+    ring.fixed_files = syscall(__NR_io_uring_register, ring.fd,
+                               IORING_REGISTER_FILES,
+                               ring.fds, 2) == 0;
+
+    /* Fill the ring with the first blocks */
+
+    for (index = 0; index < slots_count && next_offset < st.st_size; ++index)
+    {
+        slot = &slots[index];
+        next_offset = uring_assign_block(slot, next_offset, st.st_size);
+
+        uring_prepare_slot(&ring, slot, index);
+        ++busy;
+    }
+
+    /* Reap the completions and keep the ring full */
+
+    while (busy)
+    {
+        result = uring_submit_and_wait(&ring, 1);
+        exit_on_error(result < 0);
+
+        head = *ring.cq_head;
+        while (head != __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE))
+        {
+            cqe = &ring.cqes[head & *ring.cq_mask];
+            index = cqe->user_data;
+            cqe_result = cqe->res;
+            __atomic_store_n(ring.cq_head, ++head, __ATOMIC_RELEASE);
+
+            slot = &slots[index];
+
+            if (cqe_result < 0)
+            {
+                if (cqe_result == -EINTR || cqe_result == -EAGAIN)
+                {
+                    uring_prepare_slot(&ring, slot, index);
+                    continue;
+                }
+
+                errno = -cqe_result;
+                exit_on_error(1);
+            }
+
+            if (slot->state == SLOT_READING)
+            {
+                if (cqe_result == 0)
+                {
+                    /* The input file has been truncated meanwhile */
+
+                    set_io_buffer_read_length(slot->buffer, slot->done);
+                }
+
+                slot->done += cqe_result;
+
+                if ((ssize_t)slot->done <
+                    get_io_buffer_read_length(slot->buffer))
+                {
+                    uring_prepare_slot(&ring, slot, index);
+                    continue;
+                }
+
+                if (slot->done == 0)
+                {
+                    slot->state = SLOT_FREE;
+                    --busy;
+                    continue;
+                }
+
+                /* The block is complete, write it */
+
+                slot->state = SLOT_WRITING;
+                slot->done = 0;
+                uring_prepare_slot(&ring, slot, index);
+                continue;
+            }
+
+            slot->done += cqe_result;
+            *copied += cqe_result;
+
+            if ((ssize_t)slot->done < get_io_buffer_read_length(slot->buffer))
+            {
+                uring_prepare_slot(&ring, slot, index);
+            }
+            else if (next_offset < st.st_size)
+            {
+                /* Reuse the slot for the next block */
+
+                next_offset = uring_assign_block(slot, next_offset,
+                                                 st.st_size);
+
+                uring_prepare_slot(&ring, slot, index);
+            }
+            else
+            {
+                slot->state = SLOT_FREE;
+                --busy;
+            }
+        }
+    }
+
+    uring_release(&ring);
+
+    for (index = 0; index < slots_count; ++index)
+    {
+        delete_io_buffer(slots[index].buffer);
+    }
+
+    free(iovecs);
+    free(slots);
+
+    return 1;
+}
+
+IOBufferRing* new_io_buffer_ring(size_t depth, size_t power)
+{
+    IOBufferRing* ring;
+    int           result;
+
+    result = posix_memalign((void**)&ring, CACHE_LINE_SIZE,
+                            sizeof(IOBufferRing));
+    errno = result;
+    exit_on_error(result != 0);
+
+    ring->buffers = malloc(depth * sizeof(IOBuffer*));
+    exit_on_error(ring->buffers == NULL);
+
+    for (size_t i = 0; i < depth; ++i)
+    {
+        ring->buffers[i] = new_io_buffer(power);
+    }
+
+    ring->depth = depth;
+    ring->head = 0;
+    ring->tail = 0;
+
+    return ring;
+}
+
+void delete_io_buffer_ring(IOBufferRing* ring)
+{
+    for (size_t i = 0; i < ring->depth; ++i)
+    {
+        delete_io_buffer(ring->buffers[i]);
+    }
+
+    free(ring->buffers);
+    free(ring);
+}
+
+void* reader(void* p)
+{
+    ThreadPipeline* pipeline = p;
+    IOBufferRing*   ring = pipeline->ring;
+    IOBuffer*       buffer;
+    size_t          tail;
+    ssize_t         rw_result;
+
+    do
+    {
+        /* Wait for the writer to give a buffer back */
+
+        tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+        if (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) ==
+            ring->depth)
+        {
+            ++pipeline->reader_stalls;
+            do
+            {
+                sched_yield();
+            }
+            while (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) ==
+                   ring->depth);
+        }
+
+        /* Read the input file */
+
+        buffer = ring->buffers[tail % ring->depth];
+        do
+        {
+            rw_result = read(
+                pipeline->fd_in,
+                (void*)get_io_buffer_value(buffer, 0),
+                get_io_buffer_size(buffer)
+            );
+        }
+        while (rw_result < 0 && errno == EINTR);
+        exit_on_error(rw_result < 0);
+
+        set_io_buffer_read_length(buffer, rw_result);
+
+        /* Publish the buffer, an empty one ends the copy */
+
+        __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    }
+    while (rw_result != 0);
+
+    return NULL;
+}
+
+void* writer(void* p)
+{
+    ThreadPipeline* pipeline = p;
+    IOBufferRing*   ring = pipeline->ring;
+    IOBuffer*       buffer;
+    size_t          head;
+    ssize_t         written;
+    ssize_t         rw_result;
+
+    while (1)
+    {
+        /* Wait for the reader to publish a buffer */
+
+        head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+        if (__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == head)
+        {
+            ++pipeline->writer_stalls;
+            do
+            {
+                sched_yield();
+            }
+            while (__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == head);
+        }
+
+        buffer = ring->buffers[head % ring->depth];
+        if (get_io_buffer_read_length(buffer) == 0)
+        {
+            break;
+        }
+
+        /* Write to the output file */
+
+        for (written = 0;
+             written < get_io_buffer_read_length(buffer);
+             written += rw_result)
+        {
+            rw_result = write(
+                pipeline->fd_out,
+                get_io_buffer_value(buffer, written),
+                get_io_buffer_read_length(buffer) - written
+            );
+            if (rw_result < 0 && errno == EINTR)
+            {
+                rw_result = 0;
+                continue;
+            }
+
+            exit_on_error(rw_result < 0);
+        }
+
+        pipeline->copied += written;
+
+        /* Give the buffer back to the reader */
+
+        __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    }
+
+    return NULL;
+}
+
+off_t copy_with_threads(int fd_in, int fd_out, size_t power)
+{
+    ThreadPipeline  pipeline;
+    pthread_t       reader_thread;
+    pthread_t       writer_thread;
+    int             result;
+
+    pipeline.ring = new_io_buffer_ring(options.in_flight, power);
+    pipeline.fd_in = fd_in;
+    pipeline.fd_out = fd_out;
+    pipeline.copied = 0;
+    pipeline.reader_stalls = 0;
+    pipeline.writer_stalls = 0;
+
+    result = pthread_create(&reader_thread, NULL, reader, &pipeline);
+    errno = result;
+    exit_on_error(result != 0);
+
+    result = pthread_create(&writer_thread, NULL, writer, &pipeline);
+    errno = result;
+    exit_on_error(result != 0);
+
+    result = pthread_join(reader_thread, NULL);
+    errno = result;
+    exit_on_error(result != 0);
+
+    result = pthread_join(writer_thread, NULL);
+    errno = result;
+    exit_on_error(result != 0);
+
+    fprintf(
+        stdout,
+        "Reader stalls: [%lu]\n"
+        "Writer stalls: [%lu]\n",
+        pipeline.reader_stalls,
+        pipeline.writer_stalls
+    );
+
+    delete_io_buffer_ring(pipeline.ring);
+
+    return pipeline.copied;
+}
+
+Extent* find_extents(int fd_in, off_t file_size, size_t* count)
+{
+    Extent* extents = NULL;
+    size_t  capacity = 0;
+    off_t   data;
+    off_t   hole;
+    off_t   length;
+
+    *count = 0;
+
+    for (data = 0; data < file_size; data = hole)
+    {
+        /* Find the next range holding data */
+
+        data = lseek(fd_in, data, SEEK_DATA);
+        if (data < 0)
+        {
+            if (errno == ENXIO)
+            {
+                /* Only a hole is left */
+
+                break;
+            }
+
+            exit_on_error(errno != EINVAL);
+
+            /* The file system does not know the holes */
+
+            data = 0;
+            hole = file_size;
+        }
+        else
+        {
+            hole = lseek(fd_in, data, SEEK_HOLE);
+            exit_on_error(hole < 0);
+        }
+
+        if (hole > file_size)
+        {
+            hole = file_size;
+        }
+
+        /* Split the range so that the workers can share it */
+
+        for (off_t offset = data; offset < hole; offset += length)
+        {
+            length = hole - offset < EXTENT_MAX_LENGTH ?
+                        hole - offset : EXTENT_MAX_LENGTH;
+
+            if (*count == capacity)
+            {
+                capacity = capacity ? capacity * 2 : 64;
+                extents = realloc(extents, capacity * sizeof(Extent));
+                exit_on_error(extents == NULL);
+            }
+
+            extents[*count].offset = offset;
+            extents[*count].length = length;
+            ++*count;
+        }
+    }
+
+    return extents;
+}
+
+void* extent_worker(void* p)
+{
+    ExtentPool* pool = p;
+    IOBuffer*   buffer = new_io_buffer(pool->power);
+    Extent*     extent;
+    size_t      index;
+    off_t       offset;
+    off_t       end;
+    ssize_t     written;
+    ssize_t     rw_result;
+
+    while ((index = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED))
+           < pool->count)
+    {
+        extent = &pool->extents[index];
+        end = extent->offset + extent->length;
+
+        for (offset = extent->offset; offset < end; offset += written)
+        {
+            /* Read the input file */
+
+            rw_result = pread(
+                pool->fd_in,
+                (void*)get_io_buffer_value(buffer, 0),
+                end - offset < (off_t)get_io_buffer_size(buffer) ?
+                    (size_t)(end - offset) : get_io_buffer_size(buffer),
+                offset
+            );
+            if (rw_result < 0 && errno == EINTR)
+            {
+                written = 0;
+                continue;
+            }
+
+            exit_on_error(rw_result < 0);
+
+            if (rw_result == 0)
+            {
+                /* The input file has been truncated meanwhile */
+
+                break;
+            }
+
+            set_io_buffer_read_length(buffer, rw_result);
+
+            /* Write to the same offset of the output file */
+
+            for (written = 0;
+                 written < get_io_buffer_read_length(buffer);
+                 written += rw_result)
+            {
+                rw_result = pwrite(
+                    pool->fd_out,
+                    get_io_buffer_value(buffer, written),
+                    get_io_buffer_read_length(buffer) - written,
+                    offset + written
+                );
+                if (rw_result < 0 && errno == EINTR)
+                {
+                    rw_result = 0;
+                    continue;
+                }
+
+                exit_on_error(rw_result < 0);
+            }
+
+            __atomic_fetch_add(&pool->copied, written, __ATOMIC_RELAXED);
+        }
+    }
+
+    delete_io_buffer(buffer);
+
+    return NULL;
+}
+
+int copy_with_sparse(int fd_in, int fd_out, size_t power, off_t* copied)
+{
+    struct stat st;
+    ExtentPool  pool;
+    pthread_t   workers[MAX_WORKERS];
+    int         result;
+
+    /* Holes only exist in regular files */
+
+    result = fstat(fd_in, &st);
+    exit_on_error(result < 0);
+
+    if (!S_ISREG(st.st_mode))
+    {
+        return 0;
+    }
+
+    /* Resize the output file, the ranges not written remain holes */
+
+    result = ftruncate(fd_out, st.st_size);
+    exit_on_error(result < 0);
+
+    pool.extents = find_extents(fd_in, st.st_size, &pool.count);
+    pool.next = 0;
+    pool.fd_in = fd_in;
+    pool.fd_out = fd_out;
+    pool.power = power;
+    pool.copied = 0;
+
+    for (unsigned int i = 0; i < options.workers; ++i)
+    {
+        result = pthread_create(&workers[i], NULL, extent_worker, &pool);
+        errno = result;
+        exit_on_error(result != 0);
+    }
+
+    for (unsigned int i = 0; i < options.workers; ++i)
+    {
+        result = pthread_join(workers[i], NULL);
+        errno = result;
+        exit_on_error(result != 0);
+    }
+
+    fprintf(
+        stdout,
+        "Data ranges: [%zu]\n"
+        "Bytes skipped: [%lld]\n",
+        pool.count,
+        (long long)(st.st_size - pool.copied)
+    );
+
+    free(pool.extents);
+
+    *copied += pool.copied;
+    return 1;
+}
+
+size_t probe_io_size(int fd_in, int fd_out, size_t* optimal_io_size)
+{
+    struct stat st_in;
+    struct stat st_out;
+    char        path[PATH_MAX];
+    FILE*       file;
+    int         result;
+
+    result = fstat(fd_in, &st_in);
+    exit_on_error(result < 0);
+
+    result = fstat(fd_out, &st_out);
+    exit_on_error(result < 0);
+
+    /* Partitions report the queue of their parent device */
+
+    *optimal_io_size = 0;
+    snprintf(path, PATH_MAX, "/sys/dev/block/%u:%u/queue/optimal_io_size",
+             major(st_in.st_dev), minor(st_in.st_dev));
+
+    if ((file = fopen(path, "r")) == NULL)
+    {
+        snprintf(path, PATH_MAX,
+                 "/sys/dev/block/%u:%u/../queue/optimal_io_size",
+                 major(st_in.st_dev), minor(st_in.st_dev));
+        file = fopen(path, "r");
+    }
+
+    if (file != NULL)
+    {
+        if (fscanf(file, "%zu", optimal_io_size) != 1)
+        {
+            *optimal_io_size = 0;
+        }
+
+        fclose(file);
+    }
+
+    return st_in.st_blksize > st_out.st_blksize ?
+                (size_t)st_in.st_blksize : (size_t)st_out.st_blksize;
+}
+
+size_t probe_power(size_t size)
+{
+    size_t power = 0;
+
+    while (power < MAX_POWER && ((size_t)1 << power) < size)
+    {
+        ++power;
+    }
+
+    return power;
+}
+
+off_t copy_range_with_buffer(int fd_in, int fd_out,
+                             IOBuffer* buffer, off_t length)
+{
+    off_t   copied = 0;
+    size_t  to_read;
+    ssize_t written;
+    ssize_t rw_result;
+
+    while (length == COPY_UNTIL_EOF || copied < length)
+    {
+        to_read = get_io_buffer_size(buffer);
+        if (length != COPY_UNTIL_EOF && length - copied < (off_t)to_read)
+        {
+            to_read = length - copied;
+        }
+
+        /* Read the input file */
+
+        rw_result = read(fd_in, (void*)get_io_buffer_value(buffer, 0),
+                         to_read);
+        if (rw_result == 0)
+        {
+            break;
+        }
+
+        exit_on_error(rw_result < 0);
+
+        set_io_buffer_read_length(buffer, rw_result);
+
+        /* Write to the output file */
+
+        for (written = 0;
+             written < get_io_buffer_read_length(buffer);
+             written += rw_result)
+        {
+            rw_result = write(
+                fd_out,
+                get_io_buffer_value(buffer, written),
+                get_io_buffer_read_length(buffer) - written
+            );
+            exit_on_error(rw_result < 0);
+        }
+
+        copied += written;
+    }
+
+    return copied;
+}
+
+off_t copy_with_auto_buffer(int fd_in, int fd_out, IOBuffer** buffer)
+{
+    struct timespec start;
+    size_t          block_size;
+    size_t          optimal_io_size;
+    size_t          best_size;
+    size_t          sizes[MAX_POWER + 2];
+    size_t          sizes_count = 0;
+    double          best_throughput = 0;
+    double          throughput;
+    double          seconds;
+    off_t           probe_length;
+    off_t           probed;
+    off_t           copied = 0;
+    int             measured = 0;
+    int             end_of_file;
+    int             result;
+
+    block_size = probe_io_size(fd_in, fd_out, &optimal_io_size);
+    best_size = get_io_buffer_size(*buffer);
+
+    fprintf(
+        stdout,
+        "Preferred block size: [%zu]\n"
+        "Optimal I/O size: [%zu]\n",
+        block_size,
+        optimal_io_size
+    );
+
+    /* Candidate sizes */
+
+    for (size_t power = probe_power(block_size);
+         power <= AUTO_MAX_POWER;
+         ++power)
+    {
+        sizes[sizes_count++] = (size_t)1 << power;
+    }
+
+    if (optimal_io_size > block_size &&
+        optimal_io_size < ((size_t)1 << AUTO_MAX_POWER) &&
+        (optimal_io_size & (optimal_io_size - 1)) != 0)
+    {
+        sizes[sizes_count++] = optimal_io_size;
+    }
+
+    /* Warm up the copy with an untimed probe */
+
+    copied = copy_range_with_buffer(fd_in, fd_out, *buffer,
+                                    AUTO_PROBE_LENGTH);
+    fprintf(stdout, "Warm-up probe: [%lld bytes]\n", (long long)copied);
+    end_of_file = copied < AUTO_PROBE_LENGTH;
+
+    /* Copy a probe of the input file with each size */
+
+    for (size_t i = 0; i < sizes_count && !end_of_file; ++i)
+    {
+        delete_io_buffer(*buffer);
+        *buffer = new_io_buffer_with_size(sizes[i]);
+
+        probe_length = (off_t)sizes[i] * 4 > AUTO_PROBE_LENGTH ?
+                            (off_t)sizes[i] * 4 : AUTO_PROBE_LENGTH;
+
+        result = clock_gettime(CLOCK_MONOTONIC, &start);
+        exit_on_error(result < 0);
+
+        probed = copy_range_with_buffer(fd_in, fd_out, *buffer,
+                                        probe_length);
+        seconds = elapsed_seconds(&start);
+        copied += probed;
+
+        if (probed < probe_length)
+        {
+            /* The whole file has been copied */
+
+            fprintf(stdout, "Probe size: [%zu] Throughput: [not measured, "
+                    "end of file]\n", sizes[i]);
+            break;
+        }
+
+        throughput = seconds > 0 ? (double)probed / seconds / 1e6 : 0.0;
+        fprintf(stdout, "Probe size: [%zu] Throughput: [%.2f MB/s]\n",
+                sizes[i], throughput);
+        ++measured;
+
+        if (throughput > best_throughput)
+        {
+            best_throughput = throughput;
+            best_size = sizes[i];
+        }
+    }
+
+    /* Copy the remaining bytes with the best size */
+
+    if (get_io_buffer_size(*buffer) != best_size)
+    {
+        delete_io_buffer(*buffer);
+        *buffer = new_io_buffer_with_size(best_size);
+    }
+
+    if (measured > 0)
+    {
+        fprintf(stdout, "Chosen size: [%zu]\n", best_size);
+    }
+    else
+    {
+        fprintf(stdout, "Chosen size: [%zu] (not measured)\n", best_size);
+    }
+
+    return copied + copy_range_with_buffer(fd_in, fd_out, *buffer,
+                                           COPY_UNTIL_EOF);
+}
+
+size_t probe_direct_alignment(int fd_in, int fd_out)
+{
+    size_t alignment = sysconf(_SC_PAGESIZE);
+
+#ifdef STATX_DIOALIGN
+    struct statx    stx;
+    size_t          required = 0;
+    int             fds[2] = { fd_in, fd_out };
+
+    for (int i = 0; i < 2; ++i)
+    {
+        if (statx(fds[i], "", AT_EMPTY_PATH, STATX_DIOALIGN, &stx) < 0 ||
+            !(stx.stx_mask & STATX_DIOALIGN) ||
+            stx.stx_dio_offset_align == 0)
+        {
+            return alignment;
+        }
+
+        if (stx.stx_dio_offset_align > required)
+        {
+            required = stx.stx_dio_offset_align;
+        }
+
+        if (stx.stx_dio_mem_align > required)
+        {
+            required = stx.stx_dio_mem_align;
+        }
+    }
+
+    alignment = required;
+#else
+    (void)fd_in;
+    (void)fd_out;
+#endif
+
+    return alignment;
+}
+
+int set_direct(int fd, int enabled)
+{
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0)
+    {
+        return flags;
+    }
+
+    return fcntl(fd, F_SETFL, enabled ? flags | O_DIRECT : flags & ~O_DIRECT);
+}
+
+int copy_with_direct(int fd_in, int fd_out, size_t power, off_t* copied)
+{
+    struct stat st_in;
+    struct stat st_out;
+    IOBuffer*   buffer;
+    size_t      alignment;
+    size_t      aligned;
+    int         direct = 1;
+    int         result;
+    ssize_t     written;
+    ssize_t     rw_result;
+
+    result = fstat(fd_in, &st_in);
+    exit_on_error(result < 0);
+
+    result = fstat(fd_out, &st_out);
+    exit_on_error(result < 0);
+
+    if (!S_ISREG(st_in.st_mode) || !S_ISREG(st_out.st_mode))
+    {
+        return 0;
+    }
+
+    /* Enable direct I/O on both files */
+
+    if (set_direct(fd_in, 1) < 0)
+    {
+        exit_on_error(errno != EINVAL);
+        return 0;
+    }
+
+    if (set_direct(fd_out, 1) < 0)
+    {
+        exit_on_error(errno != EINVAL);
+        result = set_direct(fd_in, 0);
+        exit_on_error(result < 0);
+        return 0;
+    }
+
+    /* Align the buffer and its length on the logical block size */
+
+    alignment = probe_direct_alignment(fd_in, fd_out);
+    fprintf(stdout, "Direct I/O alignment: [%zu]\n", alignment);
+
+    options.alignment = alignment;
+    buffer = new_io_buffer_with_size(
+        ((size_t)1 << power) < alignment ? alignment : (size_t)1 << power
+    );
+
+    while (1)
+    {
+        /* Read the input file */
+
+        rw_result = read(fd_in, (void*)get_io_buffer_value(buffer, 0),
+                         get_io_buffer_size(buffer));
+        if (rw_result == 0)
+        {
+            break;
+        }
+
+        exit_on_error(rw_result < 0);
+
+        set_io_buffer_read_length(buffer, rw_result);
+
+        /* An unaligned tail goes through the page cache */
+
+        aligned = rw_result & ~(alignment - 1);
+
+        for (written = 0; written < get_io_buffer_read_length(buffer);
+             written += rw_result)
+        {
+            if (direct && (size_t)written >= aligned)
+            {
+                direct = 0;
+
+                result = set_direct(fd_in, 0);
+                exit_on_error(result < 0);
+
+                result = set_direct(fd_out, 0);
+                exit_on_error(result < 0);
+            }
+
+            rw_result = write(
+                fd_out,
+                get_io_buffer_value(buffer, written),
+                (direct ? (ssize_t)aligned : get_io_buffer_read_length(buffer))
+                    - written
+            );
+            exit_on_error(rw_result < 0);
+        }
+
+        *copied += written;
+    }
+
+    delete_io_buffer(buffer);
+
+    if (direct)
+    {
+        result = set_direct(fd_in, 0);
+        exit_on_error(result < 0);
+
+        result = set_direct(fd_out, 0);
+        exit_on_error(result < 0);
+    }
+
+    return 1;
+}
+
+off_t copy_with_dontneed(int fd_in, int fd_out, IOBuffer* buffer)
+{
+    off_t   copied = 0;
+    off_t   window = 0;
+    off_t   chunk;
+
+    while ((chunk = copy_range_with_buffer(fd_in, fd_out, buffer,
+                                           DONTNEED_WINDOW)) > 0)
+    {
+        /* Start the writeback of the last window */
+
+        release_window(fd_in, fd_out, copied, chunk,
+                       SYNC_FILE_RANGE_WRITE);
+
+        /* Wait for the previous window and drop it */
+
+        if (copied > 0)
+        {
+            release_window(fd_in, fd_out, window, copied - window,
+                           SYNC_FILE_RANGE_WAIT_BEFORE |
+                           SYNC_FILE_RANGE_WRITE |
+                           SYNC_FILE_RANGE_WAIT_AFTER);
+        }
+
+        window = copied;
+        copied += chunk;
+    }
+
+    if (copied > 0)
+    {
+        release_window(fd_in, fd_out, window, copied - window,
+                       SYNC_FILE_RANGE_WAIT_BEFORE |
+                       SYNC_FILE_RANGE_WRITE |
+                       SYNC_FILE_RANGE_WAIT_AFTER);
+    }
+
+    return copied;
+}
+
+void release_window(int fd_in, int fd_out, off_t offset, off_t length,
+                    unsigned int flags)
+{
+    int result;
+
+    /* Pipes and terminals have no page cache, ignore them */
+
+    result = sync_file_range(fd_out, offset, length, flags);
+    exit_on_error(result < 0 && errno != ESPIPE && errno != EINVAL);
+
+    if (flags & SYNC_FILE_RANGE_WAIT_AFTER)
+    {
+        posix_fadvise(fd_in, offset, length, POSIX_FADV_DONTNEED);
+        posix_fadvise(fd_out, offset, length, POSIX_FADV_DONTNEED);
+    }
+}
+
+long read_page_cache_size(void)
+{
+    FILE*   file;
+    char    line[256];
+    long    size = -1;
+
+    if ((file = fopen("/proc/meminfo", "r")) == NULL)
+    {
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        if (sscanf(line, "Cached: %ld kB", &size) == 1)
+        {
+            break;
+        }
+    }
+
+    fclose(file);
+
+    return size;
+}
+
+double elapsed_seconds(const struct timespec* start)
+{
+    struct timespec now;
+    int             result;
+
+    result = clock_gettime(CLOCK_MONOTONIC, &now);
+    exit_on_error(result < 0);
+
+    return (double)(now.tv_sec - start->tv_sec) +
+           (double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+void print_copy_report(CopyPath path, off_t copied, double seconds)
+{
+    fprintf(
+        stdout,
+        "Copy mode: [%s]\n"
+        "Copy path: [%s]\n"
+        "Bytes copied: [%lld]\n"
+        "Elapsed time: [%.6f s]\n"
+        "Throughput: [%.2f MB/s]\n",
+        string_mode[options.mode],
+        string_path[path],
+        (long long)copied,
+        seconds,
+        seconds > 0 ? (double)copied / seconds / 1e6 : 0.0
+    );
+}
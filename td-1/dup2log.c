@@ -27,6 +27,8 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "prsio.h"
+
 
 /*!
  * \brief Output file name.
@@ -34,21 +36,6 @@
 #define OUT_FILE "./error.log"
 
 
-/*!
- * \brief The exit_on_error() function exits the program
- *        if the \p assertion parameter is evaluated
- *        to `TRUE`.
- *
- * If the assertion is evaluated to `TRUE` and 
- * [errno](https://man7.org/linux/man-pages/man3/errno.3.html)
- * is set, then the error number and its associated message
- * are displayed. Otherwise, a generic message is displayed. 
- *
- * \param assertion Assertion to be evaluated.
- */
-static void exit_on_error(int assertion);
-
-
 /*!
  * \brief Main entry point of the program.
  *
@@ -141,20 +128,3 @@ int main(void)
 
     return EXIT_SUCCESS;   
 }
-
-
-void exit_on_error(int assertion)
-{
-    if (assertion)
-    {
-        if (errno) 
-        {
-            fprintf(stderr, "[%d]: %s\n", errno, strerror(errno));
-            exit(EXIT_FAILURE);
-        }
-        
-        fprintf(stderr, "An error occured!\n");
-        exit(EXIT_FAILURE);
-    }
-}
-
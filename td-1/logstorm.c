@@ -0,0 +1,519 @@
+/*!
+ * \ingroup td_1_group
+ * \file logstorm.c
+ * \brief Exercise 1.9
+ *
+ * Redirects the standard error output to a file, as `dup2log`
+ * does, and measures the latency added to threads writing error
+ * messages concurrently, first with a
+ * [write(int fd, const void\* buf, size_t count)](https://man7.org/linux/man-pages/man2/write.2.html)
+ * per message, then with the asynchronous standard error output of
+ * the `asynclog.h` module.
+ *
+ * This program uses the following system calls:
+ *
+ * - [open(const char\* pathname, int flags, mode_t mode)](https://man7.org/linux/man-pages/man2/open.2.html)
+ * - [dup(int oldfd)](https://man7.org/linux/man-pages/man2/dup.2.html)
+ * - [dup2(int oldfd, int newfd)](https://man7.org/linux/man-pages/man2/dup.2.html)
+ * - [write(int fd, const void\* buf, size_t count)](https://man7.org/linux/man-pages/man2/write.2.html)
+ * - [writev(int fd, const struct iovec\* iov, int iovcnt)](https://man7.org/linux/man-pages/man2/writev.2.html)
+ * - [close(int fd)](https://man7.org/linux/man-pages/man2/close.2.html)
+ *
+ * \author H. Decoudras
+ * \version 1
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <errno.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+#include "asynclog.h"
+#include "prsio.h"
+
+
+/*!
+ * \brief Output file name.
+ */
+#define OUT_FILE "./error.log"
+
+/*!
+ * \brief Number of rotated log files kept.
+ */
+#define MAX_FILES 4
+
+/*!
+ * \brief Default number of threads.
+ */
+#define DEFAULT_THREADS 8
+
+/*!
+ * \brief Default number of messages written by each thread.
+ */
+#define DEFAULT_MESSAGES 100000
+
+/*!
+ * \brief Maximum number of threads.
+ */
+#define MAX_THREADS 64
+
+
+/*!
+ * \enum storm_mode
+ * \brief Available ways of writing the messages.
+ */
+typedef enum storm_mode
+{
+    /*!
+     * \brief One `write` per message on the standard error output.
+     */
+    STORM_MODE_WRITE,
+
+    /*!
+     * \brief One asynclog_write() per message.
+     */
+    STORM_MODE_ASYNC
+} StormMode;
+
+/*!
+ * \struct storm_worker
+ * \brief Thread writing error messages.
+ */
+typedef struct storm_worker
+{
+    /*!
+     * \brief Index of the thread.
+     */
+    unsigned int index;
+
+    /*!
+     * \brief Way of writing the messages.
+     */
+    StormMode mode;
+
+    /*!
+     * \brief Number of messages to write.
+     */
+    size_t messages;
+
+    /*!
+     * \brief Set to the latency of each message.
+     */
+    double* latencies;
+
+    /*!
+     * \brief Set to the number of bytes of the messages.
+     */
+    size_t bytes;
+
+    /*!
+     * \brief Threads start writing together.
+     */
+    pthread_barrier_t* barrier;
+} StormWorker;
+
+
+/*!
+ * \brief The use() function displays how to use the
+ *        program.
+ *
+ *        This function always exits the program.
+ *
+ * \param program Name of the program.
+ */
+static void use(const char* program);
+
+/*!
+ * \brief The parse_count() function parses a positive number
+ *        given to an option.
+ *
+ *        This function calls the use() one if the number is
+ *        not valid.
+ *
+ * \param program Name of the program.
+ * \param string Number to parse.
+ *
+ * \return The parsed number.
+ */
+static size_t parse_count(const char* program, const char* string);
+
+/*!
+ * \brief The now() function reads the monotonic clock.
+ *
+ * \return The current time in seconds.
+ */
+static double now(void);
+
+/*!
+ * \brief The compare_doubles() function compares two latencies
+ *        for
+ *        [qsort(void\* base, size_t nmemb, size_t size, int (\*compar)(const void\*, const void\*))](https://man7.org/linux/man-pages/man3/qsort.3.html).
+ */
+static int compare_doubles(const void* a, const void* b);
+
+/*!
+ * \brief The log_size() function sums the sizes of the log file
+ *        and of its rotated copies.
+ *
+ * \return The size of the log files.
+ */
+static off_t log_size(void);
+
+/*!
+ * \brief The remove_logs() function removes the log file and its
+ *        rotated copies.
+ */
+static void remove_logs(void);
+
+/*!
+ * \brief The worker_main() function is the entry point of the
+ *        threads writing error messages.
+ *
+ * \param arg Worker.
+ *
+ * \return `NULL`.
+ */
+static void* worker_main(void* arg);
+
+/*!
+ * \brief The storm() function runs the threads writing error
+ *        messages and displays their latencies.
+ *
+ * \param mode Way of writing the messages.
+ * \param threads Number of threads.
+ * \param messages Number of messages of each thread.
+ * \param max_size Size of the log file triggering a rotation.
+ */
+static void storm(StormMode mode, size_t threads, size_t messages,
+                  off_t max_size);
+
+
+/*!
+ * \brief Main entry point of the program.
+ *
+ * Measures the latency added to threads writing error messages
+ * on a redirected standard error output.
+ *
+ * \param argc Number of arguments of the program.
+ * \param argv Arguments of the program.
+ *
+ * \return The following values can be returned:
+ *          - [EXIT_SUCCESS](https://man7.org/linux/man-pages/man3/exit.3.html)
+ *            in case of success
+ *          - [EXIT_FAILURE](https://man7.org/linux/man-pages/man3/exit.3.html)
+ *            in case of error
+ */
+int main(int argc, char** argv)
+{
+    size_t  threads = DEFAULT_THREADS;
+    size_t  messages = DEFAULT_MESSAGES;
+    off_t   max_size = 0;
+    int     option;
+
+    while ((option = getopt(argc, argv, "t:n:s:")) != -1)
+    {
+        switch (option)
+        {
+            case 't':
+            {
+                threads = parse_count(argv[0], optarg);
+                break;
+            }
+
+            case 'n':
+            {
+                messages = parse_count(argv[0], optarg);
+                break;
+            }
+
+            case 's':
+            {
+                max_size = parse_count(argv[0], optarg);
+                break;
+            }
+
+            default:
+            {
+                use(argv[0]);
+            }
+        }
+    }
+
+    if (optind != argc || threads > MAX_THREADS)
+    {
+        use(argv[0]);
+    }
+
+    storm(STORM_MODE_WRITE, threads, messages, 0);
+    storm(STORM_MODE_ASYNC, threads, messages, max_size);
+
+    return EXIT_SUCCESS;
+}
+
+
+void use(const char* program)
+{
+    fprintf(
+        stderr,
+        "Use:\n  %s [-t <threads [<=%d]>] [-n <messages_per_thread>] "
+        "[-s <rotation_size>]\n",
+        program,
+        MAX_THREADS
+    );
+    exit(EXIT_FAILURE);
+}
+
+size_t parse_count(const char* program, const char* string)
+{
+    size_t len = strlen(string);
+    for (size_t i = 0; i < len; ++i)
+    {
+        if (!isdigit(string[i]))
+        {
+            use(program);
+        }
+    }
+
+    if (len == 0 || strtoul(string, NULL, 10) == 0)
+    {
+        use(program);
+    }
+
+    return strtoul(string, NULL, 10);
+}
+
+double now(void)
+{
+    struct timespec time;
+    int             result;
+
+    result = clock_gettime(CLOCK_MONOTONIC, &time);
+    exit_on_error(result < 0);
+
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+int compare_doubles(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+
+    return (x > y) - (x < y);
+}
+
+off_t log_size(void)
+{
+    struct stat st;
+    char        path[sizeof(OUT_FILE) + 16];
+    off_t       size = 0;
+
+    for (unsigned int i = 0; i <= MAX_FILES; ++i)
+    {
+        if (i == 0)
+        {
+            snprintf(path, sizeof(path), "%s", OUT_FILE);
+        }
+        else
+        {
+            snprintf(path, sizeof(path), "%s.%u", OUT_FILE, i);
+        }
+
+        if (stat(path, &st) == 0)
+        {
+            size += st.st_size;
+        }
+    }
+
+    return size;
+}
+
+void remove_logs(void)
+{
+    char path[sizeof(OUT_FILE) + 16];
+
+    unlink(OUT_FILE);
+    for (unsigned int i = 1; i <= MAX_FILES; ++i)
+    {
+        snprintf(path, sizeof(path), "%s.%u", OUT_FILE, i);
+        unlink(path);
+    }
+}
+
+void* worker_main(void* arg)
+{
+    StormWorker*    worker = arg;
+    char            message[64];
+    int             length;
+    ssize_t         rw_result;
+    double          start;
+
+    pthread_barrier_wait(worker->barrier);
+
+    for (size_t i = 0; i < worker->messages; ++i)
+    {
+        length = snprintf(message, sizeof(message),
+                          "[%u] [%zu] An error occured!\n", worker->index, i);
+
+        /* Only the write itself is measured */
+
+        start = now();
+        if (worker->mode == STORM_MODE_ASYNC)
+        {
+            rw_result = asynclog_write(message, length);
+        }
+        else
+        {
+            rw_result = write(STDERR_FILENO, message, length);
+        }
+        worker->latencies[i] = now() - start;
+
+        exit_on_error(rw_result < 0);
+        worker->bytes += length;
+    }
+
+    return NULL;
+}
+
+void storm(StormMode mode, size_t threads, size_t messages, off_t max_size)
+{
+    StormWorker         workers[MAX_THREADS];
+    pthread_t           tids[MAX_THREADS];
+    pthread_barrier_t   barrier;
+    AsyncLogStats       stats;
+    double*             latencies;
+    size_t              count = threads * messages;
+    size_t              bytes = 0;
+    double              start;
+    double              elapsed;
+    double              closed;
+    int                 fd_stderr = -1;
+    int                 fd_out;
+    int                 result;
+
+    latencies = malloc(count * sizeof(double));
+    exit_on_error(latencies == NULL);
+
+    remove_logs();
+
+    /* Redirect the standard error output to the output file */
+
+    if (mode == STORM_MODE_ASYNC)
+    {
+        result = asynclog_open(OUT_FILE, max_size, MAX_FILES);
+        exit_on_error(result < 0);
+    }
+    else
+    {
+        fd_stderr = dup(STDERR_FILENO);
+        exit_on_error(fd_stderr < 0);
+
+        fd_out = open(OUT_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        exit_on_error(fd_out < 0);
+
+        result = dup2(fd_out, STDERR_FILENO);
+        exit_on_error(result < 0);
+
+        result = close(fd_out);
+        exit_on_error(result < 0);
+    }
+
+    /* Start the storm */
+
+    result = pthread_barrier_init(&barrier, NULL, threads + 1);
+    exit_on_error(result != 0);
+
+    for (size_t i = 0; i < threads; ++i)
+    {
+        workers[i].index = i;
+        workers[i].mode = mode;
+        workers[i].messages = messages;
+        workers[i].latencies = &latencies[i * messages];
+        workers[i].bytes = 0;
+        workers[i].barrier = &barrier;
+
+        result = pthread_create(&tids[i], NULL, worker_main, &workers[i]);
+        exit_on_error(result != 0);
+    }
+
+    pthread_barrier_wait(&barrier);
+    start = now();
+
+    for (size_t i = 0; i < threads; ++i)
+    {
+        result = pthread_join(tids[i], NULL);
+        exit_on_error(result != 0);
+        bytes += workers[i].bytes;
+    }
+
+    elapsed = now() - start;
+    pthread_barrier_destroy(&barrier);
+
+    /* Restore the standard error output, writing what remains */
+
+    if (mode == STORM_MODE_ASYNC)
+    {
+        asynclog_stats(&stats);
+        result = asynclog_close();
+        exit_on_error(result < 0);
+    }
+    else
+    {
+        result = dup2(fd_stderr, STDERR_FILENO);
+        exit_on_error(result < 0);
+
+        result = close(fd_stderr);
+        exit_on_error(result < 0);
+    }
+
+    closed = now() - start;
+
+    /* Display the latencies */
+
+    qsort(latencies, count, sizeof(double), compare_doubles);
+
+    fprintf(
+        stdout,
+        "Mode: [%s]\n"
+        "  Messages: [%zu]\n"
+        "  Elapsed time: [%.3f s] (logged: [%.3f s])\n"
+        "  Throughput: [%.0f messages/s]\n"
+        "  Latency p50: [%.0f ns]\n"
+        "  Latency p99: [%.0f ns]\n"
+        "  Latency p99.9: [%.0f ns]\n"
+        "  Latency max: [%.0f ns]\n"
+        "  Logged: [%lld/%zu B]\n",
+        mode == STORM_MODE_ASYNC ? "async" : "write",
+        count,
+        elapsed,
+        closed,
+        elapsed > 0 ? count / elapsed : 0.0,
+        latencies[count / 2] * 1e9,
+        latencies[(count * 99 + 99) / 100 - 1] * 1e9,
+        latencies[(count * 999 + 999) / 1000 - 1] * 1e9,
+        latencies[count - 1] * 1e9,
+        (long long)log_size(),
+        bytes
+    );
+
+    if (mode == STORM_MODE_ASYNC)
+    {
+        fprintf(
+            stdout,
+            "  Flushes: [%zu] Stalls: [%zu] Direct: [%zu] Rotations: [%zu]\n",
+            stats.flushes,
+            stats.stalls,
+            stats.direct,
+            stats.rotations
+        );
+    }
+
+    free(latencies);
+}
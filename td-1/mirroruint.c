@@ -6,19 +6,31 @@
  * Generates the mirror of a file of natural numbers.
  *
  * This program uses the following system calls:
- * 
- * - [open(const char\* pathname, int flags, mode_t mode)](https://man7.org/linux/man-pages/man2/open.2.html) 
+ *
+ * - [open(const char\* pathname, int flags, mode_t mode)](https://man7.org/linux/man-pages/man2/open.2.html)
  * - [lseek(int fd, off_t offset, int whence)](https://man7.org/linux/man-pages/man2/lseek.2.html)
- * - [read(int fd, void\* buf, size_t count)](https://man7.org/linux/man-pages/man2/read.2.html) 
- * - [write(int fd, const void\* buf, size_t count)](https://man7.org/linux/man-pages/man2/write.2.html) 
- * - [close(int fd)](https://man7.org/linux/man-pages/man2/close.2.html) 
+ * - [read(int fd, void\* buf, size_t count)](https://man7.org/linux/man-pages/man2/read.2.html)
+ * - [write(int fd, const void\* buf, size_t count)](https://man7.org/linux/man-pages/man2/write.2.html)
+ * - [close(int fd)](https://man7.org/linux/man-pages/man2/close.2.html)
+ *
+ * The `block`, `mmap` and `inplace` mirror modes rely on the
+ * following system calls:
+ *
+ * - [pread(int fd, void\* buf, size_t count, off_t offset)](https://man7.org/linux/man-pages/man2/pread.2.html)
+ * - [ftruncate(int fd, off_t length)](https://man7.org/linux/man-pages/man2/ftruncate.2.html)
+ * - [mmap(void\* addr, size_t length, int prot, int flags, int fd, off_t offset)](https://man7.org/linux/man-pages/man2/mmap.2.html)
+ * - [munmap(void\* addr, size_t length)](https://man7.org/linux/man-pages/man2/munmap.2.html)
+ *
+ * The natural numbers are reversed in memory with SSE2 or AVX2
+ * shuffles when the processor supports them.
  *
  * \author H. Decoudras
- * \version 1
+ * \version 3
  */
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
@@ -27,6 +39,72 @@
 #include <stdio.h>
 #include <string.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "prsio.h"
+
+
+/*!
+ * \brief Number of bytes read by each call to
+ *        [pread(int fd, void\* buf, size_t count, off_t offset)](https://man7.org/linux/man-pages/man2/pread.2.html)
+ *        in the `block` mirror mode, and swapped at once in
+ *        the `inplace` one.
+ *
+ * \note It must be a multiple of the size of a natural number.
+ */
+#define BLOCK_SIZE (1 << 20)
+
+
+/*!
+ * \enum mirror_mode
+ * \brief Available mirror modes.
+ */
+typedef enum mirror_mode
+{
+    /*!
+     * \brief Seek, read and write each natural number.
+     */
+    MIRROR_MODE_ELEMENT,
+
+    /*!
+     * \brief Read blocks from the end of the input file and
+     *        write them reversed from the beginning of the
+     *        output file.
+     */
+    MIRROR_MODE_BLOCK,
+
+    /*!
+     * \brief Reverse the mapped input file into the mapped
+     *        output file.
+     */
+    MIRROR_MODE_MMAP,
+
+    /*!
+     * \brief Reverse the mapped input file in place.
+     */
+    MIRROR_MODE_INPLACE
+} MirrorMode;
+
+/*!
+ * \brief Name of each mirror mode, given to the `-m` option.
+ */
+static const char* string_mode[] =
+{
+    "element",
+    "block",
+    "mmap",
+    "inplace"
+};
+
+/*!
+ * \brief The reverse_lanes() function in use, chosen by
+ *        select_reverse_lanes() according to the processor.
+ */
+static void (*reverse_lanes)(unsigned char* dst, const unsigned char* src,
+                             size_t count);
+
 
 /*!
  * \brief The use() function displays how to use the
@@ -46,23 +124,119 @@ static void use(const char* program);
  * \param argc Number of arguments of the program.
  * \param argv Arguments of the program.
  *
+ * \return The mirror mode.
+ *
  * \see use()
  */
-static void exit_on_argv_error(int argc, char** argv);
+static MirrorMode exit_on_argv_error(int argc, char** argv);
 
 /*!
- * \brief The exit_on_error() function exits the program
- *        if the \p assertion parameter is evaluated
- *        to `TRUE`.
+ * \brief The reverse_lanes_scalar() function copies \p count
+ *        natural numbers from \p src to \p dst in reverse
+ *        order, one at a time.
  *
- * If the assertion is evaluated to `TRUE` and 
- * [errno](https://man7.org/linux/man-pages/man3/errno.3.html)
- * is set, then the error number and its associated message
- * are displayed. Otherwise, a generic message is displayed. 
+ *        Both buffers may be unaligned and must not overlap.
  *
- * \param assertion Assertion to be evaluated.
+ * \param dst Destination of the natural numbers.
+ * \param src Source of the natural numbers.
+ * \param count Number of natural numbers.
  */
-static void exit_on_error(int assertion);
+static void reverse_lanes_scalar(unsigned char* dst,
+                                 const unsigned char* src, size_t count);
+
+#ifdef __SSE2__
+/*!
+ * \brief The reverse_lanes_sse2() function copies \p count
+ *        natural numbers from \p src to \p dst in reverse
+ *        order, four at a time.
+ *
+ * \see reverse_lanes_scalar()
+ */
+static void reverse_lanes_sse2(unsigned char* dst,
+                               const unsigned char* src, size_t count);
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+/*!
+ * \brief The reverse_lanes_avx2() function copies \p count
+ *        natural numbers from \p src to \p dst in reverse
+ *        order, eight at a time.
+ *
+ *        It is compiled for AVX2 whatever the flags of the
+ *        compiler and only called when the processor supports
+ *        it.
+ *
+ * \see reverse_lanes_scalar()
+ */
+static void reverse_lanes_avx2(unsigned char* dst,
+                               const unsigned char* src, size_t count);
+#endif
+
+/*!
+ * \brief The select_reverse_lanes() function sets
+ *        \ref reverse_lanes to the widest implementation
+ *        supported by the processor.
+ *
+ * \return The name of the selected implementation.
+ */
+static const char* select_reverse_lanes(void);
+
+/*!
+ * \brief The pread_all() function reads \p length bytes at
+ *        \p offset, resuming after short reads.
+ *
+ * \param fd File descriptor.
+ * \param buffer Destination of the bytes.
+ * \param length Number of bytes to read.
+ * \param offset Offset of the first byte.
+ */
+static void pread_all(int fd, unsigned char* buffer, size_t length,
+                      off_t offset);
+
+/*!
+ * \brief The mirror_by_element() function mirrors the input file
+ *        with a seek, a read and a write per natural number.
+ *
+ * \param fd_in Input file descriptor.
+ * \param fd_out Output file descriptor.
+ * \param in_sz Size of the input file.
+ */
+static void mirror_by_element(int fd_in, int fd_out, off_t in_sz);
+
+/*!
+ * \brief The mirror_by_block() function mirrors the input file
+ *        by reading blocks of \ref BLOCK_SIZE bytes from its
+ *        end and writing them reversed.
+ *
+ * \param fd_in Input file descriptor.
+ * \param fd_out Output file descriptor.
+ * \param in_sz Size of the input file.
+ */
+static void mirror_by_block(int fd_in, int fd_out, off_t in_sz);
+
+/*!
+ * \brief The mirror_with_mmap() function mirrors the mapped
+ *        input file into the mapped output file.
+ *
+ * \param fd_in Input file descriptor.
+ * \param fd_out Output file descriptor, opened for reading
+ *               and writing.
+ * \param in_sz Size of the input file.
+ */
+static void mirror_with_mmap(int fd_in, int fd_out, off_t in_sz);
+
+/*!
+ * \brief The mirror_in_place() function mirrors a mapped file
+ *        in place.
+ *
+ *        Blocks of \ref BLOCK_SIZE bytes are swapped from both
+ *        ends towards the middle of the file. The bytes ignored
+ *        at its beginning are then removed.
+ *
+ * \param fd File descriptor, opened for reading and writing.
+ * \param in_sz Size of the file.
+ */
+static void mirror_in_place(int fd, off_t in_sz);
 
 
 /*!
@@ -70,13 +244,17 @@ static void exit_on_error(int assertion);
  *
  * Generates the mirror of a file of natural numbers.
  *
+ * Like the `element` mode, the other modes ignore the first
+ * bytes of a file whose size is not a multiple of the size of
+ * a natural number.
+ *
  * This program uses the following system calls:
- * 
- * - [open(const char\* pathname, int flags, mode_t mode)](https://man7.org/linux/man-pages/man2/open.2.html) 
+ *
+ * - [open(const char\* pathname, int flags, mode_t mode)](https://man7.org/linux/man-pages/man2/open.2.html)
  * - [lseek(int fd, off_t offset, int whence)](https://man7.org/linux/man-pages/man2/lseek.2.html)
- * - [read(int fd, void\* buf, size_t count)](https://man7.org/linux/man-pages/man2/read.2.html) 
- * - [write(int fd, const void\* buf, size_t count)](https://man7.org/linux/man-pages/man2/write.2.html) 
- * - [close(int fd)](https://man7.org/linux/man-pages/man2/close.2.html) 
+ * - [read(int fd, void\* buf, size_t count)](https://man7.org/linux/man-pages/man2/read.2.html)
+ * - [write(int fd, const void\* buf, size_t count)](https://man7.org/linux/man-pages/man2/write.2.html)
+ * - [close(int fd)](https://man7.org/linux/man-pages/man2/close.2.html)
  *
  * \param argc Number of arguments of the program.
  * \param argv Arguments of the program.
@@ -84,61 +262,78 @@ static void exit_on_error(int assertion);
  * \return The following values can be returned:
  *          - [EXIT_SUCCESS](https://man7.org/linux/man-pages/man3/exit.3.html)
  *            in case of success
- *          - [EXIT_FAILURE](https://man7.org/linux/man-pages/man3/exit.3.html) 
+ *          - [EXIT_FAILURE](https://man7.org/linux/man-pages/man3/exit.3.html)
  *            in case of error
  */
 int main(int argc, char** argv)
 {
-    exit_on_argv_error(argc, argv);
+    MirrorMode mode = exit_on_argv_error(argc, argv);
 
     int             fd_in;
     int             fd_out;
-    unsigned int    value_numeric;
     off_t           in_sz;
     int             result;
-    off_t           seek_result;
-    ssize_t         rw_result;
+
+    if (mode != MIRROR_MODE_ELEMENT)
+    {
+        fprintf(stderr, "Lane reversal: [%s]\n", select_reverse_lanes());
+    }
 
     /* Open the input file in read only mode */
 
-    fd_in = open(argv[1], O_RDONLY);
+    fd_in = open(argv[optind],
+                 mode == MIRROR_MODE_INPLACE ? O_RDWR : O_RDONLY);
     exit_on_error(fd_in < 0);
-   
+
     /* Go to the end of the file */
 
     in_sz = lseek(fd_in, 0, SEEK_END);
     exit_on_error(in_sz < 0);
-    
-    /* 
-        Open the output file in write only mode
+
+    if (mode == MIRROR_MODE_INPLACE)
+    {
+        mirror_in_place(fd_in, in_sz);
+
+        result = close(fd_in);
+        exit_on_error(result < 0);
+
+        return EXIT_SUCCESS;
+    }
+
+    /*
+        Open the output file in write only mode, or in read
+        and write mode to be mapped
 
         Create the file if it does not exist and trunc
         its content
     */
 
-    fd_out = open(argv[2], O_CREAT | O_WRONLY | O_TRUNC, 0666);
+    fd_out = open(argv[optind + 1],
+                  (mode == MIRROR_MODE_MMAP ? O_RDWR : O_WRONLY) |
+                  O_CREAT | O_TRUNC, 0666);
     exit_on_error(fd_out < 0);
-   
+
     /* Mirror */
 
-    for (off_t offset = in_sz - sizeof(unsigned int); 
-         offset >= 0; 
-         offset -= sizeof(unsigned int))
+    switch (mode)
     {
-        /* Go back to the previous number */
-
-        seek_result = lseek(fd_in, offset, SEEK_SET);
-        exit_on_error(seek_result < 0);
-
-        /* Read the number from the input file */
-
-        rw_result = read(fd_in, &value_numeric, sizeof(unsigned int));
-        exit_on_error(rw_result < 0);
+        case MIRROR_MODE_BLOCK:
+        {
+            mirror_by_block(fd_in, fd_out, in_sz);
+            break;
+        }
 
-        /* Write the number to the output file */
+        case MIRROR_MODE_MMAP:
+        {
+            mirror_with_mmap(fd_in, fd_out, in_sz);
+            break;
+        }
 
-        rw_result = write(fd_out, &value_numeric, sizeof(unsigned int));
-        exit_on_error(rw_result < 0);
+        default:
+        {
+            mirror_by_element(fd_in, fd_out, in_sz);
+            break;
+        }
     }
 
     /* Close the files */
@@ -149,40 +344,304 @@ int main(int argc, char** argv)
     result = close(fd_out);
     exit_on_error(result < 0);
 
-    return EXIT_SUCCESS;   
+    return EXIT_SUCCESS;
 }
 
 
 void use(const char* program)
 {
     fprintf(
-        stderr, 
-        "Use:\n  %s <filename_in> <filename_out>\n",
+        stderr,
+        "Use:\n  %s [-m <element|block|mmap>] <filename_in> <filename_out>\n"
+        "  %s -m inplace <filename>\n",
+        program,
         program
     );
     exit(EXIT_FAILURE);
 }
 
-void exit_on_argv_error(int argc, char** argv)
+MirrorMode exit_on_argv_error(int argc, char** argv)
 {
-    if (argc != 3)
+    MirrorMode  mode = MIRROR_MODE_ELEMENT;
+    int         option;
+    int         found;
+
+    while ((option = getopt(argc, argv, "m:")) != -1)
+    {
+        if (option != 'm')
+        {
+            use(argv[0]);
+        }
+
+        found = 0;
+        for (size_t i = 0;
+             i < sizeof(string_mode) / sizeof(string_mode[0]);
+             ++i)
+        {
+            if (strcmp(optarg, string_mode[i]) == 0)
+            {
+                mode = (MirrorMode)i;
+                found = 1;
+            }
+        }
+
+        if (!found)
+        {
+            use(argv[0]);
+        }
+    }
+
+    if (argc - optind != (mode == MIRROR_MODE_INPLACE ? 1 : 2))
     {
         use(argv[0]);
     }
+
+    return mode;
 }
 
-void exit_on_error(int assertion)
+void reverse_lanes_scalar(unsigned char* dst, const unsigned char* src,
+                          size_t count)
 {
-    if (assertion)
+    for (size_t i = 0; i < count; ++i)
     {
-        if (errno) 
+        memcpy(dst + i * sizeof(unsigned int),
+               src + (count - 1 - i) * sizeof(unsigned int),
+               sizeof(unsigned int));
+    }
+}
+
+#ifdef __SSE2__
+void reverse_lanes_sse2(unsigned char* dst, const unsigned char* src,
+                        size_t count)
+{
+    size_t  i = 0;
+    __m128i lanes;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        lanes = _mm_loadu_si128(
+            (const __m128i*)(src + (count - i - 4) * sizeof(unsigned int))
+        );
+        lanes = _mm_shuffle_epi32(lanes, _MM_SHUFFLE(0, 1, 2, 3));
+        _mm_storeu_si128((__m128i*)(dst + i * sizeof(unsigned int)), lanes);
+    }
+
+    /* The first natural numbers of the source are left */
+
+    reverse_lanes_scalar(dst + i * sizeof(unsigned int), src, count - i);
+}
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2")))
+void reverse_lanes_avx2(unsigned char* dst, const unsigned char* src,
+                        size_t count)
+{
+    size_t          i = 0;
+    const __m256i   order = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    __m256i         lanes;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        lanes = _mm256_loadu_si256(
+            (const __m256i*)(src + (count - i - 8) * sizeof(unsigned int))
+        );
+        lanes = _mm256_permutevar8x32_epi32(lanes, order);
+        _mm256_storeu_si256((__m256i*)(dst + i * sizeof(unsigned int)),
+                            lanes);
+    }
+
+    /* The first natural numbers of the source are left */
+
+    reverse_lanes_scalar(dst + i * sizeof(unsigned int), src, count - i);
+}
+#endif
+
+const char* select_reverse_lanes(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        reverse_lanes = reverse_lanes_avx2;
+        return "avx2";
+    }
+#endif
+
+#ifdef __SSE2__
+    reverse_lanes = reverse_lanes_sse2;
+    return "sse2";
+#else
+    reverse_lanes = reverse_lanes_scalar;
+    return "scalar";
+#endif
+}
+
+void pread_all(int fd, unsigned char* buffer, size_t length, off_t offset)
+{
+    ssize_t rw_result;
+
+    for (size_t done = 0; done < length; done += rw_result)
+    {
+        rw_result = pread(fd, buffer + done, length - done, offset + done);
+        if (rw_result < 0 && errno == EINTR)
         {
-            fprintf(stderr,"[%d]: %s\n", errno, strerror(errno));
-            exit(EXIT_FAILURE);
+            rw_result = 0;
+            continue;
         }
-        
-        fprintf(stderr, "An error occured!\n");
-        exit(EXIT_FAILURE);
+
+        exit_on_error(rw_result <= 0);
+    }
+}
+
+void mirror_by_element(int fd_in, int fd_out, off_t in_sz)
+{
+    unsigned int    value_numeric;
+    off_t           seek_result;
+    ssize_t         rw_result;
+
+    for (off_t offset = in_sz - sizeof(unsigned int);
+         offset >= 0;
+         offset -= sizeof(unsigned int))
+    {
+        /* Go back to the previous number */
+
+        seek_result = lseek(fd_in, offset, SEEK_SET);
+        exit_on_error(seek_result < 0);
+
+        /* Read the number from the input file */
+
+        rw_result = read(fd_in, &value_numeric, sizeof(unsigned int));
+        exit_on_error(rw_result < 0);
+
+        /* Write the number to the output file */
+
+        rw_result = write(fd_out, &value_numeric, sizeof(unsigned int));
+        exit_on_error(rw_result < 0);
+    }
+}
+
+void mirror_by_block(int fd_in, int fd_out, off_t in_sz)
+{
+    unsigned char*  block_in;
+    unsigned char*  block_out;
+    off_t           first = in_sz % sizeof(unsigned int);
+    off_t           start;
+    size_t          length;
+    ssize_t         rw_result;
+
+    block_in = malloc(BLOCK_SIZE);
+    exit_on_error(block_in == NULL);
+
+    block_out = malloc(BLOCK_SIZE);
+    exit_on_error(block_out == NULL);
+
+    /* Walk the input file from its end, one block at a time */
+
+    for (off_t end = in_sz; end > first; end = start)
+    {
+        start = end - first > BLOCK_SIZE ? end - BLOCK_SIZE : first;
+        length = end - start;
+
+        pread_all(fd_in, block_in, length, start);
+        reverse_lanes(block_out, block_in, length / sizeof(unsigned int));
+        rw_result = write_full(fd_out, block_out, length);
+        exit_on_error(rw_result < 0);
     }
+
+    free(block_in);
+    free(block_out);
+}
+
+void mirror_with_mmap(int fd_in, int fd_out, off_t in_sz)
+{
+    unsigned char*  map_in;
+    unsigned char*  map_out;
+    off_t           first = in_sz % sizeof(unsigned int);
+    off_t           out_sz = in_sz - first;
+    int             result;
+
+    if (out_sz == 0)
+    {
+        return;
+    }
+
+    result = ftruncate(fd_out, out_sz);
+    exit_on_error(result < 0);
+
+    map_in = mmap(NULL, in_sz, PROT_READ, MAP_PRIVATE, fd_in, 0);
+    exit_on_error(map_in == MAP_FAILED);
+
+    map_out = mmap(NULL, out_sz, PROT_READ | PROT_WRITE, MAP_SHARED,
+                   fd_out, 0);
+    exit_on_error(map_out == MAP_FAILED);
+
+    reverse_lanes(map_out, map_in + first, out_sz / sizeof(unsigned int));
+
+    result = munmap(map_in, in_sz);
+    exit_on_error(result < 0);
+
+    result = munmap(map_out, out_sz);
+    exit_on_error(result < 0);
 }
 
+void mirror_in_place(int fd, off_t in_sz)
+{
+    unsigned char*  map;
+    unsigned char*  values;
+    unsigned char*  saved;
+    off_t           first = in_sz % sizeof(unsigned int);
+    size_t          low = 0;
+    size_t          high = in_sz - first;
+    int             result;
+
+    if (in_sz == 0)
+    {
+        return;
+    }
+
+    map = mmap(NULL, in_sz, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    exit_on_error(map == MAP_FAILED);
+
+    saved = malloc(2 * (size_t)BLOCK_SIZE);
+    exit_on_error(saved == NULL);
+
+    values = map + first;
+
+    /* Swap the blocks at both ends until they meet */
+
+    while (high - low >= 2 * (size_t)BLOCK_SIZE)
+    {
+        memcpy(saved, values + low, BLOCK_SIZE);
+        reverse_lanes(values + low, values + high - BLOCK_SIZE,
+                      BLOCK_SIZE / sizeof(unsigned int));
+        reverse_lanes(values + high - BLOCK_SIZE, saved,
+                      BLOCK_SIZE / sizeof(unsigned int));
+
+        low += BLOCK_SIZE;
+        high -= BLOCK_SIZE;
+    }
+
+    /* The middle is smaller than two blocks */
+
+    memcpy(saved, values + low, high - low);
+    reverse_lanes(values + low, saved, (high - low) / sizeof(unsigned int));
+
+    /* Drop the bytes ignored at the beginning of the file */
+
+    if (first > 0)
+    {
+        memmove(map, values, in_sz - first);
+    }
+
+    free(saved);
+
+    result = munmap(map, in_sz);
+    exit_on_error(result < 0);
+
+    if (first > 0)
+    {
+        result = ftruncate(fd, in_sz - first);
+        exit_on_error(result < 0);
+    }
+}
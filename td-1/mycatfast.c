@@ -0,0 +1,406 @@
+/*!
+ * \ingroup td_1_group
+ * \file mycatfast.c
+ * \brief Exercise 1.10
+ *
+ * Writes the standard input on the standard output with the
+ * fastest path allowed by their types.
+ *
+ * The types of the standard input and output are detected with
+ * [fstat(int fd, struct stat\* statbuf)](https://man7.org/linux/man-pages/man2/fstat.2.html)
+ * and the following paths are tried in this order:
+ *
+ * - [splice(int fd_in, off64_t\* off_in, int fd_out, off64_t\* off_out, size_t len, unsigned int flags)](https://man7.org/linux/man-pages/man2/splice.2.html)
+ *   when one of them is a pipe
+ * - [copy_file_range(int fd_in, off64_t\* off_in, int fd_out, off64_t\* off_out, size_t len, unsigned int flags)](https://man7.org/linux/man-pages/man2/copy_file_range.2.html)
+ *   when both are regular files
+ * - [sendfile(int out_fd, int in_fd, off_t\* offset, size_t count)](https://man7.org/linux/man-pages/man2/sendfile.2.html)
+ *   when the standard input is a regular file
+ * - [readv(int fd, const struct iovec\* iov, int iovcnt)](https://man7.org/linux/man-pages/man2/readv.2.html)
+ *   and
+ *   [writev(int fd, const struct iovec\* iov, int iovcnt)](https://man7.org/linux/man-pages/man2/writev.2.html)
+ *   otherwise
+ *
+ * Each path resumes from the bytes already copied by the previous
+ * one when the kernel refuses it.
+ *
+ * \author H. Decoudras
+ * \version 2
+ */
+
+#define _GNU_SOURCE
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "prsio.h"
+
+
+/*!
+ * \brief Maximum number of bytes requested by each call
+ *        to the zero-copy system calls.
+ */
+#define CHUNK_SIZE (1 << 30)
+
+/*!
+ * \brief Number of bytes moved by each call to
+ *        [splice(int fd_in, off64_t\* off_in, int fd_out, off64_t\* off_out, size_t len, unsigned int flags)](https://man7.org/linux/man-pages/man2/splice.2.html).
+ */
+#define SPLICE_CHUNK_SIZE (1 << 20)
+
+/*!
+ * \brief Number of buffers filled by each call to
+ *        [readv(int fd, const struct iovec\* iov, int iovcnt)](https://man7.org/linux/man-pages/man2/readv.2.html).
+ */
+#define VECTOR_COUNT 4
+
+/*!
+ * \brief Size of each buffer filled by
+ *        [readv(int fd, const struct iovec\* iov, int iovcnt)](https://man7.org/linux/man-pages/man2/readv.2.html).
+ */
+#define VECTOR_SIZE (1 << 18)
+
+
+/*!
+ * \enum cat_path
+ * \brief Path that completed the copy.
+ */
+typedef enum cat_path
+{
+    /*!
+     * \brief Direct splice from or to a pipe.
+     */
+    CAT_PATH_SPLICE,
+
+    /*!
+     * \brief In-kernel copy between regular files.
+     */
+    CAT_PATH_COPY_FILE_RANGE,
+
+    /*!
+     * \brief In-kernel copy from a regular file.
+     */
+    CAT_PATH_SENDFILE,
+
+    /*!
+     * \brief Vectored copy through user-space buffers.
+     */
+    CAT_PATH_VECTORED
+} CatPath;
+
+/*!
+ * \brief Name of each path, displayed by the `-v` option.
+ */
+static const char* string_path[] =
+{
+    "splice",
+    "copy_file_range",
+    "sendfile",
+    "readv/writev"
+};
+
+
+/*!
+ * \brief The is_unsupported_error() function determines if an
+ *        error means that a path is not available for the
+ *        standard input and output.
+ *
+ * \param error Error number.
+ *
+ * \return **1** if the next path should be tried, **0** otherwise.
+ */
+static int is_unsupported_error(int error);
+
+/*!
+ * \brief The cat_with_splice() function moves the standard input
+ *        to the standard output, one of them being a pipe.
+ *
+ * \param copied Incremented by the number of bytes copied.
+ *
+ * \return This function can return the following values:
+ *          - **0** if the kernel refused the splice
+ *          - **1** if the end of the standard input has been reached
+ */
+static int cat_with_splice(off_t* copied);
+
+/*!
+ * \brief The cat_with_copy_file_range() function copies the
+ *        standard input to the standard output, both being
+ *        regular files.
+ *
+ * \param copied Incremented by the number of bytes copied.
+ *
+ * \return This function can return the following values:
+ *          - **0** if the kernel refused the copy
+ *          - **1** if the end of the standard input has been reached
+ */
+static int cat_with_copy_file_range(off_t* copied);
+
+/*!
+ * \brief The cat_with_sendfile() function copies the standard
+ *        input, a regular file, to the standard output.
+ *
+ * \param copied Incremented by the number of bytes copied.
+ *
+ * \return This function can return the following values:
+ *          - **0** if the kernel refused the copy
+ *          - **1** if the end of the standard input has been reached
+ */
+static int cat_with_sendfile(off_t* copied);
+
+/*!
+ * \brief The cat_with_vectors() function copies the standard
+ *        input to the standard output through \ref VECTOR_COUNT
+ *        buffers of \ref VECTOR_SIZE bytes.
+ *
+ *        A short write advances the vectors to the first byte
+ *        not yet written before writing again.
+ *
+ * \param copied Incremented by the number of bytes copied.
+ */
+static void cat_with_vectors(off_t* copied);
+
+
+/*!
+ * \brief Main entry point of the program.
+ *
+ * Writes the standard input on the standard output with the
+ * fastest path allowed by their types. The `-v` option displays
+ * the path that completed the copy and the number of bytes
+ * copied on the standard error.
+ *
+ * \param argc Number of arguments.
+ * \param argv Arguments.
+ *
+ * \return The following values can be returned:
+ *          - [EXIT_SUCCESS](https://man7.org/linux/man-pages/man3/exit.3.html)
+ *            in case of success
+ *          - [EXIT_FAILURE](https://man7.org/linux/man-pages/man3/exit.3.html)
+ *            in case of error
+ */
+int main(int argc, char** argv)
+{
+    struct stat st_in;
+    struct stat st_out;
+    CatPath     path;
+    off_t       copied = 0;
+    int         verbose = 0;
+    int         result;
+
+    if (argc == 2 && strcmp(argv[1], "-v") == 0)
+    {
+        verbose = 1;
+    }
+    else if (argc != 1)
+    {
+        fprintf(stderr, "Use:\n  %s [-v]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    /* Detect the types of the standard input and output */
+
+    result = fstat(STDIN_FILENO, &st_in);
+    exit_on_error(result < 0);
+
+    result = fstat(STDOUT_FILENO, &st_out);
+    exit_on_error(result < 0);
+
+    /* Try the fastest path first */
+
+    if ((S_ISFIFO(st_in.st_mode) || S_ISFIFO(st_out.st_mode)) &&
+        cat_with_splice(&copied))
+    {
+        path = CAT_PATH_SPLICE;
+    }
+    else if (S_ISREG(st_in.st_mode) && S_ISREG(st_out.st_mode) &&
+             cat_with_copy_file_range(&copied))
+    {
+        path = CAT_PATH_COPY_FILE_RANGE;
+    }
+    else if (S_ISREG(st_in.st_mode) && cat_with_sendfile(&copied))
+    {
+        path = CAT_PATH_SENDFILE;
+    }
+    else
+    {
+        path = CAT_PATH_VECTORED;
+        cat_with_vectors(&copied);
+    }
+
+    if (verbose)
+    {
+        fprintf(stderr, "Path: [%s] Bytes copied: [%lld]\n",
+                string_path[path], (long long)copied);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+int is_unsupported_error(int error)
+{
+    switch (error)
+    {
+        case ENOSYS:
+        case EXDEV:
+        case EINVAL:
+        case EOPNOTSUPP:
+        case EBADF:
+        case ESPIPE:
+        {
+            return 1;
+        }
+
+        default:
+        {
+            return 0;
+        }
+    }
+}
+
+int cat_with_splice(off_t* copied)
+{
+    ssize_t rw_result;
+
+    while ((rw_result = splice(STDIN_FILENO, NULL, STDOUT_FILENO, NULL,
+                               SPLICE_CHUNK_SIZE, SPLICE_F_MOVE)) != 0)
+    {
+        if (rw_result < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            exit_on_error(!is_unsupported_error(errno));
+            return 0;
+        }
+
+        *copied += rw_result;
+    }
+
+    return 1;
+}
+
+int cat_with_copy_file_range(off_t* copied)
+{
+    ssize_t rw_result;
+    off_t   copied_here = 0;
+
+    while ((rw_result = copy_file_range(STDIN_FILENO, NULL,
+                                        STDOUT_FILENO, NULL,
+                                        CHUNK_SIZE, 0)) != 0)
+    {
+        if (rw_result < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            exit_on_error(!is_unsupported_error(errno));
+            return 0;
+        }
+
+        copied_here += rw_result;
+        *copied += rw_result;
+    }
+
+    /*
+        Some pseudo file systems report the end of the
+        file instead of refusing the copy
+    */
+
+    return copied_here > 0;
+}
+
+int cat_with_sendfile(off_t* copied)
+{
+    ssize_t rw_result;
+
+    while ((rw_result = sendfile(STDOUT_FILENO, STDIN_FILENO, NULL,
+                                 CHUNK_SIZE)) != 0)
+    {
+        if (rw_result < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            exit_on_error(!is_unsupported_error(errno));
+            return 0;
+        }
+
+        *copied += rw_result;
+    }
+
+    return 1;
+}
+
+void cat_with_vectors(off_t* copied)
+{
+    struct iovec    vectors[VECTOR_COUNT];
+    unsigned char*  buffer;
+    int             pending_count;
+    ssize_t         remaining;
+    ssize_t         rw_result;
+
+    buffer = malloc((size_t)VECTOR_COUNT * VECTOR_SIZE);
+    exit_on_error(buffer == NULL);
+
+    while (1)
+    {
+        /* Fill the buffers from the standard input */
+
+        for (int i = 0; i < VECTOR_COUNT; ++i)
+        {
+            vectors[i].iov_base = buffer + (size_t)i * VECTOR_SIZE;
+            vectors[i].iov_len = VECTOR_SIZE;
+        }
+
+        rw_result = readv(STDIN_FILENO, vectors, VECTOR_COUNT);
+        if (rw_result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        exit_on_error(rw_result < 0);
+
+        if (rw_result == 0)
+        {
+            break;
+        }
+
+        /* Keep only the filled part of the buffers */
+
+        remaining = rw_result;
+        *copied += rw_result;
+
+        for (pending_count = 0; remaining > 0; ++pending_count)
+        {
+            if ((size_t)remaining < vectors[pending_count].iov_len)
+            {
+                vectors[pending_count].iov_len = remaining;
+            }
+
+            remaining -= vectors[pending_count].iov_len;
+        }
+
+        /* Write them, resuming after short writes */
+
+        rw_result = writev_full(STDOUT_FILENO, vectors, pending_count);
+        exit_on_error(rw_result < 0);
+    }
+
+    free(buffer);
+}
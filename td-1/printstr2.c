@@ -21,20 +21,7 @@
 #include <stdio.h>
 #include <string.h>
 
-
-/*!
- * \brief The exit_on_error() function exits the program
- *        if the \p assertion parameter is evaluated
- *        to `TRUE`.
- *
- * If the assertion is evaluated to `TRUE` and 
- * [errno](https://man7.org/linux/man-pages/man3/errno.3.html)
- * is set, then the error number and its associated message
- * are displayed. Otherwise, a generic message is displayed. 
- *
- * \param assertion Assertion to be evaluated.
- */
-static void exit_on_error(int assertion);
+#include "prsio.h"
 
 
 /*!
@@ -66,20 +53,3 @@ int main(void)
 
     return EXIT_SUCCESS; 
 }
-
-
-void exit_on_error(int assertion)
-{
-    if (assertion)
-    {
-        if (errno) 
-        {
-            fprintf(stderr, "[%d]: %s\n", errno, strerror(errno));
-            exit(EXIT_FAILURE);
-        }
-        
-        fprintf(stderr, "An error occured!\n");
-        exit(EXIT_FAILURE);
-    }
-}
-
@@ -3,23 +3,30 @@
  * \file printuintgen.c
  * \brief Exercise 1.2
  *
- * Reads the `uintgen.bin` file, representing natural numbers, 
+ * Reads the `uintgen.bin` file, representing natural numbers,
  * and displays its content on the standard output.
  *
  * This program uses the following system calls:
  *
  * - [open(const char\* pathname, int flags, mode_t mode)](https://man7.org/linux/man-pages/man2/open.2.html)
  * - [lseek(int fd, off_t offset, int whence)](https://man7.org/linux/man-pages/man2/lseek.2.html)
- * - [read(int fd, void\* buf, size_t count)](https://man7.org/linux/man-pages/man2/read.2.html) 
- * - [write(int fd, const void\* buf, size_t count)](https://man7.org/linux/man-pages/man2/write.2.html) 
+ * - [read(int fd, void\* buf, size_t count)](https://man7.org/linux/man-pages/man2/read.2.html)
+ * - [write(int fd, const void\* buf, size_t count)](https://man7.org/linux/man-pages/man2/write.2.html)
  * - [close(int fd)](https://man7.org/linux/man-pages/man2/close.2.html)
  *
+ * The `mmap` display mode relies on the following system calls:
+ *
+ * - [mmap(void\* addr, size_t length, int prot, int flags, int fd, off_t offset)](https://man7.org/linux/man-pages/man2/mmap.2.html)
+ * - [madvise(void\* addr, size_t length, int advice)](https://man7.org/linux/man-pages/man2/madvise.2.html)
+ * - [munmap(void\* addr, size_t length)](https://man7.org/linux/man-pages/man2/munmap.2.html)
+ *
  * \author H. Decoudras
- * \version 1
+ * \version 3
  */
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
@@ -28,83 +35,132 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "convert.h"
+#include "prsio.h"
+
 
 /*!
  * \brief File name.
  */
 #define FNAME "./uintgen.bin"
 
+/*!
+ * \brief Size of the output buffer of the `mmap` display mode.
+ */
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
 
 /*!
- * \brief The exit_on_error() function exits the program
- *        if the \p assertion parameter is evaluated
- *        to `TRUE`.
+ * \enum display_mode
+ * \brief Available display modes.
+ */
+typedef enum display_mode
+{
+    /*!
+     * \brief Read and write each natural number with its own
+     *        system calls.
+     */
+    DISPLAY_MODE_READ,
+
+    /*!
+     * \brief Map the file and convert the natural numbers in
+     *        bulk into a large output buffer.
+     */
+    DISPLAY_MODE_MMAP
+} DisplayMode;
+
+
+/*!
+ * \brief The use() function displays how to use the
+ *        program.
  *
- * If the assertion is evaluated to `TRUE` and 
- * [errno](https://man7.org/linux/man-pages/man3/errno.3.html)
- * is set, then the error number and its associated message
- * are displayed. Otherwise, a generic message is displayed. 
+ *        This function always exits the program.
  *
- * \param assertion Assertion to be evaluated.
+ * \param program Name of the program.
  */
-static void exit_on_error(int assertion);
+static void use(const char* program);
 
+/*!
+ * \brief The exit_on_argv_error() function exits the
+ *        program if the provided arguments are not
+ *        valid.
+ *
+ *        This function calls the use() one.
+ *
+ * \param argc Number of arguments of the program.
+ * \param argv Arguments of the program.
+ *
+ * \return The display mode.
+ *
+ * \see use()
+ */
+static DisplayMode exit_on_argv_error(int argc, char** argv);
 
 /*!
- * \brief The uint_to_string() function converts a natural
- *        number into a string representation.
+ * \brief The print_with_read() function displays the natural
+ *        numbers with one read and one write per number.
  *
- *        The string representation of the natural number 
- *        is stored in the \p buffer parameter and is
- *        inverted.
+ * \param fd File descriptor positioned at the beginning of
+ *           the file.
+ * \param file_size Size of the file.
+ */
+static void print_with_read(int fd, off_t file_size);
+
+/*!
+ * \brief The print_with_mmap() function displays the natural
+ *        numbers of a mapped file through a large output
+ *        buffer.
  *
- * \param buffer String representation of the natural number.
- * \param value Natural number to convert.
+ *        The natural numbers are converted by batches filling
+ *        the output buffer. The output is identical to the one
+ *        of print_with_read(),
+ *        including for a file whose size is not a multiple of
+ *        the size of a natural number.
  *
- * \return The length of the string, including the null 
- *         terminating caracter.
+ * \param fd File descriptor.
+ * \param file_size Size of the file.
  */
-static size_t uint_to_string(char* buffer, unsigned int value);
+static void print_with_mmap(int fd, off_t file_size);
 
 
 /*!
  * \brief Main entry point of the program.
  *
- * Reads the `uintgen.bin` file, representing natural numbers, 
+ * Reads the `uintgen.bin` file, representing natural numbers,
  * and displays its content on the standard output.
  *
  * This program uses the following system calls:
  *
  * - [open(const char\* pathname, int flags, mode_t mode)](https://man7.org/linux/man-pages/man2/open.2.html)
  * - [lseek(int fd, off_t offset, int whence)](https://man7.org/linux/man-pages/man2/lseek.2.html)
- * - [read(int fd, void\* buf, size_t count)](https://man7.org/linux/man-pages/man2/read.2.html) 
- * - [write(int fd, const void\* buf, size_t count)](https://man7.org/linux/man-pages/man2/write.2.html) 
+ * - [read(int fd, void\* buf, size_t count)](https://man7.org/linux/man-pages/man2/read.2.html)
+ * - [write(int fd, const void\* buf, size_t count)](https://man7.org/linux/man-pages/man2/write.2.html)
  * - [close(int fd)](https://man7.org/linux/man-pages/man2/close.2.html)
  *
+ * \param argc Number of arguments of the program.
+ * \param argv Arguments of the program.
+ *
  * \return The following values can be returned:
  *          - [EXIT_SUCCESS](https://man7.org/linux/man-pages/man3/exit.3.html)
  *            in case of success
- *          - [EXIT_FAILURE](https://man7.org/linux/man-pages/man3/exit.3.html) 
+ *          - [EXIT_FAILURE](https://man7.org/linux/man-pages/man3/exit.3.html)
  *            in case of error
  */
-int main(void)
+int main(int argc, char** argv)
 {
+    DisplayMode     mode = exit_on_argv_error(argc, argv);
     int             fd;
     off_t           file_size;
-    unsigned int    value_numeric;
-    char            value_string[64];
-    size_t          pos;
     off_t           seek_result;
-    ssize_t         rw_result;
-    
+
     fd = open(FNAME, O_RDONLY);
     exit_on_error(fd < 0);
-   
+
     /* Get the file size */
 
     file_size = lseek(fd, 0, SEEK_END);
     exit_on_error(file_size < 0);
-    
+
     /* Go back to the begining of the file */
 
     seek_result = lseek(fd, 0, SEEK_SET);
@@ -112,65 +168,128 @@ int main(void)
 
     /* Display the content of the file */
 
-    for (off_t i = 0; i < file_size; i += sizeof(unsigned int))
+    if (mode == DISPLAY_MODE_MMAP)
     {
-        rw_result = read(fd, &value_numeric, sizeof(unsigned int));
-        exit_on_error(rw_result < 0);
-        
-        pos = uint_to_string(value_string, value_numeric);
-        while (pos)
-        {
-            rw_result = write(STDOUT_FILENO, &value_string[pos], sizeof(char));
-            exit_on_error(rw_result < 0);
-            --pos;
-        }
+        print_with_mmap(fd, file_size);
+    }
+    else
+    {
+        print_with_read(fd, file_size);
     }
 
     fd = close(fd);
     exit_on_error(fd < 0);
 
-    return EXIT_SUCCESS;   
+    return EXIT_SUCCESS;
 }
 
 
-void exit_on_error(int assertion)
+void use(const char* program)
 {
-    if (assertion)
+    fprintf(stderr, "Use:\n  %s [-m <read|mmap>]\n", program);
+    exit(EXIT_FAILURE);
+}
+
+DisplayMode exit_on_argv_error(int argc, char** argv)
+{
+    if (argc == 1)
     {
-        if (errno) 
-        {
-            fprintf(stderr, "[%d]: %s\n", errno, strerror(errno));
-            exit(EXIT_FAILURE);
-        }
-        
-        fprintf(stderr, "An error occured!\n");
-        exit(EXIT_FAILURE);
+        return DISPLAY_MODE_READ;
+    }
+
+    if (argc != 3 || strcmp(argv[1], "-m") != 0)
+    {
+        use(argv[0]);
+    }
+
+    if (strcmp(argv[2], "read") == 0)
+    {
+        return DISPLAY_MODE_READ;
+    }
+
+    if (strcmp(argv[2], "mmap") != 0)
+    {
+        use(argv[0]);
+    }
+
+    return DISPLAY_MODE_MMAP;
+}
+
+void print_with_read(int fd, off_t file_size)
+{
+    unsigned int    value_numeric;
+    char            value_string[UINT_TEXT_LENGTH];
+    size_t          length;
+    ssize_t         rw_result;
+
+    for (off_t i = 0; i < file_size; i += sizeof(unsigned int))
+    {
+        rw_result = read(fd, &value_numeric, sizeof(unsigned int));
+        exit_on_error(rw_result < 0);
+
+        length = uint_to_chars(value_string, value_numeric);
+        value_string[length++] = '\n';
+
+        rw_result = write_full(STDOUT_FILENO, value_string, length);
+        exit_on_error(rw_result < 0);
     }
 }
 
-size_t uint_to_string(char* buffer, unsigned int value)
+void print_with_mmap(int fd, off_t file_size)
 {
-    unsigned int    digit;
-    size_t count    = 2;
-    buffer[0]       = '\0';
-    buffer[1]       = '\n'; 
-    while (value)
+    const unsigned int* values;
+    IoWriter            writer;
+    char*               room;
+    size_t              count = file_size / sizeof(unsigned int);
+    size_t              tail = file_size % sizeof(unsigned int);
+    size_t              batch = OUTPUT_BUFFER_SIZE / UINT_TEXT_LENGTH;
+    size_t              length;
+    unsigned int        value;
+    int                 result;
+
+    if (file_size == 0)
     {
-        digit = value % 0xA;
-        buffer[count] = '0' + digit;
-        value /= 0xA;
-        ++count;
+        return;
     }
 
-    if (count == 2)
+    values = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    exit_on_error(values == MAP_FAILED);
+
+    result = madvise((void*)values, file_size, MADV_SEQUENTIAL);
+    exit_on_error(result < 0);
+
+    result = io_writer_open(&writer, STDOUT_FILENO, OUTPUT_BUFFER_SIZE);
+    exit_on_error(result < 0);
+
+    /* Convert as many natural numbers as the buffer can hold */
+
+    for (size_t i = 0; i < count; i += batch)
     {
-        buffer[2] = '0';
+        room = io_writer_reserve(&writer, batch * UINT_TEXT_LENGTH);
+        exit_on_error(room == NULL);
+
+        length = uints_to_text(room, &values[i],
+                               count - i < batch ? count - i : batch, '\n');
+        io_writer_commit(&writer, length);
     }
-    else
+
+    /* A short read only replaces the first bytes */
+
+    if (tail > 0)
     {
-        --count;
+        value = count > 0 ? values[count - 1] : 0;
+        memcpy(&value, &values[count], tail);
+
+        room = io_writer_reserve(&writer, UINT_TEXT_LENGTH);
+        exit_on_error(room == NULL);
+
+        length = uints_to_text(room, &value, 1, '\n');
+        io_writer_commit(&writer, length);
     }
 
-    return count;
-}
+    result = io_writer_close(&writer);
+    exit_on_error(result < 0);
 
+    result = munmap((void*)values, file_size);
+    exit_on_error(result < 0);
+}
@@ -14,7 +14,7 @@
  * - [close(int fd)](https://man7.org/linux/man-pages/man2/close.2.html)  
  *
  * \author H. Decoudras
- * \version 1
+ * \version 2
  */
 
 #include <sys/types.h>
@@ -27,6 +27,9 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "convert.h"
+#include "prsio.h"
+
 
 /*!
  * \brief The use() function displays how to use the
@@ -52,37 +55,6 @@ static void use(const char* program);
  */
 static void exit_on_argv_error(int argc, char** argv);
 
-/*!
- * \brief The exit_on_error() function exits the program
- *        if the \p assertion parameter is evaluated
- *        to `TRUE`.
- *
- * If the assertion is evaluated to `TRUE` and 
- * [errno](https://man7.org/linux/man-pages/man3/errno.3.html)
- * is set, then the error number and its associated message
- * are displayed. Otherwise, a generic message is displayed. 
- *
- * \param assertion Assertion to be evaluated.
- */
-static void exit_on_error(int assertion);
-
-
-/*!
- * \brief The uint_to_string() function converts a natural
- *        number into a string representation.
- *
- *        The string representation of the natural number 
- *        is stored in the \p buffer parameter and is
- *        inverted.
- *
- * \param buffer String representation of the natural number.
- * \param value Natural number to convert.
- *
- * \return The length of the string, including the null 
- *         terminating caracter.
- */
-static size_t uint_to_string(char* buffer, unsigned int value);
-
 
 /*!
  * \brief Main entry point of the program.
@@ -113,8 +85,8 @@ int main(int argc, char** argv)
     int             fd;
     off_t           offset = atoi(argv[2]);
     unsigned int    value_numeric;
-    char            value_string[64];
-    size_t          pos;
+    char            value_string[UINT_TEXT_LENGTH];
+    size_t          length;
     off_t           seek_result;
     ssize_t         rw_result;
 
@@ -128,7 +100,7 @@ int main(int argc, char** argv)
     seek_result = lseek(fd, offset * sizeof(unsigned int), SEEK_SET);
     exit_on_error(seek_result < 0);
     
-    rw_result = read(fd, &value_numeric, sizeof(unsigned int));
+    rw_result = read_full(fd, &value_numeric, sizeof(unsigned int));
     exit_on_error(rw_result < 0);
     
     /* Close the file */
@@ -138,13 +110,11 @@ int main(int argc, char** argv)
    
     /* Display the number */
 
-    pos = uint_to_string(value_string, value_numeric);
-    while (pos)
-    {
-        rw_result = write(STDOUT_FILENO, &value_string[pos], sizeof(char));
-        exit_on_error(rw_result < 0);
-        --pos;
-    }
+    length = uint_to_chars(value_string, value_numeric);
+    value_string[length++] = '\n';
+
+    rw_result = write_full(STDOUT_FILENO, value_string, length);
+    exit_on_error(rw_result < 0);
     
     return EXIT_SUCCESS;   
 }
@@ -163,45 +133,3 @@ void exit_on_argv_error(int argc, char** argv)
         use(argv[0]);
     }
 }
-
-void exit_on_error(int assertion)
-{
-    if (assertion)
-    {
-        if (errno) 
-        {
-            fprintf(stderr, "[%d]: %s\n", errno, strerror(errno));
-            exit(EXIT_FAILURE);
-        }
-        
-        fprintf(stderr, "An error occured!\n");
-        exit(EXIT_FAILURE);
-    }
-}
-
-size_t uint_to_string(char* buffer, unsigned int value)
-{
-    unsigned int    digit;
-    size_t          count = 2;
-    buffer[0]       = '\0';
-    buffer[1]       = '\n';
-    while (value)
-    {
-        digit = value % 0xA;
-        buffer[count] = '0' + digit;
-        value /= 0xA;
-        ++count;
-    }
-
-    if (count == 2)
-    {
-        buffer[2] = '0';
-    }
-    else
-    {
-        --count;
-    }
-
-    return count;
-}
-
@@ -3,22 +3,34 @@
  * \file uintgen.c
  * \brief Exercise 1.2
  *
- * Generates the `uintgen.bin` file representing natural numbers. 
- * 
+ * Generates the `uintgen.bin` file representing natural numbers.
+ *
  * This program uses the following system calls:
  *
  * - [open(const char\* pathname, int flags, mode_t mode)](https://man7.org/linux/man-pages/man2/open.2.html)
- * - [write(int fd, const void\* buf, size_t count)](https://man7.org/linux/man-pages/man2/write.2.html) 
- * - [close(int fd)](https://man7.org/linux/man-pages/man2/close.2.html) 
+ * - [write(int fd, const void\* buf, size_t count)](https://man7.org/linux/man-pages/man2/write.2.html)
+ * - [lseek(int fd, off_t offset, int whence)](https://man7.org/linux/man-pages/man2/lseek.2.html)
+ * - [close(int fd)](https://man7.org/linux/man-pages/man2/close.2.html)
+ *
+ * Large files are generated by several threads relying on the
+ * following functions:
+ *
+ * - [fallocate(int fd, int mode, off_t offset, off_t len)](https://man7.org/linux/man-pages/man2/fallocate.2.html)
+ * - [pwrite(int fd, const void\* buf, size_t count, off_t offset)](https://man7.org/linux/man-pages/man2/pwrite.2.html)
+ * - [pthread_create(pthread_t\* thread, const pthread_attr_t\* attr, void\* (\*start_routine)(void\*), void\* arg](https://man7.org/linux/man-pages/man3/pthread_create.3.html)
+ * - [pthread_join(pthread_t thread, void\*\* retval)](https://man7.org/linux/man-pages/man3/pthread_join.3.html)
  *
  * \author H. Decoudras
- * \version 1
+ * \version 3
  */
 
+#define _GNU_SOURCE
+
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <errno.h>
 
 #include <stdlib.h>
@@ -26,12 +38,66 @@
 #include <string.h>
 #include <ctype.h>
 
+#include "prsio.h"
+
 
 /*!
  * \brief File name.
  */
 #define FNAME "./uintgen.bin"
 
+/*!
+ * \brief Number of natural numbers filled in memory before
+ *        being written with a single call.
+ */
+#define CHUNK_COUNT (1 << 20)
+
+/*!
+ * \brief Default number of threads.
+ */
+#define DEFAULT_THREADS 1
+
+/*!
+ * \brief Maximum number of threads.
+ */
+#define MAX_THREADS 256
+
+/*!
+ * \brief Minimum number of natural numbers given to each
+ *        thread, smaller files are generated by a single
+ *        thread.
+ */
+#define MIN_THREAD_COUNT ((unsigned int)CHUNK_COUNT * 4)
+
+
+/*!
+ * \struct partition
+ * \brief Range of natural numbers written by a thread.
+ */
+typedef struct partition
+{
+    /*!
+     * \brief Output file descriptor.
+     */
+    int fd;
+
+    /*!
+     * \brief Whether the output file can be written at any offset,
+     *        otherwise the range is written in sequence.
+     */
+    int seekable;
+
+    /*!
+     * \brief First natural number of the range.
+     */
+    unsigned int first;
+
+    /*!
+     * \brief Natural number following the range.
+     */
+    unsigned int last;
+} Partition;
+
 
 /*!
  * \brief The use() function displays how to use the
@@ -52,36 +118,53 @@ static void use(const char* progam);
  *
  * \param argc Number of arguments of the program.
  * \param argv Arguments of the program.
+ * \param path Set to the path of the output file.
+ * \param threads Set to the number of threads.
  *
  * \see use()
  */
-static void exit_on_argv_error(int argc, char** argv);
+static void exit_on_argv_error(int argc, char** argv,
+                               const char** path, long* threads);
 
 /*!
- * \brief The exit_on_error() function exits the program
- *        if the \p assertion parameter is evaluated
- *        to `TRUE`.
+ * \brief The is_digits() function determines if a string is
+ *        a non-empty sequence of digits.
  *
- * If the assertion is evaluated to `TRUE` and 
- * [errno](https://man7.org/linux/man-pages/man3/errno.3.html)
- * is set, then the error number and its associated message
- * are displayed. Otherwise, a generic message is displayed. 
+ * \param string String to check.
  *
- * \param assertion Assertion to be evaluated.
+ * \return **1** if the string only contains digits, **0**
+ *         otherwise.
  */
-static void exit_on_error(int assertion);
+static int is_digits(const char* string);
+
+/*!
+ * \brief The write_partition() function writes a range of
+ *        natural numbers at their offset in the output file.
+ *
+ *        The numbers are filled in chunks of \ref CHUNK_COUNT
+ *        and each chunk is written with
+ *        [pwrite(int fd, const void\* buf, size_t count, off_t offset)](https://man7.org/linux/man-pages/man2/pwrite.2.html),
+ *        or in sequence with write_full() when the output file
+ *        is a pipe or a terminal.
+ *
+ * \param p A pointer to a \ref partition structure.
+ *
+ * \return `NULL`.
+ */
+static void* write_partition(void* p);
 
 
 /*!
  * \brief Main entry point of the program.
  *
- * Generates the `uintgen.bin` file representing natural numbers. 
- * 
+ * Generates the `uintgen.bin` file representing natural numbers.
+ *
  * This program uses the following system calls:
  *
  * - [open(const char\* pathname, int flags, mode_t mode)](https://man7.org/linux/man-pages/man2/open.2.html)
- * - [write(int fd, const void\* buf, size_t count)](https://man7.org/linux/man-pages/man2/write.2.html) 
- * - [close(int fd)](https://man7.org/linux/man-pages/man2/close.2.html) 
+ * - [write(int fd, const void\* buf, size_t count)](https://man7.org/linux/man-pages/man2/write.2.html)
+ * - [lseek(int fd, off_t offset, int whence)](https://man7.org/linux/man-pages/man2/lseek.2.html)
+ * - [close(int fd)](https://man7.org/linux/man-pages/man2/close.2.html)
  *
  * \param argc Number of arguments of the program.
  * \param argv Arguments of the program.
@@ -89,33 +172,90 @@ static void exit_on_error(int assertion);
  * \return The following values can be returned:
  *          - [EXIT_SUCCESS](https://man7.org/linux/man-pages/man3/exit.3.html)
  *            in case of success
- *          - [EXIT_FAILURE](https://man7.org/linux/man-pages/man3/exit.3.html) 
+ *          - [EXIT_FAILURE](https://man7.org/linux/man-pages/man3/exit.3.html)
  *            in case of error
  */
 int main(int argc, char** argv)
 {
-    exit_on_argv_error(argc, argv);
+    const char*     path = FNAME;
+    long            threads = DEFAULT_THREADS;
+
+    exit_on_argv_error(argc, argv, &path, &threads);
 
     int             fd;
-    unsigned int    n = strtoul(argv[1], NULL, 10);
-    ssize_t         rw_result;
+    unsigned int    n = strtoul(argv[optind], NULL, 10);
+    pthread_t       ids[MAX_THREADS];
+    Partition       partitions[MAX_THREADS];
+    off_t           file_size = (off_t)n * sizeof(unsigned int);
+    int             seekable;
+    int             result;
 
-    /* 
+    /*
         Open the output file in write only mode
 
         Create the file if it does not exist and trunc
         its content
     */
 
-    fd = open(FNAME, O_CREAT | O_WRONLY | O_TRUNC, 0666);
+    fd = open(path, O_CREAT | O_WRONLY | O_TRUNC, 0666);
     exit_on_error(fd < 0);
-   
+
+    /* A pipe or a terminal can only be written by a single thread */
+
+    seekable = lseek(fd, 0, SEEK_CUR) >= 0;
+    exit_on_error(!seekable && errno != ESPIPE);
+
+    if (!seekable)
+    {
+        threads = 1;
+    }
+
+    /* Small files are not worth a thread */
+
+    if (n / MIN_THREAD_COUNT < (unsigned long)threads)
+    {
+        threads = n / MIN_THREAD_COUNT > 0 ? n / MIN_THREAD_COUNT : 1;
+    }
+
+    /* Reserve the whole file so that the threads can write anywhere */
+
+    if (threads > 1)
+    {
+        result = fallocate(fd, 0, 0, file_size);
+        if (result < 0)
+        {
+            exit_on_error(errno != EOPNOTSUPP && errno != ENOSYS);
+
+            result = ftruncate(fd, file_size);
+            exit_on_error(result < 0);
+        }
+    }
+
     /* Write to the file */
 
-    for (unsigned int i = 0; i < n; ++i)
+    for (long i = 0; i < threads; ++i)
+    {
+        partitions[i].fd = fd;
+        partitions[i].seekable = seekable;
+        partitions[i].first = (unsigned long long)n * i / threads;
+        partitions[i].last = (unsigned long long)n * (i + 1) / threads;
+    }
+
+    for (long i = 1; i < threads; ++i)
+    {
+        result = pthread_create(&ids[i], NULL, write_partition,
+                                &partitions[i]);
+        errno = result;
+        exit_on_error(result != 0);
+    }
+
+    write_partition(&partitions[0]);
+
+    for (long i = 1; i < threads; ++i)
     {
-        rw_result = write(fd, &i, sizeof(unsigned int));
-        exit_on_error(rw_result < 0);
+        result = pthread_join(ids[i], NULL);
+        errno = result;
+        exit_on_error(result != 0);
     }
 
     /* Close the file */
@@ -123,45 +263,127 @@ int main(int argc, char** argv)
     fd = close(fd);
     exit_on_error(fd < 0);
 
-    return EXIT_SUCCESS;   
+    return EXIT_SUCCESS;
 }
 
 
-void use(const char* program) 
+void use(const char* program)
 {
-   fprintf(stderr, "Use:\n  %s <number_of_natural_numbers>\n", program);
+   fprintf(stderr, "Use:\n  %s [-o <filename>] [-t <threads [<=%d]>] "
+           "<number_of_natural_numbers>\n", program, MAX_THREADS);
    exit(EXIT_FAILURE);
 }
 
-void exit_on_argv_error(int argc, char** argv)
+void exit_on_argv_error(int argc, char** argv,
+                        const char** path, long* threads)
 {
-    if (argc != 2)
+    int option;
+
+    while ((option = getopt(argc, argv, "o:t:")) != -1)
+    {
+        switch (option)
+        {
+            case 'o':
+            {
+                *path = optarg;
+                break;
+            }
+
+            case 't':
+            {
+                if (!is_digits(optarg))
+                {
+                    use(argv[0]);
+                }
+
+                *threads = strtol(optarg, NULL, 10);
+                if (*threads < 1 || *threads > MAX_THREADS)
+                {
+                    use(argv[0]);
+                }
+
+                break;
+            }
+
+            default:
+            {
+                use(argv[0]);
+            }
+        }
+    }
+
+    if (argc - optind != 1 || !is_digits(argv[optind]))
     {
         use(argv[0]);
     }
+}
 
-    size_t len = strlen(argv[1]);
+int is_digits(const char* string)
+{
+    size_t len = strlen(string);
     for (size_t i = 0; i < len; ++i)
     {
-        if (!isdigit(argv[1][i]))
+        if (!isdigit(string[i]))
         {
-            use(argv[0]);
+            return 0;
         }
     }
+
+    return len > 0;
 }
 
-void exit_on_error(int assertion)
+void* write_partition(void* p)
 {
-    if (assertion)
+    Partition*      partition = (Partition*)p;
+    unsigned int*   chunk;
+    unsigned int    count;
+    size_t          length;
+    off_t           offset;
+    ssize_t         rw_result;
+
+    chunk = malloc(CHUNK_COUNT * sizeof(unsigned int));
+    exit_on_error(chunk == NULL);
+
+    for (unsigned int i = partition->first; i < partition->last; i += count)
     {
-        if (errno) 
+        /* Fill the chunk in memory */
+
+        count = partition->last - i < CHUNK_COUNT ?
+                    partition->last - i : CHUNK_COUNT;
+
+        for (unsigned int j = 0; j < count; ++j)
+        {
+            chunk[j] = i + j;
+        }
+
+        length = (size_t)count * sizeof(unsigned int);
+
+        if (!partition->seekable)
         {
-            fprintf(stderr, "[%d]: %s\n", errno, strerror(errno));
-            exit(EXIT_FAILURE);
+            rw_result = write_full(partition->fd, chunk, length);
+            exit_on_error(rw_result < 0);
+            continue;
+        }
+
+        /* Write it at its offset, resuming after short writes */
+
+        offset = (off_t)i * sizeof(unsigned int);
+
+        for (size_t written = 0; written < length; written += rw_result)
+        {
+            rw_result = pwrite(partition->fd, (char*)chunk + written,
+                               length - written, offset + written);
+            if (rw_result < 0 && errno == EINTR)
+            {
+                rw_result = 0;
+                continue;
+            }
+
+            exit_on_error(rw_result < 0);
         }
-        
-        fprintf(stderr, "An error occured!\n");
-        exit(EXIT_FAILURE);
     }
-}
 
+    free(chunk);
+
+    return NULL;
+}
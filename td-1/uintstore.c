@@ -0,0 +1,604 @@
+/*!
+ * \ingroup td_1_group
+ * \file uintstore.c
+ * \brief Exercise 1.3
+ *
+ * Serves batches of reads and writes of natural numbers in a file
+ * mapped once in memory.
+ *
+ * The requests are read line by line from the standard input, or
+ * from the clients of a UNIX socket, and each one is answered by a
+ * single line:
+ *
+ * | Request                           | Answer                       |
+ * | :-------------------------------- | :--------------------------- |
+ * | `get <offset> [<offset> ...]`     | The values, space-separated. |
+ * | `set <offset> <value> [...]`      | `ok`                         |
+ * | `sync`                            | `ok`                         |
+ *
+ * An invalid request is answered by `error <message>`.
+ *
+ * This program uses the following system calls:
+ *
+ * - [open(const char\* pathname, int flags, mode_t mode)](https://man7.org/linux/man-pages/man2/open.2.html)
+ * - [mmap(void\* addr, size_t length, int prot, int flags, int fd, off_t offset)](https://man7.org/linux/man-pages/man2/mmap.2.html)
+ * - [madvise(void\* addr, size_t length, int advice)](https://man7.org/linux/man-pages/man2/madvise.2.html)
+ * - [msync(void\* addr, size_t length, int flags)](https://man7.org/linux/man-pages/man2/msync.2.html)
+ * - [socket(int domain, int type, int protocol)](https://man7.org/linux/man-pages/man2/socket.2.html)
+ * - [lstat(const char\* pathname, struct stat\* statbuf)](https://man7.org/linux/man-pages/man2/lstat.2.html)
+ * - [unlink(const char\* pathname)](https://man7.org/linux/man-pages/man2/unlink.2.html)
+ * - [bind(int sockfd, const struct sockaddr\* addr, socklen_t addrlen)](https://man7.org/linux/man-pages/man2/bind.2.html)
+ * - [listen(int sockfd, int backlog)](https://man7.org/linux/man-pages/man2/listen.2.html)
+ * - [accept(int sockfd, struct sockaddr\* addr, socklen_t\* addrlen)](https://man7.org/linux/man-pages/man2/accept.2.html)
+ *
+ * \author H. Decoudras
+ * \version 2
+ */
+
+#define _GNU_SOURCE
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "prsio.h"
+
+
+/*!
+ * \brief Maximum number of offsets of a batch.
+ */
+#define MAX_BATCH 65536
+
+/*!
+ * \brief Maximum number of pending connections on the socket.
+ */
+#define SOCKET_BACKLOG 16
+
+
+/*!
+ * \struct uint_store
+ * \brief File of natural numbers mapped in memory.
+ */
+typedef struct uint_store
+{
+    /*!
+     * \brief Mapped natural numbers.
+     */
+    unsigned int* values;
+
+    /*!
+     * \brief Number of natural numbers.
+     */
+    size_t count;
+
+    /*!
+     * \brief Size of the mapping in bytes.
+     */
+    size_t size;
+} UintStore;
+
+/*!
+ * \brief Set by the signal handler to stop serving clients.
+ */
+static volatile sig_atomic_t stopped = 0;
+
+
+/*!
+ * \brief The use() function displays how to use the
+ *        program.
+ *
+ *        This function always exits the program.
+ *
+ * \param program Name of the program.
+ */
+static void use(const char* program);
+
+/*!
+ * \brief The exit_on_argv_error() function exits the
+ *        program if the provided arguments are not
+ *        valid.
+ *
+ *        This function calls the use() one.
+ *
+ * \param argc Number of arguments of the program.
+ * \param argv Arguments of the program.
+ *
+ * \return The path of the UNIX socket, or `NULL` to serve
+ *         the standard input.
+ *
+ * \see use()
+ */
+static const char* exit_on_argv_error(int argc, char** argv);
+
+/*!
+ * \brief The on_signal() function stops serving clients.
+ *
+ * \param signum Number of the received signal.
+ */
+static void on_signal(int signum);
+
+/*!
+ * \brief The open_store() function maps a file of natural
+ *        numbers in memory.
+ *
+ * \param store Store to initialize.
+ * \param filename Name of the file.
+ */
+static void open_store(UintStore* store, const char* filename);
+
+/*!
+ * \brief The close_store() function writes back and unmaps a
+ *        store.
+ *
+ * \param store Store to release.
+ */
+static void close_store(UintStore* store);
+
+/*!
+ * \brief The sync_store() function writes back the modified
+ *        pages of a store.
+ *
+ * \param store A mapped store.
+ *
+ * \return The value returned by
+ *         [msync(void\* addr, size_t length, int flags)](https://man7.org/linux/man-pages/man2/msync.2.html).
+ */
+static int sync_store(UintStore* store);
+
+/*!
+ * \brief The prefetch() function advises the kernel that the
+ *        pages holding the offsets of a batch will be needed.
+ *
+ *        Consecutive offsets in the same page are advised once.
+ *
+ * \param store A mapped store.
+ * \param offsets Offsets of the batch.
+ * \param count Number of offsets.
+ * \param stride Distance between two offsets in \p offsets.
+ */
+static void prefetch(UintStore* store, const size_t* offsets,
+                     size_t count, size_t stride);
+
+/*!
+ * \brief The parse_numbers() function parses the numbers
+ *        following a command.
+ *
+ * \param arguments Space-separated numbers.
+ * \param numbers Parsed numbers, at most \ref MAX_BATCH.
+ *
+ * \return The number of parsed numbers, or **-1** if one of
+ *         them is not valid.
+ */
+static ssize_t parse_numbers(char* arguments, size_t* numbers);
+
+/*!
+ * \brief The serve_request() function serves a request and
+ *        writes its answer.
+ *
+ * \param store A mapped store.
+ * \param line Request, without its line feed.
+ * \param out Stream of the answer.
+ * \param numbers Buffer of \ref MAX_BATCH numbers.
+ */
+static void serve_request(UintStore* store, char* line, FILE* out,
+                          size_t* numbers);
+
+/*!
+ * \brief The serve_stream() function serves the requests of a
+ *        stream until its end.
+ *
+ * \param store A mapped store.
+ * \param in Stream of the requests.
+ * \param out Stream of the answers.
+ */
+static void serve_stream(UintStore* store, FILE* in, FILE* out);
+
+/*!
+ * \brief The serve_socket() function serves the clients of a
+ *        UNIX socket, one after the other, until a signal
+ *        stops the program.
+ *
+ * \param store A mapped store.
+ * \param path Path of the socket.
+ */
+static void serve_socket(UintStore* store, const char* path);
+
+
+/*!
+ * \brief Main entry point of the program.
+ *
+ * Serves batches of reads and writes of natural numbers in a file
+ * mapped once in memory.
+ *
+ * \param argc Number of arguments of the program.
+ * \param argv Arguments of the program.
+ *
+ * \return The following values can be returned:
+ *          - [EXIT_SUCCESS](https://man7.org/linux/man-pages/man3/exit.3.html)
+ *            in case of success
+ *          - [EXIT_FAILURE](https://man7.org/linux/man-pages/man3/exit.3.html)
+ *            in case of error
+ */
+int main(int argc, char** argv)
+{
+    const char*         path = exit_on_argv_error(argc, argv);
+    UintStore           store;
+    struct sigaction    action;
+    int                 result;
+
+    /* Stop cleanly on interruption, ignore disconnected clients */
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_signal;
+
+    result = sigaction(SIGINT, &action, NULL);
+    exit_on_error(result < 0);
+
+    result = sigaction(SIGTERM, &action, NULL);
+    exit_on_error(result < 0);
+
+    action.sa_handler = SIG_IGN;
+    result = sigaction(SIGPIPE, &action, NULL);
+    exit_on_error(result < 0);
+
+    /* Map the file once and serve the requests */
+
+    open_store(&store, argv[optind]);
+
+    if (path != NULL)
+    {
+        serve_socket(&store, path);
+    }
+    else
+    {
+        serve_stream(&store, stdin, stdout);
+    }
+
+    close_store(&store);
+
+    return EXIT_SUCCESS;
+}
+
+
+void use(const char* program)
+{
+    fprintf(stderr, "Use:\n  %s [-s <socket_path>] <filename>\n", program);
+    exit(EXIT_FAILURE);
+}
+
+const char* exit_on_argv_error(int argc, char** argv)
+{
+    const char* path = NULL;
+    int         option;
+
+    while ((option = getopt(argc, argv, "s:")) != -1)
+    {
+        if (option != 's')
+        {
+            use(argv[0]);
+        }
+
+        path = optarg;
+    }
+
+    if (argc - optind != 1)
+    {
+        use(argv[0]);
+    }
+
+    return path;
+}
+
+void on_signal(int signum)
+{
+    (void)signum;
+    stopped = 1;
+}
+
+void open_store(UintStore* store, const char* filename)
+{
+    struct stat st;
+    int         fd;
+    int         result;
+
+    fd = open(filename, O_RDWR);
+    exit_on_error(fd < 0);
+
+    result = fstat(fd, &st);
+    exit_on_error(result < 0);
+
+    store->size = st.st_size;
+    store->count = st.st_size / sizeof(unsigned int);
+    store->values = NULL;
+
+    if (store->count > 0)
+    {
+        store->values = mmap(NULL, store->size, PROT_READ | PROT_WRITE,
+                             MAP_SHARED, fd, 0);
+        exit_on_error(store->values == MAP_FAILED);
+
+        /* The accesses are random, do not read ahead */
+
+        result = madvise(store->values, store->size, MADV_RANDOM);
+        exit_on_error(result < 0);
+    }
+
+    /* The mapping keeps the file */
+
+    result = close(fd);
+    exit_on_error(result < 0);
+}
+
+void close_store(UintStore* store)
+{
+    int result;
+
+    if (store->values == NULL)
+    {
+        return;
+    }
+
+    result = sync_store(store);
+    exit_on_error(result < 0);
+
+    result = munmap(store->values, store->size);
+    exit_on_error(result < 0);
+}
+
+int sync_store(UintStore* store)
+{
+    if (store->values == NULL)
+    {
+        return 0;
+    }
+
+    return msync(store->values, store->size, MS_SYNC);
+}
+
+void prefetch(UintStore* store, const size_t* offsets, size_t count,
+              size_t stride)
+{
+    size_t  page_size = sysconf(_SC_PAGESIZE);
+    size_t  page;
+    size_t  previous = (size_t)-1;
+
+    for (size_t i = 0; i < count; i += stride)
+    {
+        page = offsets[i] * sizeof(unsigned int) / page_size;
+        if (page == previous)
+        {
+            continue;
+        }
+
+        /* A failed hint does not prevent the access */
+
+        madvise((char*)store->values + page * page_size, page_size,
+                MADV_WILLNEED);
+        previous = page;
+    }
+}
+
+ssize_t parse_numbers(char* arguments, size_t* numbers)
+{
+    char*               token;
+    char*               end;
+    char*               state;
+    unsigned long long  number;
+    ssize_t             count = 0;
+
+    for (token = strtok_r(arguments, " \t", &state);
+         token != NULL;
+         token = strtok_r(NULL, " \t", &state))
+    {
+        if (count == MAX_BATCH || *token == '-')
+        {
+            return -1;
+        }
+
+        errno = 0;
+        number = strtoull(token, &end, 10);
+        if (errno != 0 || *end != '\0' || end == token)
+        {
+            return -1;
+        }
+
+        numbers[count++] = number;
+    }
+
+    return count;
+}
+
+void serve_request(UintStore* store, char* line, FILE* out,
+                   size_t* numbers)
+{
+    char*   arguments = strchr(line, ' ');
+    ssize_t count = 0;
+
+    if (arguments != NULL)
+    {
+        *arguments++ = '\0';
+        count = parse_numbers(arguments, numbers);
+        if (count < 0)
+        {
+            fprintf(out, "error invalid numbers\n");
+            return;
+        }
+    }
+
+    if (strcmp(line, "get") == 0)
+    {
+        for (ssize_t i = 0; i < count; ++i)
+        {
+            if (numbers[i] >= store->count)
+            {
+                fprintf(out, "error offset out of range\n");
+                return;
+            }
+        }
+
+        prefetch(store, numbers, count, 1);
+
+        for (ssize_t i = 0; i < count; ++i)
+        {
+            fprintf(out, i == 0 ? "%u" : " %u", store->values[numbers[i]]);
+        }
+
+        fputc('\n', out);
+    }
+    else if (strcmp(line, "set") == 0)
+    {
+        if (count % 2 != 0)
+        {
+            fprintf(out, "error missing value\n");
+            return;
+        }
+
+        for (ssize_t i = 0; i < count; i += 2)
+        {
+            if (numbers[i] >= store->count || numbers[i + 1] > 0xFFFFFFFFu)
+            {
+                fprintf(out, "error offset or value out of range\n");
+                return;
+            }
+        }
+
+        prefetch(store, numbers, count, 2);
+
+        for (ssize_t i = 0; i < count; i += 2)
+        {
+            store->values[numbers[i]] = numbers[i + 1];
+        }
+
+        fprintf(out, "ok\n");
+    }
+    else if (strcmp(line, "sync") == 0 && count == 0)
+    {
+        if (sync_store(store) < 0)
+        {
+            fprintf(out, "error %s\n", strerror(errno));
+            return;
+        }
+
+        fprintf(out, "ok\n");
+    }
+    else
+    {
+        fprintf(out, "error unknown request\n");
+    }
+}
+
+void serve_stream(UintStore* store, FILE* in, FILE* out)
+{
+    char*   line = NULL;
+    size_t  capacity = 0;
+    ssize_t length;
+    size_t* numbers;
+
+    numbers = malloc(MAX_BATCH * sizeof(size_t));
+    exit_on_error(numbers == NULL);
+
+    while (!stopped && (length = getline(&line, &capacity, in)) > 0)
+    {
+        if (line[length - 1] == '\n')
+        {
+            line[--length] = '\0';
+        }
+
+        serve_request(store, line, out, numbers);
+
+        /* Answer each batch before reading the next one */
+
+        if (fflush(out) == EOF)
+        {
+            break;
+        }
+    }
+
+    free(line);
+    free(numbers);
+}
+
+void serve_socket(UintStore* store, const char* path)
+{
+    struct sockaddr_un  address;
+    int                 fd_socket;
+    int                 fd_client;
+    FILE*               in;
+    FILE*               out;
+    struct stat         st;
+    int                 result;
+
+    exit_on_error(strlen(path) >= sizeof(address.sun_path));
+
+    fd_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    exit_on_error(fd_socket < 0);
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+
+    /* Only a socket left by a previous run is replaced */
+
+    if (lstat(path, &st) == 0)
+    {
+        if (!S_ISSOCK(st.st_mode))
+        {
+            fprintf(stderr, "%s: not a socket\n", path);
+            errno = EADDRINUSE;
+            exit_on_error(1);
+        }
+
+        result = unlink(path);
+        exit_on_error(result < 0);
+    }
+    else
+    {
+        exit_on_error(errno != ENOENT);
+    }
+
+    result = bind(fd_socket, (struct sockaddr*)&address, sizeof(address));
+    exit_on_error(result < 0);
+
+    result = listen(fd_socket, SOCKET_BACKLOG);
+    exit_on_error(result < 0);
+
+    while (!stopped)
+    {
+        fd_client = accept(fd_socket, NULL, NULL);
+        if (fd_client < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        exit_on_error(fd_client < 0);
+
+        /* Separate streams for the requests and the answers */
+
+        in = fdopen(fd_client, "r");
+        exit_on_error(in == NULL);
+
+        out = fdopen(dup(fd_client), "w");
+        exit_on_error(out == NULL);
+
+        serve_stream(store, in, out);
+
+        fclose(in);
+        fclose(out);
+    }
+
+    result = close(fd_socket);
+    exit_on_error(result < 0);
+
+    result = unlink(path);
+    exit_on_error(result < 0);
+}
@@ -0,0 +1,564 @@
+/*!
+ * \ingroup td_1_group
+ * \file uintstoreload.c
+ * \brief Exercise 1.3
+ *
+ * Measures the throughput and the latency of random reads and
+ * writes of natural numbers, either by running the `readuint`
+ * and `writeuint` executables for each access, or by sending
+ * batches of requests to `uintstore`.
+ *
+ * This program uses the following system calls:
+ *
+ * - [fork(void)](https://man7.org/linux/man-pages/man2/fork.2.html)
+ * - [execl(const char\* path, const char\* arg, ...)](https://man7.org/linux/man-pages/man3/exec.3.html)
+ * - [waitpid(pid_t pid, int\* wstatus, int options)](https://man7.org/linux/man-pages/man2/waitpid.2.html)
+ * - [socket(int domain, int type, int protocol)](https://man7.org/linux/man-pages/man2/socket.2.html)
+ * - [connect(int sockfd, const struct sockaddr\* addr, socklen_t addrlen)](https://man7.org/linux/man-pages/man2/connect.2.html)
+ *
+ * \author H. Decoudras
+ * \version 1
+ */
+
+#define _GNU_SOURCE
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+#include "prsio.h"
+
+
+/*!
+ * \brief Default number of accesses.
+ */
+#define DEFAULT_OPERATIONS 10000
+
+/*!
+ * \brief Default number of accesses of a batch sent to
+ *        `uintstore`.
+ */
+#define DEFAULT_BATCH 64
+
+/*!
+ * \brief Maximum number of accesses of a batch, as accepted
+ *        by `uintstore`.
+ */
+#define MAX_BATCH 32768
+
+/*!
+ * \brief Default percentage of writes.
+ */
+#define DEFAULT_WRITES 10
+
+
+/*!
+ * \enum load_mode
+ * \brief Available load modes.
+ */
+typedef enum load_mode
+{
+    /*!
+     * \brief Run `readuint` or `writeuint` for each access.
+     */
+    LOAD_MODE_EXEC,
+
+    /*!
+     * \brief Send batches of requests to `uintstore`.
+     */
+    LOAD_MODE_STORE
+} LoadMode;
+
+/*!
+ * \struct load_options
+ * \brief Options of the load generator.
+ */
+typedef struct load_options
+{
+    /*!
+     * \brief Load mode.
+     */
+    LoadMode mode;
+
+    /*!
+     * \brief Path of the socket of `uintstore`.
+     */
+    const char* path;
+
+    /*!
+     * \brief Number of accesses.
+     */
+    size_t operations;
+
+    /*!
+     * \brief Number of accesses of a batch.
+     */
+    size_t batch;
+
+    /*!
+     * \brief Percentage of writes.
+     */
+    unsigned int writes;
+} LoadOptions;
+
+
+/*!
+ * \brief The use() function displays how to use the
+ *        program.
+ *
+ *        This function always exits the program.
+ *
+ * \param program Name of the program.
+ */
+static void use(const char* program);
+
+/*!
+ * \brief The exit_on_argv_error() function exits the
+ *        program if the provided arguments are not
+ *        valid.
+ *
+ *        This function calls the use() one.
+ *
+ * \param argc Number of arguments of the program.
+ * \param argv Arguments of the program.
+ * \param options Set to the parsed options.
+ *
+ * \see use()
+ */
+static void exit_on_argv_error(int argc, char** argv, LoadOptions* options);
+
+/*!
+ * \brief The parse_count() function parses a positive number
+ *        given to an option.
+ *
+ *        This function calls the use() one if the number is
+ *        not valid.
+ *
+ * \param program Name of the program.
+ * \param string Number to parse.
+ *
+ * \return The parsed number.
+ */
+static size_t parse_count(const char* program, const char* string);
+
+/*!
+ * \brief The now() function reads the monotonic clock.
+ *
+ * \return The current time in seconds.
+ */
+static double now(void);
+
+/*!
+ * \brief The compare_doubles() function compares two latencies
+ *        for
+ *        [qsort(void\* base, size_t nmemb, size_t size, int (\*compar)(const void\*, const void\*))](https://man7.org/linux/man-pages/man3/qsort.3.html).
+ */
+static int compare_doubles(const void* a, const void* b);
+
+/*!
+ * \brief The run_access() function runs `readuint` or
+ *        `writeuint` for a single access and waits for it.
+ *
+ * \param filename File of natural numbers.
+ * \param offset Offset of the natural number.
+ * \param value Value written, or **-1** to read.
+ */
+static void run_access(const char* filename, size_t offset, long value);
+
+/*!
+ * \brief The load_with_exec() function measures the accesses
+ *        made by running an executable for each one.
+ *
+ * \param options Options of the load generator.
+ * \param filename File of natural numbers.
+ * \param count Number of natural numbers of the file.
+ * \param latencies Set to the latency of each access.
+ *
+ * \return The number of latencies.
+ */
+static size_t load_with_exec(const LoadOptions* options,
+                             const char* filename, size_t count,
+                             double* latencies);
+
+/*!
+ * \brief The load_with_store() function measures the accesses
+ *        sent by batches to `uintstore`.
+ *
+ *        Each batch is either a `get` or a `set` request and
+ *        its latency is the one of each of its accesses.
+ *
+ * \param options Options of the load generator.
+ * \param count Number of natural numbers of the file.
+ * \param latencies Set to the latency of each batch.
+ *
+ * \return The number of latencies.
+ */
+static size_t load_with_store(const LoadOptions* options, size_t count,
+                              double* latencies);
+
+
+/*!
+ * \brief Main entry point of the program.
+ *
+ * Measures the throughput and the latency of random reads and
+ * writes of natural numbers.
+ *
+ * \param argc Number of arguments of the program.
+ * \param argv Arguments of the program.
+ *
+ * \return The following values can be returned:
+ *          - [EXIT_SUCCESS](https://man7.org/linux/man-pages/man3/exit.3.html)
+ *            in case of success
+ *          - [EXIT_FAILURE](https://man7.org/linux/man-pages/man3/exit.3.html)
+ *            in case of error
+ */
+int main(int argc, char** argv)
+{
+    LoadOptions options =
+    {
+        LOAD_MODE_EXEC,
+        NULL,
+        DEFAULT_OPERATIONS,
+        DEFAULT_BATCH,
+        DEFAULT_WRITES
+    };
+
+    struct stat st;
+    double*     latencies;
+    size_t      latencies_count;
+    size_t      count;
+    double      start;
+    double      elapsed;
+    int         result;
+
+    exit_on_argv_error(argc, argv, &options);
+
+    result = stat(argv[optind], &st);
+    exit_on_error(result < 0);
+
+    count = st.st_size / sizeof(unsigned int);
+    if (count == 0)
+    {
+        fprintf(stderr, "The file does not hold any natural number!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    latencies = malloc(options.operations * sizeof(double));
+    exit_on_error(latencies == NULL);
+
+    srand(time(NULL));
+
+    /* Run the accesses */
+
+    start = now();
+
+    if (options.mode == LOAD_MODE_STORE)
+    {
+        latencies_count = load_with_store(&options, count, latencies);
+    }
+    else
+    {
+        latencies_count = load_with_exec(&options, argv[optind], count,
+                                         latencies);
+    }
+
+    elapsed = now() - start;
+
+    /* Display the throughput and the latencies */
+
+    qsort(latencies, latencies_count, sizeof(double), compare_doubles);
+
+    fprintf(
+        stdout,
+        "Mode: [%s]\n"
+        "Operations: [%zu]\n"
+        "Elapsed time: [%.3f s]\n"
+        "Throughput: [%.0f ops/s]\n"
+        "Latency p50: [%.1f us]\n"
+        "Latency p99: [%.1f us]\n",
+        options.mode == LOAD_MODE_STORE ? "store" : "exec",
+        options.operations,
+        elapsed,
+        elapsed > 0 ? options.operations / elapsed : 0.0,
+        latencies[latencies_count / 2] * 1e6,
+        latencies[(latencies_count * 99 + 99) / 100 - 1] * 1e6
+    );
+
+    free(latencies);
+
+    return EXIT_SUCCESS;
+}
+
+
+void use(const char* program)
+{
+    fprintf(
+        stderr,
+        "Use:\n  %s [-m <exec|store>] [-s <socket_path>] [-n <operations>] "
+        "[-b <batch [<=%d]>] [-w <writes_percentage>] <filename>\n",
+        program,
+        MAX_BATCH
+    );
+    exit(EXIT_FAILURE);
+}
+
+void exit_on_argv_error(int argc, char** argv, LoadOptions* options)
+{
+    int option;
+
+    while ((option = getopt(argc, argv, "m:s:n:b:w:")) != -1)
+    {
+        switch (option)
+        {
+            case 'm':
+            {
+                if (strcmp(optarg, "exec") == 0)
+                {
+                    options->mode = LOAD_MODE_EXEC;
+                }
+                else if (strcmp(optarg, "store") == 0)
+                {
+                    options->mode = LOAD_MODE_STORE;
+                }
+                else
+                {
+                    use(argv[0]);
+                }
+
+                break;
+            }
+
+            case 's':
+            {
+                options->path = optarg;
+                break;
+            }
+
+            case 'n':
+            {
+                options->operations = parse_count(argv[0], optarg);
+                break;
+            }
+
+            case 'b':
+            {
+                options->batch = parse_count(argv[0], optarg);
+                break;
+            }
+
+            case 'w':
+            {
+                options->writes = strtoul(optarg, NULL, 10);
+                if (!isdigit(optarg[0]) || options->writes > 100)
+                {
+                    use(argv[0]);
+                }
+
+                break;
+            }
+
+            default:
+            {
+                use(argv[0]);
+            }
+        }
+    }
+
+    if (argc - optind != 1 || options->batch > MAX_BATCH ||
+        (options->mode == LOAD_MODE_STORE && options->path == NULL))
+    {
+        use(argv[0]);
+    }
+}
+
+size_t parse_count(const char* program, const char* string)
+{
+    size_t len = strlen(string);
+    for (size_t i = 0; i < len; ++i)
+    {
+        if (!isdigit(string[i]))
+        {
+            use(program);
+        }
+    }
+
+    if (len == 0 || strtoul(string, NULL, 10) == 0)
+    {
+        use(program);
+    }
+
+    return strtoul(string, NULL, 10);
+}
+
+double now(void)
+{
+    struct timespec time;
+    int             result;
+
+    result = clock_gettime(CLOCK_MONOTONIC, &time);
+    exit_on_error(result < 0);
+
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+int compare_doubles(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+
+    return (x > y) - (x < y);
+}
+
+void run_access(const char* filename, size_t offset, long value)
+{
+    char    offset_string[32];
+    char    value_string[32];
+    pid_t   pid;
+    int     status;
+    int     fd;
+
+    snprintf(offset_string, sizeof(offset_string), "%zu", offset);
+    snprintf(value_string, sizeof(value_string), "%ld", value);
+
+    pid = fork();
+    exit_on_error(pid < 0);
+
+    if (pid == 0)
+    {
+        /* The value read is not displayed */
+
+        fd = open("/dev/null", O_WRONLY);
+        exit_on_error(fd < 0);
+
+        fd = dup2(fd, STDOUT_FILENO);
+        exit_on_error(fd < 0);
+
+        if (value < 0)
+        {
+            execl("./readuint", "readuint", filename, offset_string,
+                  (char*)NULL);
+        }
+        else
+        {
+            execl("./writeuint", "writeuint", filename, offset_string,
+                  value_string, (char*)NULL);
+        }
+
+        exit_on_error(1);
+    }
+
+    pid = waitpid(pid, &status, 0);
+    exit_on_error(pid < 0);
+
+    errno = 0;
+    exit_on_error(!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS);
+}
+
+size_t load_with_exec(const LoadOptions* options, const char* filename,
+                      size_t count, double* latencies)
+{
+    double start;
+
+    for (size_t i = 0; i < options->operations; ++i)
+    {
+        start = now();
+
+        run_access(
+            filename,
+            (size_t)rand() % count,
+            (unsigned int)rand() % 100 < options->writes ? rand() : -1
+        );
+
+        latencies[i] = now() - start;
+    }
+
+    return options->operations;
+}
+
+size_t load_with_store(const LoadOptions* options, size_t count,
+                       double* latencies)
+{
+    struct sockaddr_un  address;
+    FILE*               in;
+    FILE*               out;
+    char*               line = NULL;
+    size_t              capacity = 0;
+    size_t              batch;
+    size_t              batches = 0;
+    double              start;
+    int                 fd;
+    int                 result;
+
+    exit_on_error(strlen(options->path) >= sizeof(address.sun_path));
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    exit_on_error(fd < 0);
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, options->path);
+
+    result = connect(fd, (struct sockaddr*)&address, sizeof(address));
+    exit_on_error(result < 0);
+
+    in = fdopen(fd, "r");
+    exit_on_error(in == NULL);
+
+    out = fdopen(dup(fd), "w");
+    exit_on_error(out == NULL);
+
+    for (size_t done = 0; done < options->operations; done += batch)
+    {
+        batch = options->operations - done < options->batch ?
+                    options->operations - done : options->batch;
+
+        /* Send a batch of reads or writes and wait for its answer */
+
+        start = now();
+
+        if ((unsigned int)rand() % 100 < options->writes)
+        {
+            fputs("set", out);
+            for (size_t i = 0; i < batch; ++i)
+            {
+                fprintf(out, " %zu %u", (size_t)rand() % count,
+                        (unsigned int)rand());
+            }
+        }
+        else
+        {
+            fputs("get", out);
+            for (size_t i = 0; i < batch; ++i)
+            {
+                fprintf(out, " %zu", (size_t)rand() % count);
+            }
+        }
+
+        fputc('\n', out);
+        result = fflush(out);
+        exit_on_error(result == EOF);
+
+        errno = 0;
+        exit_on_error(getline(&line, &capacity, in) <= 0);
+        exit_on_error(strncmp(line, "error", 5) == 0);
+
+        latencies[batches++] = now() - start;
+    }
+
+    free(line);
+    fclose(in);
+    fclose(out);
+
+    return batches;
+}
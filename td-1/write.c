@@ -27,6 +27,8 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "prsio.h"
+
 
 /*!
  * \brief The use() function displays how to use the
@@ -52,20 +54,6 @@ static void use(const char* program);
  */
 static void exit_on_argv_error(int argc, char** argv);
 
-/*!
- * \brief The exit_on_error() function exits the program
- *        if the \p assertion parameter is evaluated
- *        to `TRUE`.
- *
- * If the assertion is evaluated to `TRUE` and
- * [errno](https://man7.org/linux/man-pages/man3/errno.3.html)
- * is set, then the error number and its associated message
- * are displayed. Otherwise, a generic message is displayed.
- *
- * \param assertion Assertion to be evaluated.
- */
-static void exit_on_error(int assertion);
-
 
 /*!
  * \brief Main entry point of the program.
@@ -138,18 +126,3 @@ void exit_on_argv_error(int argc, char** argv)
     }
 }
 
-void exit_on_error(int assertion)
-{
-    if (assertion)
-    {
-        if (errno) 
-        {
-            fprintf(stderr, "[%d]: %s\n", errno, strerror(errno));
-            exit(EXIT_FAILURE);
-        }
-        
-        fprintf(stderr, "An error occured!\n");
-        exit(EXIT_FAILURE);
-    }
-}
-
@@ -13,7 +13,7 @@
  * - [close(int fd)](https://man7.org/linux/man-pages/man2/close.2.html) 
  *
  * \author H. Decoudras
- * \version 1
+ * \version 2
  */
 
 #include <sys/types.h>
@@ -26,6 +26,8 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "prsio.h"
+
 
 /*!
  * \brief The use() function displays how to use the
@@ -51,20 +53,6 @@ static void use(const char* program);
  */
 static void exit_on_argv_error(int argc, char** argv);
 
-/*!
- * \brief The exit_on_error() function exits the program
- *        if the \p assertion parameter is evaluated
- *        to `TRUE`.
- *
- * If the assertion is evaluated to `TRUE` and 
- * [errno](https://man7.org/linux/man-pages/man3/errno.3.html)
- * is set, then the error number and its associated message
- * are displayed. Otherwise, a generic message is displayed. 
- *
- * \param assertion Assertion to be evaluated.
- */
-static void exit_on_error(int assertion);
-
 
 /*!
  * \brief Main entry point of the program.
@@ -108,7 +96,7 @@ int main(int argc, char** argv)
     seek_result = lseek(fd, offset * sizeof(unsigned int), SEEK_SET);
     exit_on_error(seek_result < 0);
     
-    rw_result = write(fd, &value_numeric, sizeof(unsigned int));
+    rw_result = write_full(fd, &value_numeric, sizeof(unsigned int));
     exit_on_error(rw_result < 0);
     
     /* Close the file */
@@ -134,18 +122,3 @@ void exit_on_argv_error(int argc, char** argv)
     }
 }
 
-void exit_on_error(int assertion)
-{
-    if (assertion)
-    {
-        if (errno) 
-        {
-            fprintf(stderr, "[%d]: %s\n", errno, strerror(errno));
-            exit(EXIT_FAILURE);
-        }
-        
-        fprintf(stderr, "An error occured!\n");
-        exit(EXIT_FAILURE);
-    }
-}
-
@@ -0,0 +1,574 @@
+/*!
+ * \ingroup td_2_group
+ * \file analysis.c
+ * \brief Exercise 2.5
+ *
+ * Builds the syntax tree of a command line.
+ *
+ * \author H. Decoudras
+ * \version 2
+ */
+
+#include "analysis.h"
+
+#include <string.h>
+
+
+/*!
+ * \enum token_type
+ * \brief The \ref token_type enumeration represents the tokens
+ *        of a command line.
+ */
+enum token_type
+{
+    /*!
+     * \brief End of the command line.
+     */
+    TOKEN_END,
+
+    /*!
+     * \brief Shell command, argument or file name, quoted or not.
+     */
+    TOKEN_IDENTIFIER,
+
+    /*!
+     * \brief `<` redirection.
+     */
+    TOKEN_IN,
+
+    /*!
+     * \brief `>` redirection.
+     */
+    TOKEN_OUT,
+
+    /*!
+     * \brief `>>` redirection.
+     */
+    TOKEN_OUT_APPEND,
+
+    /*!
+     * \brief `2>` redirection.
+     */
+    TOKEN_ERR,
+
+    /*!
+     * \brief `&>` redirection.
+     */
+    TOKEN_ERR_OUT,
+
+    /*!
+     * \brief `;` operator.
+     */
+    TOKEN_SEQUENCE,
+
+    /*!
+     * \brief `&&` operator.
+     */
+    TOKEN_AND,
+
+    /*!
+     * \brief `||` operator.
+     */
+    TOKEN_OR,
+
+    /*!
+     * \brief `|` operator.
+     */
+    TOKEN_PIPE,
+
+    /*!
+     * \brief `&|` operator.
+     */
+    TOKEN_CONCURRENT,
+
+    /*!
+     * \brief `&` operator.
+     */
+    TOKEN_BACKGROUND,
+
+    /*!
+     * \brief Opening parenthesis.
+     */
+    TOKEN_OPEN,
+
+    /*!
+     * \brief Closing parenthesis.
+     */
+    TOKEN_CLOSE,
+
+    /*!
+     * \brief Character which starts no token, or unterminated
+     *        quote.
+     */
+    TOKEN_INVALID
+};
+
+/*!
+ * \brief Type definition of the \ref token_type enumeration.
+ *
+ * \see token_type
+ */
+typedef enum token_type TokenType;
+
+
+/*!
+ * \struct parser
+ * \brief The \ref parser structure holds the state of the parsing
+ *        of a command line.
+ */
+struct parser
+{
+    /*!
+     * \brief Arena the syntax tree is allocated from.
+     */
+    Arena* arena;
+
+    /*!
+     * \brief Next character to scan.
+     */
+    const char* cursor;
+
+    /*!
+     * \brief End of the command line.
+     */
+    const char* end;
+
+    /*!
+     * \brief Current token.
+     */
+    TokenType token;
+
+    /*!
+     * \brief Characters of the current identifier, without its
+     *        quotes.
+     */
+    const char* text;
+
+    /*!
+     * \brief Length of the current identifier.
+     */
+    size_t length;
+
+    /*!
+     * \brief Number of parentheses opened around the current
+     *        token.
+     */
+    int depth;
+};
+
+/*!
+ * \brief Type definition of the \ref parser structure.
+ *
+ * \see parser
+ */
+typedef struct parser Parser;
+
+
+/*!
+ * \brief Characters of the identifiers which are not quoted.
+ */
+static const char identifier_chars[256] =
+{
+    ['-'] = 1, ['+'] = 1, ['.'] = 1, ['$'] = 1, ['%'] = 1, ['='] = 1,
+    ['/'] = 1, ['\\'] = 1, ['*'] = 1, ['?'] = 1,
+    ['0' ... '9'] = 1, ['A' ... 'Z'] = 1, ['a' ... 'z'] = 1
+};
+
+
+/*!
+ * \brief The next_token() function scans the next token of the
+ *        command line.
+ *
+ * \param p Parser.
+ */
+static void next_token(Parser* p);
+
+/*!
+ * \brief The parse_expression() function parses shell commands
+ *        joined by operators which bind at least as tightly as a
+ *        given level.
+ *
+ *        The levels are `0` for `&`, `1` for `;`, `2` for `&|`,
+ *        `3` for `&&` and `||`, and `4` for `|`. The redirections
+ *        bind tighter than any operator.
+ *
+ * \param p Parser.
+ * \param level Loosest level of the operators parsed.
+ *
+ * \return The syntax tree, or `NULL` in case of syntax error.
+ */
+static Expression* parse_expression(Parser* p, int level);
+
+/*!
+ * \brief The parse_primary() function parses a simple shell command
+ *        or shell commands in parentheses.
+ *
+ * \param p Parser.
+ *
+ * \return The syntax tree, or `NULL` in case of syntax error.
+ */
+static Expression* parse_primary(Parser* p);
+
+/*!
+ * \brief The parse_arguments() function copies the identifiers
+ *        which follow into a list of arguments.
+ *
+ *        The identifiers are scanned twice, so that the list and
+ *        the arguments take a single allocation.
+ *
+ * \param p Parser.
+ * \param limit Largest number of identifiers to copy.
+ *
+ * \return The list of arguments, ending with `NULL`.
+ */
+static char** parse_arguments(Parser* p, size_t limit);
+
+/*!
+ * \brief The operator_level() function gets the level of a binary
+ *        operator.
+ *
+ * \param token Token.
+ * \param type Type of the expression the operator builds.
+ *
+ * \return The level of the operator, or `-1` if \p token is not a
+ *         binary operator.
+ */
+static int operator_level(TokenType token, ExpressionType* type);
+
+/*!
+ * \brief The redirection_type() function gets the type of the
+ *        expression a redirection builds.
+ *
+ * \param token Token.
+ * \param type Type of the expression.
+ *
+ * \return `1` if \p token is a redirection, `0` otherwise.
+ */
+static int redirection_type(TokenType token, ExpressionType* type);
+
+/*!
+ * \brief The new_node() function allocates an expression from the
+ *        arena of a parser.
+ *
+ * \param p Parser.
+ * \param type Type of the expression.
+ * \param l Split sub-expression.
+ * \param r Split sub-expression.
+ * \param args Shell command and its arguments.
+ *
+ * \return An allocated \ref expression structure.
+ */
+static Expression* new_node(Parser* p, ExpressionType type,
+                            Expression* l, Expression* r, char** args);
+
+
+int parse_command_line(Arena* arena, const char* line, size_t length,
+                       Expression** e)
+{
+    Parser p;
+
+    p.arena = arena;
+    p.cursor = line;
+    p.end = line + length;
+    p.depth = 0;
+    next_token(&p);
+
+    if (p.token == TOKEN_END)
+    {
+        *e = new_node(&p, EMPTY, NULL, NULL, NULL);
+        return 0;
+    }
+
+    if ((*e = parse_expression(&p, 0)) == NULL || p.token != TOKEN_END)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+
+void next_token(Parser* p)
+{
+    const char* c;
+
+    while (p->cursor < p->end && (*p->cursor == ' ' || *p->cursor == '\t'))
+    {
+        ++p->cursor;
+    }
+
+    if (p->cursor == p->end)
+    {
+        p->token = TOKEN_END;
+        return;
+    }
+
+    c = p->cursor++;
+    switch (*c)
+    {
+        case '"':
+        case '\'':
+        {
+            /* Quoted identifiers run until the same quote */
+
+            p->text = c + 1;
+            if ((c = memchr(p->text, *c, p->end - p->text)) == NULL)
+            {
+                p->token = TOKEN_INVALID;
+                return;
+            }
+
+            p->length = c - p->text;
+            p->cursor = c + 1;
+            p->token = TOKEN_IDENTIFIER;
+            return;
+        }
+
+        case '<':
+        {
+            p->token = TOKEN_IN;
+            return;
+        }
+
+        case '>':
+        {
+            p->token = TOKEN_OUT;
+            if (p->cursor < p->end && *p->cursor == '>')
+            {
+                ++p->cursor;
+                p->token = TOKEN_OUT_APPEND;
+            }
+
+            return;
+        }
+
+        case '&':
+        {
+            p->token = TOKEN_BACKGROUND;
+            if (p->cursor == p->end)
+            {
+                return;
+            }
+
+            switch (*p->cursor)
+            {
+                case '>':  p->token = TOKEN_ERR_OUT;     break;
+                case '&':  p->token = TOKEN_AND;         break;
+                case '|':  p->token = TOKEN_CONCURRENT;  break;
+                default:   return;
+            }
+
+            ++p->cursor;
+            return;
+        }
+
+        case '|':
+        {
+            p->token = TOKEN_PIPE;
+            if (p->cursor < p->end && *p->cursor == '|')
+            {
+                ++p->cursor;
+                p->token = TOKEN_OR;
+            }
+
+            return;
+        }
+
+        case ';':
+        {
+            p->token = TOKEN_SEQUENCE;
+            return;
+        }
+
+        case '(':
+        {
+            p->token = TOKEN_OPEN;
+            return;
+        }
+
+        case ')':
+        {
+            p->token = TOKEN_CLOSE;
+            return;
+        }
+
+        case '2':
+        {
+            /* 2> is longer than the identifier 2 it starts with */
+
+            if (p->cursor < p->end && *p->cursor == '>')
+            {
+                ++p->cursor;
+                p->token = TOKEN_ERR;
+                return;
+            }
+
+            break;
+        }
+    }
+
+    if (!identifier_chars[(unsigned char)*c])
+    {
+        p->token = TOKEN_INVALID;
+        return;
+    }
+
+    while (p->cursor < p->end &&
+           identifier_chars[(unsigned char)*p->cursor])
+    {
+        ++p->cursor;
+    }
+
+    p->text = c;
+    p->length = p->cursor - c;
+    p->token = TOKEN_IDENTIFIER;
+}
+
+Expression* parse_expression(Parser* p, int level)
+{
+    Expression*     left;
+    Expression*     right;
+    ExpressionType  type;
+    int             operator;
+
+    if ((left = parse_primary(p)) == NULL)
+    {
+        return NULL;
+    }
+
+    while (1)
+    {
+        if (redirection_type(p->token, &type))
+        {
+            next_token(p);
+            if (p->token != TOKEN_IDENTIFIER)
+            {
+                return NULL;
+            }
+
+            left = new_node(p, type, left, NULL, parse_arguments(p, 1));
+        }
+        else if ((operator = operator_level(p->token, &type)) >= level)
+        {
+            /* Left associative: the right operand only takes the
+               operators which bind tighter */
+
+            next_token(p);
+            if ((right = parse_expression(p, operator + 1)) == NULL)
+            {
+                return NULL;
+            }
+
+            left = new_node(p, type, left, right, NULL);
+        }
+        else if (p->token == TOKEN_BACKGROUND && level == 0)
+        {
+            next_token(p);
+            left = new_node(p, BACKGROUND, left, NULL, NULL);
+        }
+        else
+        {
+            return left;
+        }
+    }
+}
+
+Expression* parse_primary(Parser* p)
+{
+    Expression* e;
+
+    if (p->token == TOKEN_IDENTIFIER)
+    {
+        return new_node(p, SIMPLE, NULL, NULL, parse_arguments(p, -1));
+    }
+
+    if (p->token != TOKEN_OPEN || p->depth == ANALYSIS_DEPTH)
+    {
+        return NULL;
+    }
+
+    ++p->depth;
+    next_token(p);
+    if ((e = parse_expression(p, 0)) == NULL || p->token != TOKEN_CLOSE)
+    {
+        return NULL;
+    }
+
+    --p->depth;
+    next_token(p);
+    return e;
+}
+
+char** parse_arguments(Parser* p, size_t limit)
+{
+    Parser  start = *p;
+    size_t  count = 0;
+    size_t  size = 0;
+    char**  arguments;
+    char*   text;
+
+    while (count < limit && p->token == TOKEN_IDENTIFIER)
+    {
+        size += p->length + 1;
+        ++count;
+        next_token(p);
+    }
+
+    arguments = (char**)arena_alloc(p->arena,
+                                    (count + 1) * sizeof(char*) + size);
+    text = (char*)(arguments + count + 1);
+
+    /* Scan the identifiers again, which leaves the parser where the
+       first scan did */
+
+    *p = start;
+    for (size_t i = 0; i < count; ++i)
+    {
+        memcpy(text, p->text, p->length);
+        text[p->length] = '\0';
+        arguments[i] = text;
+        text += p->length + 1;
+        next_token(p);
+    }
+
+    arguments[count] = NULL;
+    return arguments;
+}
+
+int operator_level(TokenType token, ExpressionType* type)
+{
+    switch (token)
+    {
+        case TOKEN_SEQUENCE:    *type = SEQUENCE;      return 1;
+        case TOKEN_CONCURRENT:  *type = PARALLEL;      return 2;
+        case TOKEN_AND:         *type = SEQUENCE_AND;  return 3;
+        case TOKEN_OR:          *type = SEQUENCE_OR;   return 3;
+        case TOKEN_PIPE:        *type = PIPE;          return 4;
+        default:                *type = EMPTY;         return -1;
+    }
+}
+
+int redirection_type(TokenType token, ExpressionType* type)
+{
+    switch (token)
+    {
+        case TOKEN_IN:          *type = REDIRECTION_I;   return 1;
+        case TOKEN_OUT:         *type = REDIRECTION_O;   return 1;
+        case TOKEN_OUT_APPEND:  *type = REDIRECTION_A;   return 1;
+        case TOKEN_ERR:         *type = REDIRECTION_E;   return 1;
+        case TOKEN_ERR_OUT:     *type = REDIRECTION_EO;  return 1;
+        default:                *type = EMPTY;           return 0;
+    }
+}
+
+Expression* new_node(Parser* p, ExpressionType type, Expression* l,
+                     Expression* r, char** args)
+{
+    Expression* e = (Expression*)arena_alloc(p->arena, sizeof(Expression));
+
+    e->type = type;
+    e->left = l;
+    e->right = r;
+    e->arguments = args;
+    return e;
+}
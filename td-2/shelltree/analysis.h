@@ -0,0 +1,59 @@
+/*!
+ * \ingroup td_2_group
+ * \file analysis.h
+ * \brief Exercise 2.5
+ *
+ * Builds the syntax tree of a command line.
+ *
+ * The command line is scanned and parsed by recursive descent in a
+ * single pass, straight from the characters of the line, which need
+ * not be null-terminated. The syntax tree, the lists of arguments
+ * and the arguments are allocated from an arena given by the caller.
+ * The parser keeps no state between two calls, so that command lines
+ * can be parsed by several threads, each with an arena of its own.
+ *
+ * The operators bind, from the loosest to the tightest:
+ *  - `&`, which ends a shell command run in the background
+ *  - `;`
+ *  - `&|`
+ *  - `&&` and `||`
+ *  - `|`
+ *  - the redirections `<`, `>`, `>>`, `2>` and `&>`
+ *
+ * \author H. Decoudras
+ * \version 2
+ */
+
+#ifndef DEF_ANALYSIS_H
+#define DEF_ANALYSIS_H
+
+#include "shelltree.h"
+#include "arena.h"
+
+#include <stddef.h>
+
+
+/*!
+ * \brief Largest number of nested parentheses of a command line,
+ *        which bounds the depth of the recursion of the parser.
+ */
+#define ANALYSIS_DEPTH 1000
+
+
+/*!
+ * \brief The parse_command_line() function builds the syntax tree
+ *        of a command line.
+ *
+ * \param arena Arena the syntax tree is allocated from.
+ * \param line Command line, without its line feed.
+ * \param length Length of the command line.
+ * \param e Syntax tree of the command line, an \ref EMPTY
+ *          expression for a blank line.
+ *
+ * \return `0` in case of success, `-1` in case of syntax error.
+ */
+extern int parse_command_line(Arena* arena, const char* line,
+                              size_t length, Expression** e);
+
+
+#endif // DEF_ANALYSIS_H
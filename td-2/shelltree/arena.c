@@ -0,0 +1,138 @@
+/*!
+ * \ingroup td_2_group
+ * \file arena.c
+ * \brief Exercise 2.5
+ *
+ * Allocates the syntax tree of a command line from an arena.
+ *
+ * \author H. Decoudras
+ * \version 1
+ */
+
+#include "arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+
+/*!
+ * \brief The new_block() function allocates a block and inserts
+ *        it after the current block of an arena.
+ *
+ * \param a Arena.
+ * \param size Minimum size of the memory of the block.
+ *
+ * \return The allocated block.
+ */
+static ArenaBlock* new_block(Arena* a, size_t size);
+
+
+void arena_init(Arena* a)
+{
+    a->first = NULL;
+    a->current = NULL;
+    a->allocations = 0;
+    a->blocks = 0;
+}
+
+void* arena_alloc(Arena* a, size_t size)
+{
+    ArenaBlock* block = a->current;
+    size_t      offset;
+
+    size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    ++a->allocations;
+
+    if (block == NULL || block->capacity - block->used < size)
+    {
+        /* Reuse the next block released by arena_reset() */
+
+        if (block != NULL && block->next != NULL &&
+            block->next->capacity >= size)
+        {
+            block = block->next;
+            block->used = 0;
+        }
+        else
+        {
+            block = new_block(a, size);
+        }
+
+        a->current = block;
+    }
+
+    offset = block->used;
+    block->used += size;
+
+    return &block->data[offset];
+}
+
+char* arena_strndup(Arena* a, const char* s, size_t length)
+{
+    char* copy = (char*)arena_alloc(a, length + 1);
+
+    memcpy(copy, s, length);
+    copy[length] = '\0';
+
+    return copy;
+}
+
+void arena_reset(Arena* a)
+{
+    a->current = a->first;
+
+    if (a->first != NULL)
+    {
+        a->first->used = 0;
+    }
+}
+
+void arena_destroy(Arena* a)
+{
+    ArenaBlock* block = a->first;
+    ArenaBlock* next;
+
+    while (block != NULL)
+    {
+        next = block->next;
+        free(block);
+        block = next;
+    }
+
+    arena_init(a);
+}
+
+
+ArenaBlock* new_block(Arena* a, size_t size)
+{
+    ArenaBlock* block;
+
+    if (size < ARENA_BLOCK_SIZE)
+    {
+        size = ARENA_BLOCK_SIZE;
+    }
+
+    if ((block = (ArenaBlock*)malloc(sizeof(ArenaBlock) + size)) == NULL)
+    {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+
+    block->capacity = size;
+    block->used = 0;
+    ++a->blocks;
+
+    if (a->current == NULL)
+    {
+        block->next = a->first;
+        a->first = block;
+    }
+    else
+    {
+        block->next = a->current->next;
+        a->current->next = block;
+    }
+
+    return block;
+}
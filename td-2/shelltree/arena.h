@@ -0,0 +1,161 @@
+/*!
+ * \ingroup td_2_group
+ * \file arena.h
+ * \brief Exercise 2.5
+ *
+ * Allocates the syntax tree of a command line from an arena.
+ *
+ * Memory is carved from large blocks by moving a cursor, and the
+ * whole arena is released at once by moving the cursor back to the
+ * first block. The blocks are kept and reused by the next command
+ * line, so that a command line of usual size costs no call to
+ * [malloc(size_t size)](https://man7.org/linux/man-pages/man3/malloc.3.html).
+ *
+ * \author H. Decoudras
+ * \version 1
+ */
+
+#ifndef DEF_ARENA_H
+#define DEF_ARENA_H
+
+#include <stddef.h>
+
+
+/*!
+ * \brief Default size of a block of an arena.
+ */
+#define ARENA_BLOCK_SIZE (1 << 16)
+
+/*!
+ * \brief Alignment of the memory returned by an arena.
+ */
+#define ARENA_ALIGNMENT 16
+
+
+/*!
+ * \struct arena_block
+ * \brief The \ref arena_block structure is a block of
+ *        memory of an arena.
+ */
+struct arena_block
+{
+    /*!
+     * \brief Next block of the arena.
+     */
+    struct arena_block* next;
+
+    /*!
+     * \brief Size of the memory of the block.
+     */
+    size_t capacity;
+
+    /*!
+     * \brief Number of bytes of the block in use.
+     */
+    size_t used;
+
+    /*!
+     * \brief Memory of the block.
+     */
+    char data[] __attribute__((aligned(ARENA_ALIGNMENT)));
+};
+
+/*!
+ * \brief Type definition of the \ref arena_block structure.
+ *
+ * \see arena_block
+ */
+typedef struct arena_block ArenaBlock;
+
+
+/*!
+ * \struct arena
+ * \brief The \ref arena structure is a bump allocator
+ *        released all at once.
+ */
+struct arena
+{
+    /*!
+     * \brief First block of the arena.
+     */
+    ArenaBlock* first;
+
+    /*!
+     * \brief Block the memory is carved from.
+     */
+    ArenaBlock* current;
+
+    /*!
+     * \brief Number of allocations served since the arena was
+     *        initialized.
+     */
+    size_t allocations;
+
+    /*!
+     * \brief Number of blocks allocated with `malloc` since the
+     *        arena was initialized.
+     */
+    size_t blocks;
+};
+
+/*!
+ * \brief Type definition of the \ref arena structure.
+ *
+ * \see arena
+ */
+typedef struct arena Arena;
+
+
+/*!
+ * \brief The arena_init() function initializes an empty arena.
+ *
+ * \param a Arena to initialize.
+ */
+extern void arena_init(Arena* a);
+
+/*!
+ * \brief The arena_alloc() function allocates memory from
+ *        an arena.
+ *
+ *        The program exits if the memory cannot be allocated.
+ *
+ * \param a Arena.
+ * \param size Number of bytes to allocate.
+ *
+ * \return Memory aligned on \ref ARENA_ALIGNMENT bytes, valid
+ *         until the arena is reset.
+ */
+extern void* arena_alloc(Arena* a, size_t size);
+
+/*!
+ * \brief The arena_strndup() function copies a string into
+ *        an arena.
+ *
+ * \param a Arena.
+ * \param s String to copy.
+ * \param length Number of characters to copy.
+ *
+ * \return The null-terminated copy.
+ */
+extern char* arena_strndup(Arena* a, const char* s, size_t length);
+
+/*!
+ * \brief The arena_reset() function releases all the memory
+ *        allocated from an arena, in constant time.
+ *
+ *        The blocks are kept for the next allocations.
+ *
+ * \param a Arena.
+ */
+extern void arena_reset(Arena* a);
+
+/*!
+ * \brief The arena_destroy() function frees the blocks of
+ *        an arena.
+ *
+ * \param a Arena.
+ */
+extern void arena_destroy(Arena* a);
+
+
+#endif // DEF_ARENA_H
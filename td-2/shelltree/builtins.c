@@ -0,0 +1,852 @@
+/*!
+ * \ingroup td_2_group
+ * \file builtins.c
+ * \brief Exercise 2.5
+ *
+ * Runs the builtin shell commands within the shell.
+ *
+ * \author H. Decoudras
+ * \version 7
+ */
+
+#include "builtins.h"
+#include "evaluator.h"
+#include "hash.h"
+#include "jobs.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <limits.h>
+#include <errno.h>
+
+#include <stdio.h>
+
+
+/*!
+ * \struct builtin
+ * \brief The \ref builtin structure associates a name with
+ *        a builtin shell command.
+ */
+struct builtin
+{
+    /*!
+     * \brief Name of the shell command.
+     */
+    const char* name;
+
+    /*!
+     * \brief Builtin shell command.
+     */
+    builtin_func function;
+};
+
+/*!
+ * \brief Type definition of the \ref builtin structure.
+ *
+ * \see builtin
+ */
+typedef struct builtin Builtin;
+
+
+/*!
+ * \struct shell_option
+ * \brief The \ref shell_option structure associates a name with
+ *        an option of the shell set by the `set` builtin.
+ */
+struct shell_option
+{
+    /*!
+     * \brief Name of the option.
+     */
+    const char* name;
+
+    /*!
+     * \brief Value of the option.
+     */
+    int* value;
+};
+
+/*!
+ * \brief Type definition of the \ref shell_option structure.
+ *
+ * \see shell_option
+ */
+typedef struct shell_option ShellOption;
+
+
+/*!
+ * \brief The builtin_cd() function changes the working
+ *        directory of the shell.
+ *
+ * \param arguments Shell command and its arguments.
+ *
+ * \return `0` in case of success, `1` otherwise.
+ */
+static int builtin_cd(char** arguments);
+
+/*!
+ * \brief The builtin_true() function does nothing, successfully.
+ *
+ * \param arguments Shell command and its arguments.
+ *
+ * \return `0`.
+ */
+static int builtin_true(char** arguments);
+
+/*!
+ * \brief The builtin_false() function does nothing,
+ *        unsuccessfully.
+ *
+ * \param arguments Shell command and its arguments.
+ *
+ * \return `1`.
+ */
+static int builtin_false(char** arguments);
+
+/*!
+ * \brief The builtin_echo() function writes its arguments,
+ *        followed by a line feed unless the `-n` option is
+ *        given, on the standard output with a single system
+ *        call.
+ *
+ * \param arguments Shell command and its arguments.
+ *
+ * \return `0` in case of success, `1` otherwise.
+ */
+static int builtin_echo(char** arguments);
+
+/*!
+ * \brief The builtin_exit() function exits the shell with
+ *        the given value, or the value of the last shell
+ *        command run.
+ *
+ * \param arguments Shell command and its arguments.
+ *
+ * \return `2` if the value is not a number.
+ */
+static int builtin_exit(char** arguments);
+
+/*!
+ * \brief The builtin_test() function evaluates a condition on
+ *        strings, integers or files, possibly negated by `!`.
+ *
+ * \param arguments Shell command and its arguments.
+ *
+ * \return This function can return the following values:
+ *          - **0** if the condition is true
+ *          - **1** if the condition is false
+ *          - **2** if the condition is invalid
+ */
+static int builtin_test(char** arguments);
+
+/*!
+ * \brief The builtin_hash() function displays or updates the
+ *        table of the paths of the shell commands.
+ *
+ *        Without argument, the table is displayed. The `-r`
+ *        option empties it, the `-s` option displays its
+ *        counters, and names are looked for in the `PATH`.
+ *
+ * \param arguments Shell command and its arguments.
+ *
+ * \return `0` in case of success, `1` if a name is not found.
+ */
+static int builtin_hash(char** arguments);
+
+/*!
+ * \brief The builtin_set() function displays or changes the
+ *        options of the shell.
+ *
+ *        `set -o <option>` sets an option, `set +o <option>`
+ *        unsets it, and `set` alone displays the options.
+ *        `set -j <number>` limits the number of shell commands
+ *        separated by `&|` run at once, `0` for the number of
+ *        processors, and `set -p all|any|cancel` chooses how
+ *        their value is computed.
+ *
+ * \param arguments Shell command and its arguments.
+ *
+ * \return `0` in case of success, `2` for an invalid option.
+ */
+static int builtin_set(char** arguments);
+
+/*!
+ * \brief The builtin_jobs() function displays the jobs of the
+ *        shell with their state.
+ *
+ * \param arguments Shell command and its arguments.
+ *
+ * \return `0`.
+ */
+static int builtin_jobs(char** arguments);
+
+/*!
+ * \brief The builtin_fg() function resumes a job in the
+ *        foreground and waits for it, under job control.
+ *
+ * \param arguments Shell command and the job, `%<number>` or the
+ *                  identifier of one of its processes, the most
+ *                  recent job by default.
+ *
+ * \return The value of the job, or `1` if there is no such job.
+ */
+static int builtin_fg(char** arguments);
+
+/*!
+ * \brief The builtin_bg() function resumes a stopped job in the
+ *        background, under job control.
+ *
+ * \param arguments Shell command and the job, as for builtin_fg().
+ *
+ * \return `0` in case of success, `1` if there is no such job.
+ */
+static int builtin_bg(char** arguments);
+
+/*!
+ * \brief The builtin_wait() function waits until background
+ *        jobs end.
+ *
+ * \param arguments Shell command and the jobs, as for
+ *                  builtin_fg(), every job by default.
+ *
+ * \return The value of the last job waited for, or `127` if
+ *         there is no such job.
+ */
+static int builtin_wait(char** arguments);
+
+/*!
+ * \brief The test_unary() function evaluates a condition with
+ *        a single operand.
+ *
+ * \param operator Operator, such as `-n` or `-d`.
+ * \param operand Operand.
+ *
+ * \return The value of the condition, as for builtin_test().
+ */
+static int test_unary(const char* operator, const char* operand);
+
+/*!
+ * \brief The test_binary() function evaluates a condition with
+ *        two operands.
+ *
+ * \param left Left operand.
+ * \param operator Operator, such as `=` or `-lt`.
+ * \param right Right operand.
+ *
+ * \return The value of the condition, as for builtin_test().
+ */
+static int test_binary(const char* left, const char* operator,
+                       const char* right);
+
+/*!
+ * \brief The parse_integer() function converts an argument into
+ *        an integer.
+ *
+ * \param s Argument.
+ * \param value Converted integer.
+ *
+ * \return `0` in case of success, `-1` if \p s is not an integer.
+ */
+static int parse_integer(const char* s, long* value);
+
+
+/*!
+ * \brief Builtin shell commands.
+ */
+static const Builtin builtins[] = {
+    { "cd",     builtin_cd    },
+    { "true",   builtin_true  },
+    { "false",  builtin_false },
+    { "echo",   builtin_echo  },
+    { "exit",   builtin_exit  },
+    { "test",   builtin_test  },
+    { "hash",   builtin_hash  },
+    { "set",    builtin_set   },
+    { "jobs",   builtin_jobs  },
+    { "fg",     builtin_fg    },
+    { "bg",     builtin_bg    },
+    { "wait",   builtin_wait  }
+};
+
+/*!
+ * \brief Options of the shell.
+ */
+static const ShellOption shell_options[] = {
+    { "pipefail", &pipefail }
+};
+
+/*!
+ * \brief Names of the values of \ref parallel_policy.
+ *
+ * \see parallel_policy
+ */
+static const char* parallel_policies[] = {
+    "all",
+    "any",
+    "cancel"
+};
+
+
+int builtins_disabled = 0;
+
+
+builtin_func find_builtin(const char* name)
+{
+    if (builtins_disabled)
+    {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < sizeof(builtins) / sizeof(builtins[0]); ++i)
+    {
+        if (strcmp(name, builtins[i].name) == 0)
+        {
+            return builtins[i].function;
+        }
+    }
+
+    return NULL;
+}
+
+
+int builtin_cd(char** arguments)
+{
+    const char* directory = arguments[1];
+    char        path[PATH_MAX];
+
+    if (directory == NULL && (directory = getenv("HOME")) == NULL)
+    {
+        fprintf(stderr, "cd: HOME not set\n");
+        return 1;
+    }
+
+    if (chdir(directory) < 0)
+    {
+        perror(directory);
+        return 1;
+    }
+
+    /* Let the shell commands know the new working directory */
+
+    if (getcwd(path, sizeof(path)) != NULL)
+    {
+        setenv("PWD", path, 1);
+    }
+
+    return 0;
+}
+
+int builtin_true(char** arguments)
+{
+    (void)arguments;
+
+    return 0;
+}
+
+int builtin_false(char** arguments)
+{
+    (void)arguments;
+
+    return 1;
+}
+
+int builtin_echo(char** arguments)
+{
+    size_t  length = 0;
+    size_t  offset = 0;
+    ssize_t rw_result;
+    char*   buffer;
+    int     first = 1;
+    int     newline = 1;
+
+    if (arguments[first] != NULL && strcmp(arguments[first], "-n") == 0)
+    {
+        newline = 0;
+        ++first;
+    }
+
+    for (int i = first; arguments[i] != NULL; ++i)
+    {
+        length += strlen(arguments[i]) + 1;
+    }
+
+    /* Gather the arguments in the arena of the command line */
+
+    buffer = (char*)arena_alloc(&parse_arena, length + 1);
+    for (int i = first; arguments[i] != NULL; ++i)
+    {
+        if (i > first)
+        {
+            buffer[offset++] = ' ';
+        }
+
+        size_t size = strlen(arguments[i]);
+        memcpy(&buffer[offset], arguments[i], size);
+        offset += size;
+    }
+
+    if (newline)
+    {
+        buffer[offset++] = '\n';
+    }
+
+    for (size_t written = 0; written < offset; written += rw_result)
+    {
+        rw_result = write(STDOUT_FILENO, &buffer[written],
+                          offset - written);
+        if (rw_result < 0 && errno == EINTR)
+        {
+            rw_result = 0;
+        }
+        else if (rw_result < 0)
+        {
+            perror("echo");
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int builtin_exit(char** arguments)
+{
+    long value = status;
+
+    if (arguments[1] != NULL && parse_integer(arguments[1], &value) < 0)
+    {
+        fprintf(stderr, "exit: %s: numeric argument required\n",
+                arguments[1]);
+        return 2;
+    }
+
+    /* A child shell leaves the exit handlers to the shell */
+
+    if (is_subshell)
+    {
+        fflush(NULL);
+        _exit(value & 0xff);
+    }
+
+    exit(value & 0xff);
+}
+
+int builtin_test(char** arguments)
+{
+    char**  operands = arguments + 1;
+    int     count = 0;
+    int     negate = 0;
+    int     result;
+
+    /* The arguments of a plan have no header to read their count */
+
+    while (operands[count] != NULL)
+    {
+        ++count;
+    }
+
+    if (count > 0 && strcmp(operands[0], "!") == 0)
+    {
+        negate = 1;
+        ++operands;
+        --count;
+    }
+
+    switch (count)
+    {
+        case 0:
+        {
+            result = 1;
+            break;
+        }
+
+        case 1:
+        {
+            result = operands[0][0] == '\0';
+            break;
+        }
+
+        case 2:
+        {
+            result = test_unary(operands[0], operands[1]);
+            break;
+        }
+
+        case 3:
+        {
+            result = test_binary(operands[0], operands[1], operands[2]);
+            break;
+        }
+
+        default:
+        {
+            fprintf(stderr, "test: too many arguments\n");
+            return 2;
+        }
+    }
+
+    if (result == 2)
+    {
+        return 2;
+    }
+
+    return negate ? !result : result;
+}
+
+int builtin_hash(char** arguments)
+{
+    int status = 0;
+
+    if (arguments[1] == NULL)
+    {
+        hash_print();
+        return 0;
+    }
+
+    if (strcmp(arguments[1], "-r") == 0)
+    {
+        hash_clear();
+        return 0;
+    }
+
+    if (strcmp(arguments[1], "-s") == 0)
+    {
+        printf("Hits: [%zu] Misses: [%zu] Probes: [%zu]\n",
+               hash_stats.hits, hash_stats.misses, hash_stats.probes);
+        return 0;
+    }
+
+    for (int i = 1; arguments[i] != NULL; ++i)
+    {
+        if (hash_lookup(arguments[i]) == NULL)
+        {
+            fprintf(stderr, "hash: %s: not found\n", arguments[i]);
+            status = 1;
+        }
+    }
+
+    return status;
+}
+
+int builtin_set(char** arguments)
+{
+    size_t count = sizeof(shell_options) / sizeof(shell_options[0]);
+    size_t policy_count = sizeof(parallel_policies) / 
+                          sizeof(parallel_policies[0]);
+    size_t j;
+    long value;
+
+    if (arguments[1] == NULL)
+    {
+        for (j = 0; j < count; ++j)
+        {
+            printf("%-15s\t%s\n", shell_options[j].name,
+                   *shell_options[j].value ? "on" : "off");
+        }
+
+        printf("%-15s\t%d\n", "parallel", parallel_limit);
+        printf("%-15s\t%s\n", "policy", parallel_policies[parallel_policy]);
+        return 0;
+    }
+
+    for (int i = 1; arguments[i] != NULL; i += 2)
+    {
+        if (strcmp(arguments[i], "-j") == 0 && arguments[i + 1] != NULL)
+        {
+            if (parse_integer(arguments[i + 1], &value) < 0 || value < 0 ||
+                value > INT_MAX)
+            {
+                fprintf(stderr, "set: %s: invalid number\n", 
+                        arguments[i + 1]);
+                return 2;
+            }
+
+            parallel_limit = (int)value;
+            continue;
+        }
+
+        if (strcmp(arguments[i], "-p") == 0 && arguments[i + 1] != NULL)
+        {
+            for (j = 0; j < policy_count; ++j)
+            {
+                if (strcmp(arguments[i + 1], parallel_policies[j]) == 0)
+                {
+                    break;
+                }
+            }
+
+            if (j == policy_count)
+            {
+                fprintf(stderr, "set: %s: invalid policy\n", 
+                        arguments[i + 1]);
+                return 2;
+            }
+
+            parallel_policy = (ParallelPolicy)j;
+            continue;
+        }
+
+        if ((strcmp(arguments[i], "-o") != 0 && 
+             strcmp(arguments[i], "+o") != 0) || arguments[i + 1] == NULL)
+        {
+            fprintf(stderr, "set: %s: invalid option\n", arguments[i]);
+            return 2;
+        }
+
+        for (j = 0; j < count; ++j)
+        {
+            if (strcmp(arguments[i + 1], shell_options[j].name) == 0)
+            {
+                *shell_options[j].value = arguments[i][0] == '-';
+                break;
+            }
+        }
+
+        if (j == count)
+        {
+            fprintf(stderr, "set: %s: invalid option name\n", 
+                    arguments[i + 1]);
+            return 2;
+        }
+    }
+
+    return 0;
+}
+
+int builtin_jobs(char** arguments)
+{
+    (void)arguments;
+
+    jobs_print();
+    return 0;
+}
+
+int builtin_fg(char** arguments)
+{
+    Job*    job;
+    int     status = 1;
+
+    jobs_block();
+    if ((job = job_find(arguments[1])) == NULL)
+    {
+        fprintf(stderr, "fg: %s: no such job\n", 
+                arguments[1] != NULL ? arguments[1] : "current");
+    }
+    else if (job_continue(job, 0) < 0)
+    {
+        perror("fg");
+    }
+    else
+    {
+        printf("%s\n", job->command);
+        fflush(stdout);
+        status = job_wait(job);
+    }
+
+    jobs_unblock();
+    return status;
+}
+
+int builtin_bg(char** arguments)
+{
+    Job*    job;
+    int     status = 1;
+
+    jobs_block();
+    if ((job = job_find(arguments[1])) == NULL)
+    {
+        fprintf(stderr, "bg: %s: no such job\n", 
+                arguments[1] != NULL ? arguments[1] : "current");
+    }
+    else if (job_continue(job, 1) < 0)
+    {
+        perror("bg");
+    }
+    else
+    {
+        printf("[%d] %s &\n", job->id, job->command);
+        status = 0;
+    }
+
+    jobs_unblock();
+    return status;
+}
+
+int builtin_wait(char** arguments)
+{
+    Job*    job;
+    int     status = 0;
+
+    if (arguments[1] == NULL)
+    {
+        jobs_wait_all();
+        return 0;
+    }
+
+    jobs_block();
+    for (int i = 1; arguments[i] != NULL; ++i)
+    {
+        if ((job = job_find(arguments[i])) == NULL)
+        {
+            fprintf(stderr, "wait: %s: no such job\n", arguments[i]);
+            status = 127;
+        }
+        else
+        {
+            status = job_wait(job);
+        }
+    }
+
+    jobs_unblock();
+    return status;
+}
+
+int test_unary(const char* operator, const char* operand)
+{
+    struct stat file_stat;
+
+    if (strcmp(operator, "-n") == 0)
+    {
+        return operand[0] == '\0';
+    }
+
+    if (strcmp(operator, "-z") == 0)
+    {
+        return operand[0] != '\0';
+    }
+
+    if (strcmp(operator, "-r") == 0)
+    {
+        return access(operand, R_OK) != 0;
+    }
+
+    if (strcmp(operator, "-w") == 0)
+    {
+        return access(operand, W_OK) != 0;
+    }
+
+    if (strcmp(operator, "-x") == 0)
+    {
+        return access(operand, X_OK) != 0;
+    }
+
+    if (strcmp(operator, "-e") != 0 && strcmp(operator, "-f") != 0 &&
+        strcmp(operator, "-d") != 0 && strcmp(operator, "-s") != 0)
+    {
+        fprintf(stderr, "test: %s: unary operator expected\n", operator);
+        return 2;
+    }
+
+    if (stat(operand, &file_stat) < 0)
+    {
+        return 1;
+    }
+
+    switch (operator[1])
+    {
+        case 'f':
+        {
+            return !S_ISREG(file_stat.st_mode);
+        }
+
+        case 'd':
+        {
+            return !S_ISDIR(file_stat.st_mode);
+        }
+
+        case 's':
+        {
+            return file_stat.st_size == 0;
+        }
+
+        default:
+        {
+            return 0;
+        }
+    }
+}
+
+int test_binary(const char* left, const char* operator,
+                const char* right)
+{
+    static const char* integer_operators[] = {
+        "-eq", "-ne", "-lt", "-le", "-gt", "-ge"
+    };
+
+    long    l;
+    long    r;
+    int     found = -1;
+
+    if (strcmp(operator, "=") == 0)
+    {
+        return strcmp(left, right) != 0;
+    }
+
+    if (strcmp(operator, "!=") == 0)
+    {
+        return strcmp(left, right) == 0;
+    }
+
+    for (int i = 0; i < 6; ++i)
+    {
+        if (strcmp(operator, integer_operators[i]) == 0)
+        {
+            found = i;
+        }
+    }
+
+    if (found < 0)
+    {
+        fprintf(stderr, "test: %s: binary operator expected\n", operator);
+        return 2;
+    }
+
+    if (parse_integer(left, &l) < 0 || parse_integer(right, &r) < 0)
+    {
+        fprintf(stderr, "test: integer expression expected\n");
+        return 2;
+    }
+
+    switch (found)
+    {
+        case 0:
+        {
+            return !(l == r);
+        }
+
+        case 1:
+        {
+            return !(l != r);
+        }
+
+        case 2:
+        {
+            return !(l < r);
+        }
+
+        case 3:
+        {
+            return !(l <= r);
+        }
+
+        case 4:
+        {
+            return !(l > r);
+        }
+
+        default:
+        {
+            return !(l >= r);
+        }
+    }
+}
+
+int parse_integer(const char* s, long* value)
+{
+    char* end;
+
+    errno = 0;
+    *value = strtol(s, &end, 10);
+
+    return (errno != 0 || end == s || *end != '\0') ? -1 : 0;
+}
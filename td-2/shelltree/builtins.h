@@ -0,0 +1,47 @@
+/*!
+ * \ingroup td_2_group
+ * \file builtins.h
+ * \brief Exercise 2.5
+ *
+ * Runs the builtin shell commands within the shell.
+ *
+ * \author H. Decoudras
+ * \version 1
+ */
+
+#ifndef DEF_BUILTINS_H
+#define DEF_BUILTINS_H
+
+#include "shelltree.h"
+
+
+/*!
+ * \brief Builtin shell command.
+ *
+ * \param arguments Shell command and its arguments.
+ *
+ * \return The value of the shell command.
+ */
+typedef int (*builtin_func)(char** arguments);
+
+
+/*!
+ * \brief Runs every shell command as an external command
+ *        when set.
+ */
+extern int builtins_disabled;
+
+
+/*!
+ * \brief The find_builtin() function looks for a builtin
+ *        shell command.
+ *
+ * \param name Name of the shell command.
+ *
+ * \return The builtin shell command, or `NULL` if \p name is
+ *         not a builtin or the builtins are disabled.
+ */
+extern builtin_func find_builtin(const char* name);
+
+
+#endif // DEF_BUILTINS_H
@@ -6,12 +6,13 @@
  * Displays a tree representation of shell commands.
  *
  * \author H. Decoudras
- * \version 1
+ * \version 3
  */
 
 #include "display.h"
 #include "shelltree.h"
 
+#include <stdlib.h>
 #include <stdio.h>
 
 
@@ -50,6 +51,15 @@ static void indent_not_empty(int indent, int line_count);
 static void print_expression_recursive(Expression* e, int indent, 
                                        int line_count);
 
+/*!
+ * \brief The format_expression_recursive() function writes shell
+ *        commands back as a command line on a stream.
+ *
+ * \param e Shell commands.
+ * \param stream Stream to write to.
+ */
+static void format_expression_recursive(Expression* e, FILE* stream);
+
 /*!
  * \brief String representation of the type of a 
  *        shell command.
@@ -64,6 +74,7 @@ static const char* string_type[] = {
     "SEQUENCE_OR",      
     "BACKGROUND",       
     "PIPE",             
+    "PARALLEL",
     "REDIRECTION_I",    
     "REDIRECTION_O",    
     "REDIRECTION_A",    
@@ -71,12 +82,52 @@ static const char* string_type[] = {
     "REDIRECTION_EO"
 };
 
+/*!
+ * \brief Operator of each type of shell command, as written
+ *        in a command line.
+ *
+ * \see expression_type
+ */
+static const char* string_operator[] = {
+    "",
+    "",
+    ";",
+    "&&",
+    "||",
+    "&",
+    "|",
+    "&|",
+    "<",
+    ">",
+    ">>",
+    "2>",
+    "&>"
+};
+
 
 void print_expression(Expression* e)
 {
     print_expression_recursive(e, 4, 4);
 }
 
+char* format_expression(Expression* e)
+{
+    char*   line = NULL;
+    size_t  size = 0;
+    FILE*   stream = open_memstream(&line, &size);
+
+    if (stream == NULL)
+    {
+        perror("open_memstream");
+        exit(EXIT_FAILURE);
+    }
+
+    format_expression_recursive(e, stream);
+    fclose(stream);
+
+    return line;
+}
+
 
 void indent_empty(int indent, int line_count)
 {
@@ -200,3 +251,55 @@ void print_expression_recursive(Expression* e, int indent, int line_count)
     }
 }
 
+
+void format_expression_recursive(Expression* e, FILE* stream)
+{
+    if (e == NULL)
+    {
+        return;
+    }
+
+    switch (e->type)
+    {
+        case EMPTY:
+        {
+            break;
+        }
+
+        case SIMPLE:
+        {
+            for (int i = 0; e->arguments[i] != NULL; i++)
+            {
+                fprintf(stream, i == 0 ? "%s" : " %s", e->arguments[i]);
+            }
+
+            break;
+        }
+
+        case REDIRECTION_I:
+        case REDIRECTION_O:
+        case REDIRECTION_A:
+        case REDIRECTION_E:
+        case REDIRECTION_EO:
+        {
+            format_expression_recursive(e->left, stream);
+            fprintf(stream, " %s %s", string_operator[e->type], 
+                    e->arguments[0]);
+            break;
+        }
+
+        case BACKGROUND:
+        {
+            format_expression_recursive(e->left, stream);
+            fprintf(stream, " %s", string_operator[e->type]);
+            break;
+        }
+
+        default:
+        {
+            format_expression_recursive(e->left, stream);
+            fprintf(stream, " %s ", string_operator[e->type]);
+            format_expression_recursive(e->right, stream);
+        }
+    }
+}
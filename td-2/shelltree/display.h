@@ -6,7 +6,7 @@
  * Displays a tree representation of shell commands.
  *
  * \author H. Decoudras
- * \version 1
+ * \version 2
  */
 
 #ifndef DEF_DISPLAY_H
@@ -26,6 +26,17 @@
  */
 extern void print_expression(Expression* e);
 
+/*!
+ * \brief The format_expression() function writes shell commands
+ *        back as a command line.
+ *
+ * \param e Shell commands.
+ *
+ * \return The allocated command line, to be released with
+ *         [free](https://man7.org/linux/man-pages/man3/free.3.html).
+ */
+extern char* format_expression(Expression* e);
+
 
 #endif // DEF_DISPLAY_H
 
@@ -5,21 +5,42 @@
  *
  * Execute a shell command.
  *
+ * The stages of a pipeline are launched at once, as a single job.
+ * Foreground jobs are waited for in the table of the jobs, where the
+ * handler of `SIGCHLD` records their processes as they end, and
+ * background jobs are reaped the same way while the shell goes on.
+ *
+ * Shell commands separated by `&|` are taken from a queue and run
+ * concurrently, at most \ref parallel_limit at once.
+ *
  * \author H. Decoudras
- * \version 7
+ * \version 13
  */
 
+#define _GNU_SOURCE
+
 #include "shelltree.h"
 #include "evaluator.h"
+#include "builtins.h"
+#include "hash.h"
+#include "jobs.h"
 
 #include <sys/types.h>
-#include <sys/wait.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <spawn.h>
+#include <signal.h>
+#include <errno.h>
 
 #include <stdio.h>
 
 
+/*!
+ * \brief Environment of the shell.
+ */
+extern char** environ;
+
+
 /*!
  * \brief The report_error() function displays a message
  *        \p message if the \p assertion parameter is
@@ -34,6 +55,198 @@
  */
 static int report_error(int assertion, const char* message);
 
+/*!
+ * \brief The spawn_command() function launches a simple shell
+ *        command with
+ *        [posix_spawn](https://man7.org/linux/man-pages/man3/posix_spawn.3.html).
+ *
+ *        The redirections of \p fd_list are turned into file
+ *        actions applied in the child process. The shell command
+ *        is launched from the path remembered by the hash table,
+ *        which is searched again if the path no longer exists.
+ *
+ * \param e Shell command to be launched.
+ * \param fd_list List of file descriptors currently in use.
+ * \param pgid Process group to join, `0` to create one, or `-1`
+ *             to stay in the process group of the shell.
+ * \param child_pid Identifier of the child process.
+ *
+ * \return `0` in case of success, an error number otherwise.
+ */
+static int spawn_command(Expression* e, const int* fd_list, pid_t pgid,
+                         pid_t* child_pid);
+
+/*!
+ * \brief The fork_command() function launches a simple shell
+ *        command with
+ *        [fork](https://man7.org/linux/man-pages/man2/fork.2.html)
+ *        and
+ *        [execve](https://man7.org/linux/man-pages/man2/execve.2.html),
+ *        or [execvp](https://man7.org/linux/man-pages/man3/exec.3.html)
+ *        when the hash table is disabled.
+ *
+ * \param e Shell command to be launched.
+ * \param fd_list List of file descriptors currently in use.
+ * \param pgid Process group to join, as for spawn_command().
+ *
+ * \return The identifier of the child process, or `-1` in case
+ *         of error.
+ */
+static pid_t fork_command(Expression* e, const int* fd_list, pid_t pgid);
+
+/*!
+ * \brief The launch_command() function launches a simple shell
+ *        command with spawn_command(), or fork_command() when
+ *        \ref launch_mode requires it or `posix_spawn` is not
+ *        supported.
+ *
+ * \param e Shell command to be launched.
+ * \param fd_list List of file descriptors currently in use.
+ * \param pgid Process group to join, as for spawn_command().
+ *
+ * \return The identifier of the child process, or `-1` in case
+ *         of error, which is reported.
+ */
+static pid_t launch_command(Expression* e, const int* fd_list, 
+                            pid_t pgid);
+
+/*!
+ * \brief The launch_subshell() function evaluates a shell command
+ *        in a child process of the shell.
+ *
+ * \param e Shell command to be evaluated.
+ * \param fd_list List of file descriptors currently in use.
+ * \param pgid Process group to join, as for spawn_command().
+ * \param pipes Pipes of the pipeline, closed in the child process.
+ * \param pipe_count Number of pipes.
+ *
+ * \return The identifier of the child process, or `-1` in case
+ *         of error, which is reported.
+ */
+static pid_t launch_subshell(Expression* e, const int* fd_list, 
+                             pid_t pgid, int (*pipes)[2], 
+                             int pipe_count);
+
+/*!
+ * \brief The launch_stage() function applies the redirections of
+ *        a stage of a pipeline or of a `&|` list, and launches it.
+ *
+ *        A simple external command is launched with
+ *        launch_command(), any other shell command with
+ *        launch_subshell().
+ *
+ * \param stage Shell command to be launched.
+ * \param fd_list File descriptors of the stage before its own
+ *                redirections, left open.
+ * \param pgid Process group to join, as for spawn_command().
+ * \param pipes Pipes closed in the child process, as for
+ *              launch_subshell().
+ * \param pipe_count Number of pipes.
+ *
+ * \return The identifier of the child process, or `-1` in case
+ *         of error, which is reported.
+ */
+static pid_t launch_stage(Expression* stage, const int* fd_list, 
+                          pid_t pgid, int (*pipes)[2], int pipe_count);
+
+/*!
+ * \brief The launch_pgid() function gives the process group in
+ *        which a new job is launched.
+ *
+ * \return `0` to create one under job control, `-1` to stay in
+ *         the process group of the shell.
+ */
+static pid_t launch_pgid(void);
+
+/*!
+ * \brief The release_fd_list() function closes the redirected
+ *        file descriptors of the shell and restores the list of
+ *        file descriptors currently in use.
+ *
+ * \param fd_list List of file descriptors currently in use.
+ */
+static void release_fd_list(int* fd_list);
+
+/*!
+ * \brief The evaluate_builtin_expression() function runs a
+ *        builtin shell command within the shell.
+ *
+ *        The standard file descriptors of the shell are
+ *        redirected while the builtin runs, then restored.
+ *
+ * \param builtin Builtin shell command.
+ * \param e Shell command to be executed.
+ * \param fd_list List of file descriptors currently in use.
+ *
+ * \return The value of the builtin shell command.
+ */
+static int evaluate_builtin_expression(builtin_func builtin, 
+                                       Expression* e, int* fd_list);
+
+/*!
+ * \brief The count_stages() function counts the stages of a
+ *        pipeline or of a `&|` list.
+ *
+ * \param e Pipeline or `&|` list.
+ * \param type Operator separating the stages, \ref PIPE or
+ *             \ref PARALLEL.
+ *
+ * \return The number of shell commands separated by \p type.
+ */
+static int count_stages(Expression* e, ExpressionType type);
+
+/*!
+ * \brief The collect_stages() function flattens a pipeline or a
+ *        `&|` list into the list of its stages, from left to right.
+ *
+ * \param e Pipeline or `&|` list.
+ * \param type Operator separating the stages.
+ * \param stages List of stages to fill.
+ * \param count Number of stages already in the list.
+ *
+ * \return The number of stages in the list.
+ */
+static int collect_stages(Expression* e, ExpressionType type, 
+                          Expression** stages, int count);
+
+/*!
+ * \brief The evaluate_pipeline_expression() function executes
+ *        the stages of a pipeline concurrently.
+ *
+ *        All the stages are launched as a single job before any
+ *        of them is waited for, and the shell keeps no end of the
+ *        pipes open.
+ *
+ * \param e Pipeline to be executed.
+ * \param fd_list List of file descriptors currently in use.
+ * \param is_background Determines if the pipeline must be
+ *        executed as a background task.
+ *
+ * \return The value of the last stage, or of the last stage
+ *         which failed when \ref pipefail is set.
+ */
+static int evaluate_pipeline_expression(Expression* e, int* fd_list, 
+                                        int is_background);
+
+/*!
+ * \brief The evaluate_parallel_expression() function executes
+ *        the shell commands of a `&|` list concurrently.
+ *
+ *        The shell commands are launched from left to right
+ *        whenever fewer than \ref parallel_limit are running, and
+ *        reaped in the order they end. They stay in the process
+ *        group of the shell, so that the signals of the terminal
+ *        reach them, and no other is launched once one of them
+ *        has been interrupted.
+ *
+ * \param e `&|` list to be executed.
+ * \param fd_list List of file descriptors currently in use.
+ *
+ * \return The value of the list, according to
+ *         \ref parallel_policy.
+ */
+static int evaluate_parallel_expression(Expression* e, int* fd_list);
+
 /*!
  * \brief The evaluate_simple_expression() function
  *        executes simple shell commands.
@@ -53,6 +266,21 @@ static int report_error(int assertion, const char* message);
 static int evaluate_simple_expression(Expression* e, int* fd_list, 
                                       int is_background);
 
+/*!
+ * \brief The evaluate_background_expression() function executes
+ *        shell commands as a background job.
+ *
+ *        External commands and pipelines are launched as is, any
+ *        other shell command is evaluated in a child process of
+ *        the shell.
+ *
+ * \param e Background shell commands.
+ * \param fd_list List of file descriptors currently in use.
+ *
+ * \return `0` if the job has been launched, `1` otherwise.
+ */
+static int evaluate_background_expression(Expression* e, int* fd_list);
+
 /*!
  * \brief The evaluate_redirection_expression() function
  *        executes a redirected shell command.
@@ -94,6 +322,17 @@ static int evaluate_expression_recursive(Expression* e, int* fd_list,
                                          int is_background);
 
 
+LaunchMode launch_mode = LAUNCH_SPAWN;
+
+int pipefail = 0;
+
+int parallel_limit = 0;
+
+ParallelPolicy parallel_policy = PARALLEL_ALL;
+
+int is_subshell = 0;
+
+
 int evaluate_expression(Expression* e)
 {
     int fd_list[] = {
@@ -122,15 +361,126 @@ int report_error(int assertion, const char* message)
     return 0;
 }
 
-int evaluate_simple_expression(Expression* e, int* fd_list, 
-                               int is_background)
+int spawn_command(Expression* e, const int* fd_list, pid_t pgid,
+                  pid_t* child_pid)
 {
-    int status = 0;
-    pid_t child_pid = fork();
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attributes;
+    sigset_t default_signals;
+    sigset_t no_signals;
+    const char* path;
+    int result;
+
+    if ((result = posix_spawnattr_init(&attributes)) != 0)
+    {
+        return result;
+    }
+
+    /* The shell command gets the signals the shell ignores or blocks */
+
+    jobs_default_signals(&default_signals);
+    sigemptyset(&no_signals);
+
+    if ((result = posix_spawnattr_setflags(
+            &attributes, 
+            POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK |
+            (pgid >= 0 ? POSIX_SPAWN_SETPGROUP : 0))) != 0 ||
+        (result = posix_spawnattr_setsigdefault(&attributes, 
+                                                &default_signals)) != 0 ||
+        (result = posix_spawnattr_setsigmask(&attributes, 
+                                             &no_signals)) != 0 ||
+        (pgid >= 0 && 
+         (result = posix_spawnattr_setpgroup(&attributes, pgid)) != 0))
+    {
+        posix_spawnattr_destroy(&attributes);
+        return result;
+    }
+
+    if ((result = posix_spawn_file_actions_init(&actions)) != 0)
+    {
+        posix_spawnattr_destroy(&attributes);
+        return result;
+    }
+
+    /* Same redirections as the child process of fork_command() */
+
+    for (int i = 0; i < STDERR_FILENO + 1 && result == 0; ++i)
+    {
+        if (fd_list[i] != i)
+        {
+            result = posix_spawn_file_actions_adddup2(&actions, 
+                                                      fd_list[i], i);
+        }
+    }
+
+    if (result == 0 && fd_list[0] != STDIN_FILENO)
+    {
+        result = posix_spawn_file_actions_addclose(&actions, fd_list[0]);
+    }
+
+    if (result == 0 && fd_list[1] != STDOUT_FILENO)
+    {
+        result = posix_spawn_file_actions_addclose(&actions, fd_list[1]);
+    }
+
+    if (result == 0 && fd_list[2] != STDERR_FILENO && 
+        fd_list[1] != fd_list[2])
+    {
+        result = posix_spawn_file_actions_addclose(&actions, fd_list[2]);
+    }
+
+    if (result == 0 && hash_disabled)
+    {
+        result = posix_spawnp(child_pid, e->arguments[0], &actions, 
+                              &attributes, e->arguments, environ);
+    }
+    else if (result == 0)
+    {
+        path = hash_lookup(e->arguments[0]);
+        result = path == NULL ? ENOENT :
+                    posix_spawn(child_pid, path, &actions, &attributes, 
+                                e->arguments, environ);
+
+        /* Search the PATH again when the remembered path vanished */
+
+        if (result == ENOENT && path != NULL && path != e->arguments[0])
+        {
+            hash_forget(e->arguments[0]);
+            path = hash_lookup(e->arguments[0]);
+            result = path == NULL ? ENOENT :
+                        posix_spawn(child_pid, path, &actions, &attributes,
+                                    e->arguments, environ);
+        }
+    }
+
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attributes);
+    return result;
+}
+
+pid_t fork_command(Expression* e, const int* fd_list, pid_t pgid)
+{
+    const char* path = NULL;
+    pid_t child_pid;
+
+    if (!hash_disabled && (path = hash_lookup(e->arguments[0])) == NULL)
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    child_pid = fork();
 
     if (!child_pid)
     {
         /* Child process */
+
+        if (pgid >= 0)
+        {
+            setpgid(0, pgid);
+        }
+
+        jobs_reset_signals();
       
         for (int i = 0; i < STDERR_FILENO + 1; ++i)
         {
@@ -155,13 +505,173 @@ int evaluate_simple_expression(Expression* e, int* fd_list,
             close(fd_list[2]); 
         }
 
-        execvp(e->arguments[0], e->arguments);
+        if (path != NULL)
+        {
+            execve(path, e->arguments, environ);
+        }
+        else
+        {
+            execvp(e->arguments[0], e->arguments);
+        }
+
         perror(e->arguments[0]);
-        exit(EXIT_FAILURE);      
+        fflush(NULL);
+        _exit(EXIT_FAILURE);
     }
- 
-    /* Parent process */
-  
+
+    /* Join the process group from both sides to avoid a race */
+
+    if (child_pid > 0 && pgid >= 0)
+    {
+        setpgid(child_pid, pgid > 0 ? pgid : child_pid);
+    }
+
+    return child_pid;
+}
+
+pid_t launch_command(Expression* e, const int* fd_list, pid_t pgid)
+{
+    pid_t child_pid = -1;
+    int result = ENOSYS;
+
+    if (launch_mode == LAUNCH_SPAWN)
+    {
+        result = spawn_command(e, fd_list, pgid, &child_pid);
+    }
+
+    /* Fall back to fork when posix_spawn is not supported */
+
+    if (result == ENOSYS)
+    {
+        child_pid = fork_command(e, fd_list, pgid);
+        result = child_pid < 0 ? errno : 0;
+    }
+
+    if (result != 0)
+    {
+        errno = result;
+        perror(e->arguments[0]);
+        return -1;
+    }
+
+    return child_pid;
+}
+
+pid_t launch_subshell(Expression* e, const int* fd_list, pid_t pgid,
+                      int (*pipes)[2], int pipe_count)
+{
+    int identity_list[] = {
+        STDIN_FILENO,
+        STDOUT_FILENO,
+        STDERR_FILENO
+    };
+
+    pid_t child_pid = fork();
+    int status;
+
+    if (report_error(child_pid < 0, "fork"))
+    {
+        return -1;
+    }
+
+    if (!child_pid)
+    {
+        /* Child process: the shell command sees the redirections as
+           its standard file descriptors, and the child process has 
+           no job of its own */
+
+        if (pgid >= 0)
+        {
+            setpgid(0, pgid);
+        }
+
+        is_subshell = 1;
+        jobs_reset();
+        for (int i = 0; i < STDERR_FILENO + 1; ++i)
+        {
+            if (fd_list[i] != i)
+            {
+                dup2(fd_list[i], i);
+            }
+        }
+
+        for (int i = 0; i < STDERR_FILENO + 1; ++i)
+        {
+            if (fd_list[i] > STDERR_FILENO)
+            {
+                close(fd_list[i]);
+            }
+        }
+
+        for (int i = 0; i < pipe_count; ++i)
+        {
+            close(pipes[i][0]);
+            close(pipes[i][1]);
+        }
+
+        /* Leave the exit handlers of the shell to the shell */
+
+        status = evaluate_expression_recursive(e, identity_list, 0);
+        fflush(NULL);
+        _exit(status);
+    }
+
+    if (pgid >= 0)
+    {
+        setpgid(child_pid, pgid > 0 ? pgid : child_pid);
+    }
+
+    return child_pid;
+}
+
+pid_t launch_stage(Expression* stage, const int* fd_list, pid_t pgid,
+                   int (*pipes)[2], int pipe_count)
+{
+    int     stage_fds[STDERR_FILENO + 1];
+    int     ok = 1;
+    pid_t   child_pid = -1;
+
+    memcpy(stage_fds, fd_list, sizeof(stage_fds));
+    while (ok && stage->type >= REDIRECTION_I)
+    {
+        ok = evaluate_redirection_expression(stage->type, 
+                                             stage->arguments[0], 
+                                             stage_fds);
+        stage = stage->left;
+    }
+
+    if (ok && stage->type == SIMPLE && 
+        find_builtin(stage->arguments[0]) == NULL)
+    {
+        child_pid = launch_command(stage, stage_fds, pgid);
+    }
+    else if (ok)
+    {
+        child_pid = launch_subshell(stage, stage_fds, pgid, pipes, 
+                                    pipe_count);
+    }
+
+    /* Close the files opened by the redirections of the stage */
+
+    for (int j = 0; j < STDERR_FILENO + 1; ++j)
+    {
+        if (stage_fds[j] != fd_list[j] && 
+            (j != STDERR_FILENO || stage_fds[1] != stage_fds[2]))
+        {
+            close(stage_fds[j]);
+        }
+    }
+
+    return child_pid;
+}
+
+pid_t launch_pgid(void)
+{
+    return job_control ? 0 : -1;
+}
+
+void release_fd_list(int* fd_list)
+{
     for (int i = 0; i < STDERR_FILENO + 1; ++i)
     {
         if (fd_list[i] != i)
@@ -174,17 +684,127 @@ int evaluate_simple_expression(Expression* e, int* fd_list,
             fd_list[i] = i;
         }
     }
+}
+
+int evaluate_builtin_expression(builtin_func builtin, Expression* e, 
+                                int* fd_list)
+{
+    int saved[STDERR_FILENO + 1];
+    int status;
+
+    /* Redirect the shell itself */
+
+    fflush(stdout);
+    for (int i = 0; i < STDERR_FILENO + 1; ++i)
+    {
+        saved[i] = -1;
+        if (fd_list[i] != i)
+        {
+            saved[i] = fcntl(i, F_DUPFD_CLOEXEC, STDERR_FILENO + 1);
+            dup2(fd_list[i], i);
+        }
+    }
+
+    status = builtin(e->arguments);
+    fflush(stdout);
+
+    for (int i = 0; i < STDERR_FILENO + 1; ++i)
+    {
+        if (fd_list[i] != i)
+        {
+            if (saved[i] < 0)
+            {
+                close(i);
+            }
+            else
+            {
+                dup2(saved[i], i);
+                close(saved[i]);
+            }
+        }
+    }
+
+    release_fd_list(fd_list);
+    return status;
+}
+
+int evaluate_simple_expression(Expression* e, int* fd_list, 
+                               int is_background)
+{
+    builtin_func builtin;
+    int status = EXIT_FAILURE;
+    pid_t child_pid;
+    Job* job;
+
+    /* Builtins run within the shell, unless in the background */
+
+    if (!is_background && (builtin = find_builtin(e->arguments[0])) != NULL)
+    {
+        return evaluate_builtin_expression(builtin, e, fd_list);
+    }
+
+    /* The child process is not reaped before its job is added */
+
+    jobs_block();
+    child_pid = launch_command(e, fd_list, launch_pgid());
+ 
+    /* Parent process */
   
-    if (!is_background)
+    release_fd_list(fd_list);
+  
+    if (child_pid > 0)
     {
-        waitpid(child_pid, &status, 0);
-        status = WIFEXITED(status) ? WEXITSTATUS(status) : 
-                    128 +  WTERMSIG(status);
+        job = job_add(job_control ? child_pid : -1, &child_pid, 1, e, 
+                      is_background);
+        if (is_background)
+        {
+            job_announce(job);
+            status = 0;
+        }
+        else
+        {
+            status = job_wait(job);
+        }
     }
 
+    jobs_unblock();
     return status;
 }
 
+int evaluate_background_expression(Expression* e, int* fd_list)
+{
+    Expression* command = e->left;
+    pid_t child_pid;
+
+    while (command->type >= REDIRECTION_I)
+    {
+        command = command->left;
+    }
+
+    if (command->type == PIPE || 
+        (command->type == SIMPLE && 
+         find_builtin(command->arguments[0]) == NULL))
+    {
+        return evaluate_expression_recursive(e->left, fd_list, 1);
+    }
+
+    /* Any other shell command runs in a child process of the shell */
+
+    fflush(stdout);
+    jobs_block();
+    child_pid = launch_subshell(e->left, fd_list, launch_pgid(), NULL, 0);
+    release_fd_list(fd_list);
+
+    if (child_pid > 0)
+    {
+        job_announce(job_add(job_control ? child_pid : -1, &child_pid, 1, 
+                             e->left, 1));
+    }
+
+    jobs_unblock();
+    return child_pid > 0 ? 0 : EXIT_FAILURE;
+}
+
 int evaluate_redirection_expression(ExpressionType type, 
                                     const char* file, int* fd_list)
 {  
@@ -261,11 +881,245 @@ int evaluate_redirection_expression(ExpressionType type,
     return 1;
 }
 
+int count_stages(Expression* e, ExpressionType type)
+{
+    if (e->type != type)
+    {
+        return 1;
+    }
+
+    return count_stages(e->left, type) + count_stages(e->right, type);
+}
+
+int collect_stages(Expression* e, ExpressionType type, 
+                   Expression** stages, int count)
+{
+    if (e->type != type)
+    {
+        stages[count] = e;
+        return count + 1;
+    }
+
+    count = collect_stages(e->left, type, stages, count);
+    return collect_stages(e->right, type, stages, count);
+}
+
+int evaluate_pipeline_expression(Expression* e, int* fd_list, 
+                                 int is_background)
+{
+    int             count = count_stages(e, PIPE);
+    Expression**    stages;
+    int             (*pipes)[2];
+    pid_t*          pids;
+    int             initial_fds[STDERR_FILENO + 1];
+    int             status = 0;
+    int             remaining = 0;
+    pid_t           pgid = launch_pgid();
+    Job*            job;
+
+    stages = (Expression**)arena_alloc(&parse_arena, 
+                                       count * sizeof(Expression*));
+    pipes = (int (*)[2])arena_alloc(&parse_arena, count * sizeof(int[2]));
+    pids = (pid_t*)arena_alloc(&parse_arena, count * sizeof(pid_t));
+
+    collect_stages(e, PIPE, stages, 0);
+
+    /* Close-on-exec pipes never leak into the launched commands */
+
+    for (int i = 0; i < count - 1; ++i)
+    {
+        if (report_error(pipe2(pipes[i], O_CLOEXEC) < 0, "pipe"))
+        {
+            while (--i >= 0)
+            {
+                close(pipes[i][0]);
+                close(pipes[i][1]);
+            }
+
+            release_fd_list(fd_list);
+            return EXIT_FAILURE;
+        }
+    }
+
+    fflush(stdout);
+    jobs_block();
+
+    /* Launch every stage before waiting for any of them */
+
+    for (int i = 0; i < count; ++i)
+    {
+        initial_fds[0] = i == 0 ? fd_list[0] : pipes[i - 1][0];
+        initial_fds[1] = i == count - 1 ? fd_list[1] : pipes[i][1];
+        initial_fds[2] = fd_list[2];
+
+        pids[i] = launch_stage(stages[i], initial_fds, pgid, pipes, 
+                               count - 1);
+        if (pids[i] > 0)
+        {
+            ++remaining;
+            pgid = pgid == 0 ? pids[i] : pgid;
+        }
+    }
+
+    for (int i = 0; i < count - 1; ++i)
+    {
+        close(pipes[i][0]);
+        close(pipes[i][1]);
+    }
+
+    release_fd_list(fd_list);
+
+    if (remaining == 0)
+    {
+        jobs_unblock();
+        return EXIT_FAILURE;
+    }
+
+    /* The stages which could not be launched count as failed */
+
+    job = job_add(pgid, pids, count, e, is_background);
+    if (is_background)
+    {
+        job_announce(job);
+    }
+    else
+    {
+        status = job_wait(job);
+    }
+
+    jobs_unblock();
+    return status;
+}
+
+int evaluate_parallel_expression(Expression* e, int* fd_list)
+{
+    int             count = count_stages(e, PARALLEL);
+    int             limit = parallel_limit;
+    Expression**    branches;
+    Job**           running;
+    int*            indices;
+    int*            values;
+    int             in_flight = 0;
+    int             next = 0;
+    int             cancelled = 0;
+    int             failure = 0;
+    int             status;
+    int             i;
+    pid_t           child_pid;
+
+    if (limit <= 0 && (limit = sysconf(_SC_NPROCESSORS_ONLN)) <= 0)
+    {
+        limit = 1;
+    }
+
+    limit = limit < count ? limit : count;
+
+    branches = (Expression**)arena_alloc(&parse_arena, 
+                                         count * sizeof(Expression*));
+    running = (Job**)arena_alloc(&parse_arena, limit * sizeof(Job*));
+    indices = (int*)arena_alloc(&parse_arena, limit * sizeof(int));
+    values = (int*)arena_alloc(&parse_arena, count * sizeof(int));
+
+    collect_stages(e, PARALLEL, branches, 0);
+
+    fflush(stdout);
+    jobs_block();
+
+    while (1)
+    {
+        /* Fill the free slots from the queue of shell commands */
+
+        while (next < count && in_flight < limit && !cancelled)
+        {
+            values[next] = EXIT_FAILURE;
+            child_pid = launch_stage(branches[next], fd_list, -1, NULL, 0);
+            if (child_pid > 0)
+            {
+                running[in_flight] = job_add(-1, &child_pid, 1, 
+                                             branches[next], 0);
+                indices[in_flight++] = next;
+            }
+            else if (parallel_policy == PARALLEL_CANCEL)
+            {
+                cancelled = 1;
+                failure = EXIT_FAILURE;
+            }
+
+            ++next;
+        }
+
+        if (in_flight == 0)
+        {
+            break;
+        }
+
+        /* Reap the shell commands in the order they end */
+
+        i = jobs_wait_any(running, in_flight);
+        status = values[indices[i]] = job_wait(running[i]);
+
+        --in_flight;
+        running[i] = running[in_flight];
+        indices[i] = indices[in_flight];
+
+        /* An interrupted shell command interrupts the whole list */
+
+        if (status == 128 + SIGINT && !cancelled)
+        {
+            cancelled = 1;
+            failure = status;
+        }
+        else if (status != 0 && parallel_policy == PARALLEL_CANCEL && 
+                 !cancelled)
+        {
+            cancelled = 1;
+            failure = status;
+            for (int j = 0; j < in_flight; ++j)
+            {
+                job_signal(running[j], SIGTERM);
+            }
+        }
+    }
+
+    jobs_unblock();
+    release_fd_list(fd_list);
+
+    switch (parallel_policy)
+    {
+        case PARALLEL_ANY:
+        {
+            status = next == 0 ? 0 : values[next - 1];
+            for (i = 0; i < next && status != 0; ++i)
+            {
+                status = values[i] == 0 ? 0 : status;
+            }
+
+            break;
+        }
+
+        case PARALLEL_CANCEL:
+        {
+            status = failure;
+            break;
+        }
+
+        default:
+        {
+            status = 0;
+            for (i = 0; i < next; ++i)
+            {
+                status = values[i] != 0 ? values[i] : status;
+            }
+        }
+    }
+
+    return status;
+}
+
 int evaluate_expression_recursive(Expression* e, int* fd_list, 
                                   int is_background)
 {
     int status;
-    int fd[2];
   
     if (e == NULL) 
     {
@@ -309,7 +1163,7 @@ int evaluate_expression_recursive(Expression* e, int* fd_list,
     
         case BACKGROUND:
         {
-            return evaluate_expression_recursive(e->left, fd_list, 1);
+            return evaluate_background_expression(e, fd_list);
         }
     
         case SEQUENCE:
@@ -332,10 +1186,9 @@ int evaluate_expression_recursive(Expression* e, int* fd_list,
                     fd_list, 
                     0
                 );
-                return status;
             }
 
-            break;
+            return status;
         }
 
         case SEQUENCE_AND:
@@ -355,29 +1208,16 @@ int evaluate_expression_recursive(Expression* e, int* fd_list,
 
         case PIPE:
         {
-            pipe(fd);
+            return evaluate_pipeline_expression(
+                e, 
+                fd_list, 
+                is_background
+            );
+        }
 
-            {
-	            int newfd_list[3];
-	            newfd_list[0] = fd_list[0];
-	            newfd_list[1] = fd[1];		
-	            newfd_list[2] = fd_list[2];
-	
-	            evaluate_expression_recursive(e->left, newfd_list, 1);
-            }
-    
-            {
-	            int newfd_list[3] ;
-	            newfd_list[0] = fd[0];
-	            newfd_list[1] = fd_list[1];		
-	            newfd_list[2] = fd_list[2];
-	
-    	        return evaluate_expression_recursive(
-                    e->right, 
-                    newfd_list, 
-                    is_background
-                );
-            }  
+        case PARALLEL:
+        {
+            return evaluate_parallel_expression(e, fd_list);
         }
 
         default:
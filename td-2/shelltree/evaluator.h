@@ -6,7 +6,7 @@
  * Executes a shell command.
  *
  * \author H. Decoudras
- * \version 7
+ * \version 12
  */
 
 #ifndef DEF_EVALUATOR_H
@@ -15,6 +15,105 @@
 #include "shelltree.h"
 
 
+/*!
+ * \enum launch_mode
+ * \brief The \ref launch_mode enumeration represents the
+ *        ways of launching a shell command.
+ */
+enum launch_mode
+{
+    /*!
+     * \brief Launches the shell commands with
+     *        [posix_spawnp](https://man7.org/linux/man-pages/man3/posix_spawn.3.html),
+     *        which does not copy the address space of the shell.
+     */
+    LAUNCH_SPAWN,
+
+    /*!
+     * \brief Launches the shell commands with
+     *        [fork](https://man7.org/linux/man-pages/man2/fork.2.html)
+     *        and
+     *        [execvp](https://man7.org/linux/man-pages/man3/exec.3.html).
+     */
+    LAUNCH_FORK
+};
+
+/*!
+ * \brief Type definition of the \ref launch_mode enumeration.
+ *
+ * \see launch_mode
+ */
+typedef enum launch_mode LaunchMode;
+
+
+/*!
+ * \enum parallel_policy
+ * \brief The \ref parallel_policy enumeration represents the
+ *        ways of computing the value of shell commands run
+ *        concurrently with the `&|` operator.
+ */
+enum parallel_policy
+{
+    /*!
+     * \brief Succeeds when every shell command succeeds, and
+     *        fails with the value of the last one which failed
+     *        otherwise.
+     */
+    PARALLEL_ALL,
+
+    /*!
+     * \brief Succeeds when any shell command succeeds.
+     */
+    PARALLEL_ANY,
+
+    /*!
+     * \brief Fails with the value of the first shell command
+     *        which fails, terminating the running ones and
+     *        launching no other.
+     */
+    PARALLEL_CANCEL
+};
+
+/*!
+ * \brief Type definition of the \ref parallel_policy enumeration.
+ *
+ * \see parallel_policy
+ */
+typedef enum parallel_policy ParallelPolicy;
+
+
+/*!
+ * \brief Way of launching the shell commands, \ref LAUNCH_SPAWN
+ *        by default.
+ */
+extern LaunchMode launch_mode;
+
+/*!
+ * \brief Makes a pipeline fail when any of its stages fails, 
+ *        rather than only its last stage, when set.
+ */
+extern int pipefail;
+
+/*!
+ * \brief Largest number of shell commands separated by `&|` run
+ *        at once, `0` for the number of processors.
+ */
+extern int parallel_limit;
+
+/*!
+ * \brief Way of computing the value of shell commands separated
+ *        by `&|`, \ref PARALLEL_ALL by default.
+ */
+extern ParallelPolicy parallel_policy;
+
+/*!
+ * \brief Set in the child processes of the shell which evaluate
+ *        shell commands, which leave the exit handlers of the shell
+ *        to the shell.
+ */
+extern int is_subshell;
+
+
 /*!
  * \brief The evaluate_expression() executes a shell command.
  *
@@ -0,0 +1,391 @@
+/*!
+ * \ingroup td_2_group
+ * \file hash.c
+ * \brief Exercise 2.5
+ *
+ * Remembers where the shell commands were found in the `PATH`.
+ *
+ * \author H. Decoudras
+ * \version 1
+ */
+
+#include "hash.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <limits.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+
+/*!
+ * \brief Directories searched when `PATH` is not set, as
+ *        [execvp](https://man7.org/linux/man-pages/man3/exec.3.html)
+ *        does.
+ */
+#define DEFAULT_PATH "/bin:/usr/bin"
+
+
+/*!
+ * \struct hash_entry
+ * \brief The \ref hash_entry structure associates a shell
+ *        command with its absolute path.
+ */
+struct hash_entry
+{
+    /*!
+     * \brief Name of the shell command, `NULL` if the entry is
+     *        free.
+     */
+    char* name;
+
+    /*!
+     * \brief Path of the shell command.
+     */
+    char* path;
+
+    /*!
+     * \brief Number of times the shell command was found in the
+     *        table.
+     */
+    size_t hits;
+};
+
+/*!
+ * \brief Type definition of the \ref hash_entry structure.
+ *
+ * \see hash_entry
+ */
+typedef struct hash_entry HashEntry;
+
+
+/*!
+ * \brief Entries of the table, with linear probing.
+ */
+static HashEntry* entries = NULL;
+
+/*!
+ * \brief Number of entries of the table, a power of two.
+ */
+static size_t capacity = 0;
+
+/*!
+ * \brief Number of shell commands of the table.
+ */
+static size_t count = 0;
+
+/*!
+ * \brief Value of `PATH` the table was filled with.
+ */
+static char* hashed_path = NULL;
+
+
+/*!
+ * \brief The hash_string() function hashes a name with the
+ *        FNV-1a function.
+ *
+ * \param s Name.
+ *
+ * \return The hash of \p s.
+ */
+static size_t hash_string(const char* s);
+
+/*!
+ * \brief The find_entry() function finds the entry of a shell
+ *        command, or the free entry where it belongs.
+ *
+ * \param name Name of the shell command.
+ *
+ * \return The entry.
+ */
+static HashEntry* find_entry(const char* name);
+
+/*!
+ * \brief The grow_table() function doubles the number of entries
+ *        of the table.
+ */
+static void grow_table(void);
+
+/*!
+ * \brief The check_path() function empties the table when `PATH`
+ *        changed since it was filled.
+ */
+static void check_path(void);
+
+/*!
+ * \brief The search_path() function looks for an executable file
+ *        in the directories of `PATH`.
+ *
+ * \param name Name of the shell command.
+ *
+ * \return The allocated path of the executable file, or `NULL`
+ *         if it is not found.
+ */
+static char* search_path(const char* name);
+
+/*!
+ * \brief The duplicate() function copies a string, exiting the
+ *        program in case of error.
+ *
+ * \param s String to copy.
+ *
+ * \return The allocated copy.
+ */
+static char* duplicate(const char* s);
+
+
+int hash_disabled = 0;
+
+HashStats hash_stats = { 0, 0, 0 };
+
+
+const char* hash_lookup(const char* name)
+{
+    HashEntry*  entry;
+    char*       path;
+
+    if (strchr(name, '/') != NULL)
+    {
+        return name;
+    }
+
+    check_path();
+
+    entry = find_entry(name);
+    if (entry != NULL && entry->name != NULL)
+    {
+        ++hash_stats.hits;
+        ++entry->hits;
+        return entry->path;
+    }
+
+    ++hash_stats.misses;
+    if ((path = search_path(name)) == NULL)
+    {
+        return NULL;
+    }
+
+    /* Keep the table at most three quarters full */
+
+    if (4 * (count + 1) > 3 * capacity)
+    {
+        grow_table();
+    }
+
+    entry = find_entry(name);
+    entry->name = duplicate(name);
+    entry->path = path;
+    entry->hits = 0;
+    ++count;
+
+    return path;
+}
+
+void hash_forget(const char* name)
+{
+    HashEntry*  entry = find_entry(name);
+    size_t      i;
+    size_t      j;
+    size_t      home;
+
+    if (entry == NULL || entry->name == NULL)
+    {
+        return;
+    }
+
+    free(entry->name);
+    free(entry->path);
+    entry->name = NULL;
+    --count;
+
+    /* Move back the following entries which belong before the hole */
+
+    i = entry - entries;
+    j = i;
+    while (1)
+    {
+        j = (j + 1) & (capacity - 1);
+        if (entries[j].name == NULL)
+        {
+            break;
+        }
+
+        home = hash_string(entries[j].name) & (capacity - 1);
+        if (((j - home) & (capacity - 1)) >= ((j - i) & (capacity - 1)))
+        {
+            entries[i] = entries[j];
+            entries[j].name = NULL;
+            i = j;
+        }
+    }
+}
+
+void hash_clear(void)
+{
+    for (size_t i = 0; i < capacity; ++i)
+    {
+        if (entries[i].name != NULL)
+        {
+            free(entries[i].name);
+            free(entries[i].path);
+            entries[i].name = NULL;
+        }
+    }
+
+    count = 0;
+}
+
+void hash_print(void)
+{
+    if (count == 0)
+    {
+        printf("hash: hash table empty\n");
+    }
+    else
+    {
+        printf("hits\tcommand\n");
+        for (size_t i = 0; i < capacity; ++i)
+        {
+            if (entries[i].name != NULL)
+            {
+                printf("%4zu\t%s\n", entries[i].hits, entries[i].path);
+            }
+        }
+    }
+
+    fflush(stdout);
+}
+
+
+size_t hash_string(const char* s)
+{
+    size_t hash = 14695981039346656037ULL;
+
+    while (*s != '\0')
+    {
+        hash ^= (unsigned char)*s++;
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+HashEntry* find_entry(const char* name)
+{
+    size_t i;
+
+    if (capacity == 0)
+    {
+        return NULL;
+    }
+
+    i = hash_string(name) & (capacity - 1);
+    while (entries[i].name != NULL && strcmp(entries[i].name, name) != 0)
+    {
+        i = (i + 1) & (capacity - 1);
+    }
+
+    return &entries[i];
+}
+
+void grow_table(void)
+{
+    HashEntry*  old_entries = entries;
+    size_t      old_capacity = capacity;
+    HashEntry*  entry;
+
+    capacity = capacity == 0 ? HASH_CAPACITY : 2 * capacity;
+    if ((entries = (HashEntry*)calloc(capacity, sizeof(HashEntry))) == NULL)
+    {
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t i = 0; i < old_capacity; ++i)
+    {
+        if (old_entries[i].name != NULL)
+        {
+            entry = find_entry(old_entries[i].name);
+            *entry = old_entries[i];
+        }
+    }
+
+    free(old_entries);
+}
+
+void check_path(void)
+{
+    const char* path = getenv("PATH");
+
+    if (path == NULL)
+    {
+        path = DEFAULT_PATH;
+    }
+
+    if (hashed_path != NULL && strcmp(hashed_path, path) == 0)
+    {
+        return;
+    }
+
+    hash_clear();
+    free(hashed_path);
+    hashed_path = duplicate(path);
+}
+
+char* search_path(const char* name)
+{
+    struct stat file_stat;
+    const char* directory = hashed_path;
+    const char* end;
+    char        candidate[PATH_MAX];
+    int         length;
+
+    while (1)
+    {
+        if ((end = strchr(directory, ':')) == NULL)
+        {
+            end = directory + strlen(directory);
+        }
+
+        /* An empty directory is the working directory */
+
+        length = end == directory ?
+            snprintf(candidate, sizeof(candidate), "./%s", name) :
+            snprintf(candidate, sizeof(candidate), "%.*s/%s",
+                     (int)(end - directory), directory, name);
+
+        if (length > 0 && (size_t)length < sizeof(candidate))
+        {
+            ++hash_stats.probes;
+            if (access(candidate, X_OK) == 0 &&
+                stat(candidate, &file_stat) == 0 &&
+                S_ISREG(file_stat.st_mode))
+            {
+                return duplicate(candidate);
+            }
+        }
+
+        if (*end == '\0')
+        {
+            return NULL;
+        }
+
+        directory = end + 1;
+    }
+}
+
+char* duplicate(const char* s)
+{
+    char* copy = strdup(s);
+
+    if (copy == NULL)
+    {
+        perror("strdup");
+        exit(EXIT_FAILURE);
+    }
+
+    return copy;
+}
@@ -0,0 +1,109 @@
+/*!
+ * \ingroup td_2_group
+ * \file hash.h
+ * \brief Exercise 2.5
+ *
+ * Remembers where the shell commands were found in the `PATH`.
+ *
+ * A shell command is looked for in the directories of the `PATH`
+ * environment variable the first time it is launched, and its
+ * absolute path is kept in a hash table for the next launches. The
+ * table is emptied when `PATH` changes.
+ *
+ * \author H. Decoudras
+ * \version 1
+ */
+
+#ifndef DEF_HASH_H
+#define DEF_HASH_H
+
+#include <stddef.h>
+
+
+/*!
+ * \brief Initial number of entries of the hash table.
+ */
+#define HASH_CAPACITY 64
+
+
+/*!
+ * \struct hash_stats
+ * \brief The \ref hash_stats structure counts the lookups
+ *        of the hash table.
+ */
+struct hash_stats
+{
+    /*!
+     * \brief Number of shell commands found in the table.
+     */
+    size_t hits;
+
+    /*!
+     * \brief Number of shell commands looked for in the `PATH`.
+     */
+    size_t misses;
+
+    /*!
+     * \brief Number of files examined in the directories of
+     *        the `PATH`.
+     */
+    size_t probes;
+};
+
+/*!
+ * \brief Type definition of the \ref hash_stats structure.
+ *
+ * \see hash_stats
+ */
+typedef struct hash_stats HashStats;
+
+
+/*!
+ * \brief Searches the `PATH` at each launch, as
+ *        [execvp](https://man7.org/linux/man-pages/man3/exec.3.html)
+ *        does, when set.
+ */
+extern int hash_disabled;
+
+/*!
+ * \brief Counters of the hash table.
+ */
+extern HashStats hash_stats;
+
+
+/*!
+ * \brief The hash_lookup() function finds the absolute path of
+ *        a shell command.
+ *
+ *        A name containing a slash is returned as is.
+ *
+ * \param name Name of the shell command.
+ *
+ * \return The path of the shell command, valid until the table
+ *         is modified, or `NULL` if it is not found in the
+ *         `PATH`.
+ */
+extern const char* hash_lookup(const char* name);
+
+/*!
+ * \brief The hash_forget() function removes a shell command from
+ *        the table, when its path no longer exists.
+ *
+ * \param name Name of the shell command.
+ */
+extern void hash_forget(const char* name);
+
+/*!
+ * \brief The hash_clear() function empties the table.
+ */
+extern void hash_clear(void);
+
+/*!
+ * \brief The hash_print() function displays the shell commands of
+ *        the table with their number of hits on the standard
+ *        output.
+ */
+extern void hash_print(void);
+
+
+#endif // DEF_HASH_H
@@ -0,0 +1,727 @@
+/*!
+ * \ingroup td_2_group
+ * \file jobs.c
+ * \brief Exercise 2.5
+ *
+ * Keeps track of the jobs launched by the shell.
+ *
+ * \author H. Decoudras
+ * \version 2
+ */
+
+#define _GNU_SOURCE
+
+#include "jobs.h"
+#include "evaluator.h"
+#include "display.h"
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+
+/*!
+ * \brief Initial number of entries of the table of the jobs.
+ */
+#define JOBS_CAPACITY 16
+
+
+/*!
+ * \brief Jobs of the shell, by increasing number.
+ */
+static Job** jobs = NULL;
+
+/*!
+ * \brief Number of jobs of the table.
+ */
+static int job_count = 0;
+
+/*!
+ * \brief Number of entries of the table.
+ */
+static int job_capacity = 0;
+
+/*!
+ * \brief Terminal of the shell under job control, or `-1`.
+ */
+static int terminal = -1;
+
+/*!
+ * \brief Process group of the shell.
+ */
+static pid_t shell_pgid = 0;
+
+/*!
+ * \brief Signals of the terminal, ignored by the shell under job
+ *        control.
+ */
+static const int terminal_signals[] = {
+    SIGINT,
+    SIGQUIT,
+    SIGTSTP,
+    SIGTTIN,
+    SIGTTOU
+};
+
+
+/*!
+ * \brief The handle_sigchld() function reaps every child process
+ *        which changed state, without blocking.
+ *
+ * \param signal Number of the signal.
+ */
+static void handle_sigchld(int signal);
+
+/*!
+ * \brief The update_process() function records the new state of
+ *        a process in its job.
+ *
+ * \param pid Identifier of the process.
+ * \param status Value reported by
+ *               [waitpid](https://man7.org/linux/man-pages/man2/waitpid.2.html).
+ */
+static void update_process(pid_t pid, int status);
+
+/*!
+ * \brief The job_state() function computes the state of a job from
+ *        the state of its processes.
+ *
+ * \param job Job.
+ *
+ * \return The state of the job.
+ */
+static JobState job_state(const Job* job);
+
+/*!
+ * \brief The exit_value() function converts a value reported by
+ *        `waitpid` into the value of a shell command.
+ *
+ * \param status Value reported by `waitpid`.
+ *
+ * \return The value of the process, or `128` plus the number of the
+ *         signal which ended or stopped it.
+ */
+static int exit_value(int status);
+
+/*!
+ * \brief The job_value() function computes the value of a job
+ *        which ended or stopped.
+ *
+ * \param job Job.
+ *
+ * \return The value of the job, as for job_wait().
+ */
+static int job_value(const Job* job);
+
+/*!
+ * \brief The print_job() function displays a job with its state.
+ *
+ * \param job Job.
+ */
+static void print_job(const Job* job);
+
+/*!
+ * \brief The remove_jobs() function removes the background jobs
+ *        which have ended.
+ *
+ * \param print_all Displays every job, rather than only the jobs
+ *                  removed under job control.
+ */
+static void remove_jobs(int print_all);
+
+/*!
+ * \brief The remove_job() function removes a job from the table.
+ *
+ * \param job Job to remove.
+ */
+static void remove_job(Job* job);
+
+
+int job_control = 0;
+
+JobStats job_stats = { 0, 0, 0 };
+
+
+void jobs_init(int terminal_fd)
+{
+    struct sigaction action;
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_sigchld;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+
+    if (sigaction(SIGCHLD, &action, NULL) < 0)
+    {
+        perror("sigaction");
+        exit(EXIT_FAILURE);
+    }
+
+    if (terminal_fd < 0)
+    {
+        return;
+    }
+
+    /* Wait to be in the foreground before taking the terminal */
+
+    while (tcgetpgrp(terminal_fd) != (shell_pgid = getpgrp()))
+    {
+        kill(-shell_pgid, SIGTTIN);
+    }
+
+    for (size_t i = 0;
+         i < sizeof(terminal_signals) / sizeof(terminal_signals[0]); ++i)
+    {
+        signal(terminal_signals[i], SIG_IGN);
+    }
+
+    /* A session leader already leads its process group */
+
+    if (setpgid(0, 0) == 0)
+    {
+        shell_pgid = getpid();
+    }
+
+    tcsetpgrp(terminal_fd, shell_pgid);
+    terminal = terminal_fd;
+    job_control = 1;
+}
+
+void jobs_reset(void)
+{
+    for (int i = 0; i < job_count; ++i)
+    {
+        free(jobs[i]->command);
+        free(jobs[i]);
+    }
+
+    for (size_t i = 0;
+         i < sizeof(terminal_signals) / sizeof(terminal_signals[0]); ++i)
+    {
+        signal(terminal_signals[i], SIG_DFL);
+    }
+
+    job_count = 0;
+    job_control = 0;
+    terminal = -1;
+    jobs_unblock();
+}
+
+void jobs_reset_signals(void)
+{
+    sigset_t signals;
+
+    jobs_default_signals(&signals);
+    for (int i = 1; i < NSIG; ++i)
+    {
+        if (sigismember(&signals, i) == 1)
+        {
+            signal(i, SIG_DFL);
+        }
+    }
+
+    sigemptyset(&signals);
+    sigprocmask(SIG_SETMASK, &signals, NULL);
+}
+
+void jobs_default_signals(sigset_t* signals)
+{
+    sigemptyset(signals);
+    sigaddset(signals, SIGCHLD);
+    for (size_t i = 0;
+         i < sizeof(terminal_signals) / sizeof(terminal_signals[0]); ++i)
+    {
+        sigaddset(signals, terminal_signals[i]);
+    }
+}
+
+void jobs_block(void)
+{
+    sigset_t signals;
+
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &signals, NULL);
+}
+
+void jobs_unblock(void)
+{
+    sigset_t signals;
+
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGCHLD);
+    sigprocmask(SIG_UNBLOCK, &signals, NULL);
+}
+
+Job* job_add(pid_t pgid, const pid_t* pids, int count, Expression* e,
+             int is_background)
+{
+    Job* job;
+
+    if (job_count == job_capacity)
+    {
+        job_capacity = job_capacity == 0 ? JOBS_CAPACITY : 2 * job_capacity;
+        if ((jobs = (Job**)realloc(jobs, job_capacity * sizeof(Job*)))
+            == NULL)
+        {
+            perror("realloc");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    /* The processes are stored with the job in a single block */
+
+    job = (Job*)malloc(sizeof(Job) +
+                       count * (sizeof(pid_t) + sizeof(JobState) +
+                                sizeof(int)));
+    if (job == NULL)
+    {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+
+    job->id = job_count == 0 ? 1 : jobs[job_count - 1]->id + 1;
+    job->pgid = pgid;
+    job->pids = (pid_t*)(job + 1);
+    job->states = (JobState*)(job->pids + count);
+    job->statuses = (int*)(job->states + count);
+    job->count = count;
+    job->is_background = is_background;
+
+    /* A process which could not be launched has failed */
+
+    for (int i = 0; i < count; ++i)
+    {
+        job->pids[i] = pids[i];
+        job->states[i] = pids[i] > 0 ? JOB_RUNNING : JOB_DONE;
+        job->statuses[i] = pids[i] > 0 ? 0 : EXIT_FAILURE << 8;
+    }
+
+    /* Only the jobs which can be displayed need their command line */
+
+    job->command = is_background || job_control ?
+                    format_expression(e) : NULL;
+
+    jobs[job_count++] = job;
+    ++job_stats.launched;
+    if ((size_t)job_count > job_stats.max_jobs)
+    {
+        job_stats.max_jobs = job_count;
+    }
+
+    return job;
+}
+
+void job_announce(const Job* job)
+{
+    if (job_control)
+    {
+        printf("[%d] %d\n", job->id, (int)job->pids[job->count - 1]);
+        fflush(stdout);
+    }
+}
+
+int job_wait(Job* job)
+{
+    sigset_t    signals;
+    JobState    state;
+    int         value;
+    int         foreground = job_control && !job->is_background &&
+                             job->pgid > 0;
+
+    sigprocmask(SIG_BLOCK, NULL, &signals);
+    sigdelset(&signals, SIGCHLD);
+
+    if (foreground)
+    {
+        tcsetpgrp(terminal, job->pgid);
+    }
+
+    /* The handler of SIGCHLD updates the job while suspended */
+
+    while ((state = job_state(job)) == JOB_RUNNING ||
+           (state == JOB_STOPPED && !job_control))
+    {
+        sigsuspend(&signals);
+    }
+
+    if (foreground)
+    {
+        tcsetpgrp(terminal, shell_pgid);
+    }
+
+    value = job_value(job);
+    if (state == JOB_STOPPED)
+    {
+        job->is_background = 1;
+        putchar('\n');
+        print_job(job);
+        return value;
+    }
+
+    remove_job(job);
+    return value;
+}
+
+int jobs_wait_any(Job** set, int count)
+{
+    sigset_t signals;
+
+    sigprocmask(SIG_BLOCK, NULL, &signals);
+    sigdelset(&signals, SIGCHLD);
+
+    while (1)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            if (job_state(set[i]) == JOB_DONE)
+            {
+                return i;
+            }
+        }
+
+        sigsuspend(&signals);
+    }
+}
+
+int job_signal(const Job* job, int signal_number)
+{
+    if (job->pgid > 0)
+    {
+        return kill(-job->pgid, signal_number);
+    }
+
+    for (int i = 0; i < job->count; ++i)
+    {
+        if (job->states[i] != JOB_DONE && 
+            kill(job->pids[i], signal_number) < 0)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+Job* job_find(const char* spec)
+{
+    char*   end;
+    long    number;
+
+    if (spec == NULL || strcmp(spec, "%%") == 0 || strcmp(spec, "%+") == 0)
+    {
+        return job_count == 0 ? NULL : jobs[job_count - 1];
+    }
+
+    number = strtol(spec[0] == '%' ? spec + 1 : spec, &end, 10);
+    if (*end != '\0' || end == spec || number <= 0)
+    {
+        return NULL;
+    }
+
+    for (int i = 0; i < job_count; ++i)
+    {
+        if (spec[0] == '%' && jobs[i]->id == number)
+        {
+            return jobs[i];
+        }
+
+        for (int j = 0; spec[0] != '%' && j < jobs[i]->count; ++j)
+        {
+            if (jobs[i]->pids[j] == number)
+            {
+                return jobs[i];
+            }
+        }
+    }
+
+    return NULL;
+}
+
+int job_continue(Job* job, int is_background)
+{
+    if (!job_control || job->pgid <= 0)
+    {
+        errno = EPERM;
+        return -1;
+    }
+
+    if (job_state(job) == JOB_STOPPED && kill(-job->pgid, SIGCONT) < 0)
+    {
+        return -1;
+    }
+
+    /* Running again, without waiting for SIGCHLD to tell */
+
+    for (int i = 0; i < job->count; ++i)
+    {
+        if (job->states[i] == JOB_STOPPED)
+        {
+            job->states[i] = JOB_RUNNING;
+        }
+    }
+
+    job->is_background = is_background;
+    return 0;
+}
+
+void jobs_print(void)
+{
+    remove_jobs(1);
+}
+
+void jobs_notify(void)
+{
+    remove_jobs(0);
+}
+
+void jobs_wait_all(void)
+{
+    sigset_t    signals;
+    int         running = 1;
+
+    jobs_block();
+    sigprocmask(SIG_BLOCK, NULL, &signals);
+    sigdelset(&signals, SIGCHLD);
+
+    while (running)
+    {
+        running = 0;
+        for (int i = 0; i < job_count && !running; ++i)
+        {
+            running = job_state(jobs[i]) == JOB_RUNNING;
+        }
+
+        if (running)
+        {
+            sigsuspend(&signals);
+        }
+    }
+
+    /* Waited for jobs are not reported */
+
+    for (int i = job_count - 1; i >= 0; --i)
+    {
+        if (job_state(jobs[i]) == JOB_DONE)
+        {
+            remove_job(jobs[i]);
+        }
+    }
+
+    jobs_unblock();
+}
+
+
+void handle_sigchld(int signal)
+{
+    int     saved_errno = errno;
+    int     status;
+    pid_t   pid;
+
+    (void)signal;
+
+    /* Several children may end for a single signal */
+
+    while ((pid = waitpid(-1, &status,
+                          WNOHANG | WUNTRACED | WCONTINUED)) > 0)
+    {
+        update_process(pid, status);
+    }
+
+    errno = saved_errno;
+}
+
+void update_process(pid_t pid, int status)
+{
+    /* Recent jobs are the most likely to change */
+
+    for (int i = job_count - 1; i >= 0; --i)
+    {
+        for (int j = 0; j < jobs[i]->count; ++j)
+        {
+            if (jobs[i]->pids[j] != pid)
+            {
+                continue;
+            }
+
+            if (WIFSTOPPED(status))
+            {
+                jobs[i]->states[j] = JOB_STOPPED;
+            }
+            else if (WIFCONTINUED(status))
+            {
+                jobs[i]->states[j] = JOB_RUNNING;
+                return;
+            }
+            else
+            {
+                jobs[i]->states[j] = JOB_DONE;
+                ++job_stats.reaped;
+            }
+
+            jobs[i]->statuses[j] = status;
+            return;
+        }
+    }
+
+    if (!WIFSTOPPED(status) && !WIFCONTINUED(status))
+    {
+        ++job_stats.reaped;
+    }
+}
+
+JobState job_state(const Job* job)
+{
+    JobState state = JOB_DONE;
+
+    for (int i = 0; i < job->count; ++i)
+    {
+        if (job->states[i] == JOB_RUNNING)
+        {
+            return JOB_RUNNING;
+        }
+
+        if (job->states[i] == JOB_STOPPED)
+        {
+            state = JOB_STOPPED;
+        }
+    }
+
+    return state;
+}
+
+int exit_value(int status)
+{
+    if (WIFEXITED(status))
+    {
+        return WEXITSTATUS(status);
+    }
+
+    if (WIFSIGNALED(status))
+    {
+        return 128 + WTERMSIG(status);
+    }
+
+    return WIFSTOPPED(status) ? 128 + WSTOPSIG(status) : 0;
+}
+
+int job_value(const Job* job)
+{
+    int value = exit_value(job->statuses[job->count - 1]);
+
+    for (int i = 0; i < job->count; ++i)
+    {
+        if (job->states[i] == JOB_STOPPED)
+        {
+            return exit_value(job->statuses[i]);
+        }
+    }
+
+    for (int i = 0; pipefail && i < job->count; ++i)
+    {
+        if (exit_value(job->statuses[i]) != 0)
+        {
+            value = exit_value(job->statuses[i]);
+        }
+    }
+
+    return value;
+}
+
+void print_job(const Job* job)
+{
+    int     status = job->statuses[job->count - 1];
+    char    state[64];
+
+    switch (job_state(job))
+    {
+        case JOB_RUNNING:
+        {
+            strcpy(state, "Running");
+            break;
+        }
+
+        case JOB_STOPPED:
+        {
+            strcpy(state, "Stopped");
+            break;
+        }
+
+        default:
+        {
+            if (WIFSIGNALED(status))
+            {
+                snprintf(state, sizeof(state), "%s",
+                         strsignal(WTERMSIG(status)));
+            }
+            else if (job_value(job) != 0)
+            {
+                snprintf(state, sizeof(state), "Exit %d", job_value(job));
+            }
+            else
+            {
+                strcpy(state, "Done");
+            }
+        }
+    }
+
+    printf("[%d]  %-24s%s\n", job->id, state,
+           job->command != NULL ? job->command : "");
+}
+
+void remove_jobs(int print_all)
+{
+    int kept = 0;
+    int done;
+
+    jobs_block();
+    fflush(stdout);
+
+    for (int i = 0; i < job_count; ++i)
+    {
+        done = jobs[i]->is_background && job_state(jobs[i]) == JOB_DONE;
+        if (print_all || (done && job_control))
+        {
+            print_job(jobs[i]);
+        }
+
+        if (done)
+        {
+            free(jobs[i]->command);
+            free(jobs[i]);
+        }
+        else
+        {
+            jobs[kept++] = jobs[i];
+        }
+    }
+
+    job_count = kept;
+    fflush(stdout);
+    jobs_unblock();
+}
+
+void remove_job(Job* job)
+{
+    int i = job_count - 1;
+
+    while (i >= 0 && jobs[i] != job)
+    {
+        --i;
+    }
+
+    if (i < 0)
+    {
+        return;
+    }
+
+    memmove(&jobs[i], &jobs[i + 1], (job_count - i - 1) * sizeof(Job*));
+    --job_count;
+    free(job->command);
+    free(job);
+}
@@ -0,0 +1,314 @@
+/*!
+ * \ingroup td_2_group
+ * \file jobs.h
+ * \brief Exercise 2.5
+ *
+ * Keeps track of the jobs launched by the shell.
+ *
+ * A job gathers the processes launched for a shell command, a
+ * pipeline or a background task. The processes are reaped as soon
+ * as they change state, by the handler of the
+ * [SIGCHLD](https://man7.org/linux/man-pages/man7/signal.7.html)
+ * signal, which records their value in the table of the jobs. The
+ * table is only modified by the shell while the signal is blocked.
+ *
+ * When job control is on, as in an interactive shell, each job
+ * runs in a process group of its own, which is handed the terminal
+ * while it runs in the foreground.
+ *
+ * \author H. Decoudras
+ * \version 2
+ */
+
+#ifndef DEF_JOBS_H
+#define DEF_JOBS_H
+
+#include "shelltree.h"
+
+#include <sys/types.h>
+#include <signal.h>
+
+
+/*!
+ * \enum job_state
+ * \brief The \ref job_state enumeration represents the state
+ *        of a job.
+ */
+enum job_state
+{
+    /*!
+     * \brief At least one process of the job is running.
+     */
+    JOB_RUNNING,
+
+    /*!
+     * \brief No process of the job is running, and at least one
+     *        is stopped.
+     */
+    JOB_STOPPED,
+
+    /*!
+     * \brief Every process of the job has ended.
+     */
+    JOB_DONE
+};
+
+/*!
+ * \brief Type definition of the \ref job_state enumeration.
+ *
+ * \see job_state
+ */
+typedef enum job_state JobState;
+
+
+/*!
+ * \struct job
+ * \brief The \ref job structure represents the processes
+ *        launched for a shell command.
+ */
+struct job
+{
+    /*!
+     * \brief Number of the job, as displayed by `jobs`.
+     */
+    int id;
+
+    /*!
+     * \brief Process group of the job, or `-1` if the processes
+     *        stay in the process group of the shell.
+     */
+    pid_t pgid;
+
+    /*!
+     * \brief Processes of the job, from left to right.
+     */
+    pid_t* pids;
+
+    /*!
+     * \brief State of each process of the job.
+     */
+    JobState* states;
+
+    /*!
+     * \brief Value of each process of the job.
+     */
+    int* statuses;
+
+    /*!
+     * \brief Number of processes of the job.
+     */
+    int count;
+
+    /*!
+     * \brief Whether the job runs in the background.
+     */
+    int is_background;
+
+    /*!
+     * \brief Shell command of the job.
+     */
+    char* command;
+};
+
+/*!
+ * \brief Type definition of the \ref job structure.
+ *
+ * \see job
+ */
+typedef struct job Job;
+
+
+/*!
+ * \struct job_stats
+ * \brief The \ref job_stats structure counts the jobs.
+ */
+struct job_stats
+{
+    /*!
+     * \brief Number of jobs launched.
+     */
+    size_t launched;
+
+    /*!
+     * \brief Number of processes reaped.
+     */
+    size_t reaped;
+
+    /*!
+     * \brief Largest number of jobs in the table at once.
+     */
+    size_t max_jobs;
+};
+
+/*!
+ * \brief Type definition of the \ref job_stats structure.
+ *
+ * \see job_stats
+ */
+typedef struct job_stats JobStats;
+
+
+/*!
+ * \brief Whether each job runs in a process group of its own.
+ */
+extern int job_control;
+
+/*!
+ * \brief Counters of the jobs.
+ */
+extern JobStats job_stats;
+
+
+/*!
+ * \brief The jobs_init() function installs the handler of the
+ *        `SIGCHLD` signal.
+ *
+ *        With job control, the shell moves to a process group of
+ *        its own, takes the terminal, and ignores the signals of
+ *        the terminal, which are meant for the foreground job.
+ *
+ * \param terminal_fd Terminal of the shell, or `-1` to run
+ *                    without job control.
+ */
+extern void jobs_init(int terminal_fd);
+
+/*!
+ * \brief The jobs_reset() function empties the table in a child
+ *        process of the shell, which runs without job control.
+ */
+extern void jobs_reset(void);
+
+/*!
+ * \brief The jobs_reset_signals() function restores the default
+ *        signal dispositions and mask, in a child process of the
+ *        shell about to execute a shell command.
+ */
+extern void jobs_reset_signals(void);
+
+/*!
+ * \brief The jobs_default_signals() function fills a set with
+ *        the signals the shell ignores or catches, restored to
+ *        their default disposition in the shell commands launched.
+ *
+ * \param signals Set of signals to fill.
+ */
+extern void jobs_default_signals(sigset_t* signals);
+
+/*!
+ * \brief The jobs_block() function blocks the `SIGCHLD` signal
+ *        before processes are launched, so that they are not
+ *        reaped before their job is added.
+ */
+extern void jobs_block(void);
+
+/*!
+ * \brief The jobs_unblock() function unblocks the `SIGCHLD`
+ *        signal.
+ */
+extern void jobs_unblock(void);
+
+/*!
+ * \brief The job_add() function adds a job to the table.
+ *
+ *        The `SIGCHLD` signal must be blocked.
+ *
+ * \param pgid Process group of the job, or `-1`.
+ * \param pids Processes of the job.
+ * \param count Number of processes.
+ * \param e Shell command of the job.
+ * \param is_background Whether the job runs in the background.
+ *
+ * \return The added job.
+ */
+extern Job* job_add(pid_t pgid, const pid_t* pids, int count,
+                    Expression* e, int is_background);
+
+/*!
+ * \brief The job_announce() function displays the number of a
+ *        job launched in the background and the identifier of its
+ *        last process, under job control.
+ *
+ * \param job Job launched in the background.
+ */
+extern void job_announce(const Job* job);
+
+/*!
+ * \brief The job_wait() function waits until a job ends or stops,
+ *        with the terminal handed to its process group under job
+ *        control, and removes it from the table once it has ended.
+ *
+ *        The `SIGCHLD` signal must be blocked.
+ *
+ * \param job Job to wait for.
+ *
+ * \return The value of the last process of the job, or of the last
+ *         one which failed when \ref pipefail is set, or `128` plus
+ *         the number of the signal which stopped the job.
+ */
+extern int job_wait(Job* job);
+
+/*!
+ * \brief The jobs_wait_any() function waits until any job of a
+ *        set ends, without removing it from the table.
+ *
+ *        The `SIGCHLD` signal must be blocked.
+ *
+ * \param set Jobs to wait for.
+ * \param count Number of jobs of \p set.
+ *
+ * \return The index in \p set of a job which has ended.
+ */
+extern int jobs_wait_any(Job** set, int count);
+
+/*!
+ * \brief The job_signal() function sends a signal to the running
+ *        processes of a job.
+ *
+ * \param job Job.
+ * \param signal_number Signal to send.
+ *
+ * \return `0` in case of success, `-1` otherwise.
+ */
+extern int job_signal(const Job* job, int signal_number);
+
+/*!
+ * \brief The job_find() function finds a job.
+ *
+ * \param spec `%<number>` or the identifier of a process of the
+ *             job, `NULL` for the most recent job.
+ *
+ * \return The job, or `NULL` if it does not exist.
+ */
+extern Job* job_find(const char* spec);
+
+/*!
+ * \brief The job_continue() function resumes a stopped job.
+ *
+ * \param job Job to resume.
+ * \param is_background Whether the job resumes in the background.
+ *
+ * \return `0` in case of success, `-1` otherwise.
+ */
+extern int job_continue(Job* job, int is_background);
+
+/*!
+ * \brief The jobs_print() function displays the jobs and removes
+ *        the jobs which have ended.
+ */
+extern void jobs_print(void);
+
+/*!
+ * \brief The jobs_notify() function removes the background jobs
+ *        which have ended, displaying them if the shell is
+ *        interactive.
+ */
+extern void jobs_notify(void);
+
+/*!
+ * \brief The jobs_wait_all() function waits until every
+ *        background job ends.
+ */
+extern void jobs_wait_all(void);
+
+
+#endif // DEF_JOBS_H
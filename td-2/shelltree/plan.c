@@ -0,0 +1,404 @@
+/*!
+ * \ingroup td_2_group
+ * \file plan.c
+ * \brief Exercise 2.5
+ *
+ * Remembers the syntax trees of the command lines already parsed.
+ *
+ * \author H. Decoudras
+ * \version 1
+ */
+
+#include "plan.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+
+/*!
+ * \struct plan
+ * \brief The \ref plan structure heads the block holding the
+ *        flattened syntax tree of a command line.
+ *
+ *        The block holds, after the structure, the nodes of the
+ *        tree, then the lists of arguments, then the command line
+ *        and the arguments themselves.
+ */
+struct plan
+{
+    /*!
+     * \brief Hash of the command line.
+     */
+    size_t hash;
+
+    /*!
+     * \brief Length of the command line.
+     */
+    size_t length;
+
+    /*!
+     * \brief Command line, stored in the block.
+     */
+    char* line;
+
+    /*!
+     * \brief Root of the syntax tree, stored in the block.
+     */
+    Expression* root;
+
+    /*!
+     * \brief Size of the block.
+     */
+    size_t size;
+};
+
+/*!
+ * \brief Type definition of the \ref plan structure.
+ *
+ * \see plan
+ */
+typedef struct plan Plan;
+
+
+/*!
+ * \struct plan_cursor
+ * \brief The \ref plan_cursor structure points to the free room
+ *        of each part of the block of a plan being compiled.
+ */
+struct plan_cursor
+{
+    /*!
+     * \brief Next free node.
+     */
+    Expression* node;
+
+    /*!
+     * \brief Next free slot of the lists of arguments.
+     */
+    char** slot;
+
+    /*!
+     * \brief Next free character.
+     */
+    char* text;
+};
+
+/*!
+ * \brief Type definition of the \ref plan_cursor structure.
+ *
+ * \see plan_cursor
+ */
+typedef struct plan_cursor PlanCursor;
+
+
+/*!
+ * \brief Entries of the table, `NULL` when free, with linear
+ *        probing.
+ */
+static Plan** entries = NULL;
+
+/*!
+ * \brief Number of entries of the table, a power of two.
+ */
+static size_t capacity = 0;
+
+/*!
+ * \brief Number of plans of the table.
+ */
+static size_t count = 0;
+
+/*!
+ * \brief Number of hits when the table was last emptied.
+ */
+static size_t cleared_hits = 0;
+
+/*!
+ * \brief Command line of the last lookup, which is stored next
+ *        when it was not found.
+ */
+static const char* last_line = NULL;
+
+/*!
+ * \brief Hash of \ref last_line.
+ */
+static size_t last_hash = 0;
+
+
+/*!
+ * \brief The hash_line() function hashes a command line with the
+ *        FNV-1a function.
+ *
+ * \param line Command line.
+ * \param length Length of the command line.
+ *
+ * \return The hash of \p line.
+ */
+static size_t hash_line(const char* line, size_t length);
+
+/*!
+ * \brief The find_entry() function finds the entry of a command
+ *        line, or the free entry where it belongs.
+ *
+ * \param line Command line.
+ * \param length Length of the command line.
+ * \param hash Hash of the command line.
+ *
+ * \return The entry.
+ */
+static Plan** find_entry(const char* line, size_t length, size_t hash);
+
+/*!
+ * \brief The grow_table() function doubles the number of entries
+ *        of the table.
+ */
+static void grow_table(void);
+
+/*!
+ * \brief The measure_expression() function counts the room a
+ *        syntax tree takes in the block of a plan.
+ *
+ * \param e Syntax tree.
+ * \param nodes Number of nodes.
+ * \param slots Number of slots of the lists of arguments.
+ * \param chars Number of characters of the arguments.
+ */
+static void measure_expression(const Expression* e, size_t* nodes,
+                               size_t* slots, size_t* chars);
+
+/*!
+ * \brief The copy_expression() function copies a syntax tree into
+ *        the block of a plan.
+ *
+ * \param e Syntax tree.
+ * \param cursor Free room of the block.
+ *
+ * \return The copy of \p e.
+ */
+static Expression* copy_expression(const Expression* e,
+                                   PlanCursor* cursor);
+
+
+int plan_disabled = 0;
+
+PlanStats plan_stats = { 0, 0, 0, 0 };
+
+
+Expression* plan_lookup(const char* line, size_t length)
+{
+    Plan** entry;
+
+    last_line = line;
+    last_hash = hash_line(line, length);
+
+    if (capacity == 0)
+    {
+        ++plan_stats.misses;
+        return NULL;
+    }
+
+    entry = find_entry(line, length, last_hash);
+    if (*entry == NULL)
+    {
+        ++plan_stats.misses;
+        return NULL;
+    }
+
+    ++plan_stats.hits;
+    return (*entry)->root;
+}
+
+void plan_store(const char* line, size_t length, Expression* e)
+{
+    size_t      hash = line == last_line ? last_hash : 
+                                           hash_line(line, length);
+    size_t      nodes = 0;
+    size_t      slots = 0;
+    size_t      chars = length + 1;
+    size_t      size;
+    Plan**      entry;
+    Plan*       plan;
+    PlanCursor  cursor;
+
+    /* Start over when full, unless the table barely paid off */
+
+    if (count >= PLAN_LIMIT)
+    {
+        plan_disabled = plan_stats.hits - cleared_hits < count;
+        plan_clear();
+
+        if (plan_disabled)
+        {
+            return;
+        }
+    }
+
+    if (4 * (count + 1) > 3 * capacity)
+    {
+        grow_table();
+    }
+
+    entry = find_entry(line, length, hash);
+    if (*entry != NULL)
+    {
+        return;
+    }
+
+    measure_expression(e, &nodes, &slots, &chars);
+    size = sizeof(Plan) + nodes * sizeof(Expression) +
+           slots * sizeof(char*) + chars;
+
+    if ((plan = (Plan*)malloc(size)) == NULL)
+    {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+
+    cursor.node = (Expression*)(plan + 1);
+    cursor.slot = (char**)(cursor.node + nodes);
+    cursor.text = (char*)(cursor.slot + slots);
+
+    plan->hash = hash;
+    plan->length = length;
+    plan->line = cursor.text;
+    plan->size = size;
+    memcpy(cursor.text, line, length);
+    cursor.text[length] = '\0';
+    cursor.text += length + 1;
+    plan->root = copy_expression(e, &cursor);
+
+    *entry = plan;
+    ++count;
+    ++plan_stats.plans;
+    plan_stats.bytes += size;
+}
+
+void plan_clear(void)
+{
+    for (size_t i = 0; i < capacity; ++i)
+    {
+        free(entries[i]);
+        entries[i] = NULL;
+    }
+
+    count = 0;
+    cleared_hits = plan_stats.hits;
+    plan_stats.bytes = 0;
+}
+
+
+size_t hash_line(const char* line, size_t length)
+{
+    size_t hash = 14695981039346656037ULL;
+
+    for (size_t i = 0; i < length; ++i)
+    {
+        hash ^= (unsigned char)line[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+Plan** find_entry(const char* line, size_t length, size_t hash)
+{
+    size_t i = hash & (capacity - 1);
+
+    while (entries[i] != NULL &&
+           (entries[i]->hash != hash || entries[i]->length != length ||
+            memcmp(entries[i]->line, line, length) != 0))
+    {
+        i = (i + 1) & (capacity - 1);
+    }
+
+    return &entries[i];
+}
+
+void grow_table(void)
+{
+    Plan**  old_entries = entries;
+    size_t  old_capacity = capacity;
+    size_t  i;
+
+    capacity = capacity == 0 ? PLAN_CAPACITY : 2 * capacity;
+    if ((entries = (Plan**)calloc(capacity, sizeof(Plan*))) == NULL)
+    {
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t j = 0; j < old_capacity; ++j)
+    {
+        if (old_entries[j] != NULL)
+        {
+            i = old_entries[j]->hash & (capacity - 1);
+            while (entries[i] != NULL)
+            {
+                i = (i + 1) & (capacity - 1);
+            }
+
+            entries[i] = old_entries[j];
+        }
+    }
+
+    free(old_entries);
+}
+
+void measure_expression(const Expression* e, size_t* nodes,
+                        size_t* slots, size_t* chars)
+{
+    if (e == NULL)
+    {
+        return;
+    }
+
+    ++*nodes;
+    if (e->arguments != NULL)
+    {
+        for (int i = 0; e->arguments[i] != NULL; ++i)
+        {
+            ++*slots;
+            *chars += strlen(e->arguments[i]) + 1;
+        }
+
+        ++*slots;
+    }
+
+    measure_expression(e->left, nodes, slots, chars);
+    measure_expression(e->right, nodes, slots, chars);
+}
+
+Expression* copy_expression(const Expression* e, PlanCursor* cursor)
+{
+    Expression* copy;
+    size_t      size;
+    int         i;
+
+    if (e == NULL)
+    {
+        return NULL;
+    }
+
+    copy = cursor->node++;
+    copy->type = e->type;
+    copy->arguments = NULL;
+
+    if (e->arguments != NULL)
+    {
+        copy->arguments = cursor->slot;
+        for (i = 0; e->arguments[i] != NULL; ++i)
+        {
+            size = strlen(e->arguments[i]) + 1;
+            memcpy(cursor->text, e->arguments[i], size);
+            copy->arguments[i] = cursor->text;
+            cursor->text += size;
+        }
+
+        copy->arguments[i] = NULL;
+        cursor->slot += i + 1;
+    }
+
+    copy->left = copy_expression(e->left, cursor);
+    copy->right = copy_expression(e->right, cursor);
+    return copy;
+}
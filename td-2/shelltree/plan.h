@@ -0,0 +1,117 @@
+/*!
+ * \ingroup td_2_group
+ * \file plan.h
+ * \brief Exercise 2.5
+ *
+ * Remembers the syntax trees of the command lines already parsed.
+ *
+ * The syntax tree of a command line only depends on its text. Once
+ * parsed, it is compiled into a plan: a copy of the tree, its lists
+ * of arguments and its file names flattened in a single block, kept
+ * in a hash table keyed by the raw command line. The next time the
+ * same command line is read, its plan is evaluated without being
+ * scanned nor parsed again.
+ *
+ * \author H. Decoudras
+ * \version 2
+ */
+
+#ifndef DEF_PLAN_H
+#define DEF_PLAN_H
+
+#include "shelltree.h"
+
+#include <stddef.h>
+
+
+/*!
+ * \brief Initial number of entries of the table of the plans.
+ */
+#define PLAN_CAPACITY 64
+
+/*!
+ * \brief Largest number of plans kept. Once reached, the table is
+ *        emptied, and turned off if fewer command lines were found
+ *        in it than it holds plans.
+ */
+#define PLAN_LIMIT 4096
+
+
+/*!
+ * \struct plan_stats
+ * \brief The \ref plan_stats structure counts the lookups
+ *        of the table of the plans.
+ */
+struct plan_stats
+{
+    /*!
+     * \brief Number of command lines found in the table.
+     */
+    size_t hits;
+
+    /*!
+     * \brief Number of command lines which had to be parsed.
+     */
+    size_t misses;
+
+    /*!
+     * \brief Number of plans compiled.
+     */
+    size_t plans;
+
+    /*!
+     * \brief Number of bytes of the plans of the table.
+     */
+    size_t bytes;
+};
+
+/*!
+ * \brief Type definition of the \ref plan_stats structure.
+ *
+ * \see plan_stats
+ */
+typedef struct plan_stats PlanStats;
+
+
+/*!
+ * \brief Parses every command line, without the table of the plans,
+ *        when set. Also set when the command lines do not repeat
+ *        themselves enough for the table to pay off.
+ */
+extern int plan_disabled;
+
+/*!
+ * \brief Counters of the table of the plans.
+ */
+extern PlanStats plan_stats;
+
+
+/*!
+ * \brief The plan_lookup() function finds the plan of a command
+ *        line.
+ *
+ * \param line Command line, without its line feed.
+ * \param length Length of the command line.
+ *
+ * \return The syntax tree of the plan, which must not be modified,
+ *         or `NULL` if the command line has no plan.
+ */
+extern Expression* plan_lookup(const char* line, size_t length);
+
+/*!
+ * \brief The plan_store() function compiles the plan of a command
+ *        line which has just been parsed.
+ *
+ * \param line Command line, without its line feed.
+ * \param length Length of the command line.
+ * \param e Syntax tree of the command line.
+ */
+extern void plan_store(const char* line, size_t length, Expression* e);
+
+/*!
+ * \brief The plan_clear() function empties the table.
+ */
+extern void plan_clear(void);
+
+
+#endif // DEF_PLAN_H
@@ -5,34 +5,64 @@
  *
  * Builds a syntax tree and evaluates shell commands.
  *
+ * The syntax tree of each command line is allocated from an arena,
+ * which is reset in constant time once the command line has been
+ * evaluated.
+ *
+ * Command lines are parsed one at a time by a recursive descent
+ * parser which reads them in place. Scripts, given as a file or with
+ * the `-c` option, are read line by line, from memory when the script
+ * is a regular file, without `readline`, history nor display of the
+ * syntax trees.
+ *
+ * An interactive shell runs each job in a process group of its own,
+ * to which the terminal is handed while the job is in the foreground.
+ *
+ * The command lines are looked up in a table of plans before being
+ * parsed, so that a command line read again is evaluated without
+ * being parsed again.
+ *
  * \author H. Decoudras
- * \version 1
+ * \version 11
  */
 
 #include "shelltree.h"
+#include "analysis.h"
 #include "display.h"
 #include "evaluator.h"
+#include "builtins.h"
+#include "hash.h"
+#include "jobs.h"
+#include "plan.h"
 
 #include <readline/readline.h>
 #include <readline/history.h>
 
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <time.h>
 #include <stdio.h>
 
 
 /*!
- * \brief The yyparse_string() function parses a string.
- *
- * \param s String to be parsed.
- *
- * \return This function can return the following values:
- *          - **YYACCEPT** if parsing was successful (return is due 
- *            to end-of-input)
- *          - **YYABORT** if parsing failed because of invalid input, 
- *            i.e., input that contains a syntax error or that causes
- *            `YYABORT` to be invoked
- *          - **YYNOMEM** if parsing failed due to memory exhaustion
+ * \brief Size of the buffer of a script read from a pipe or a
+ *        terminal.
  */
-extern int yyparse_string(char* s);
+#define SCRIPT_BUFFER_SIZE (1 << 16)
+
+/*!
+ * \brief Value of a command line which could not be parsed.
+ */
+#define SYNTAX_ERROR_STATUS 2
+
+/*!
+ * \brief One command line in \ref PLAN_SAMPLE has its lookup in the
+ *        table of the plans timed, and is parsed again when found,
+ *        to measure the parse time the table saves.
+ */
+#define PLAN_SAMPLE 64
 
 
 /*!
@@ -41,97 +71,151 @@ extern int yyparse_string(char* s);
 static int interactive_mode = 1;
 
 /*!
- * \brief The my_yyparse() function parses a string.
- *
- * \return This function can return the following values:
- *          - **YYACCEPT** if parsing was successful (return is due 
- *            to end-of-input)
- *          - **YYABORT** if parsing failed because of invalid input,
- *            i.e., input that contains a syntax error or that causes
- *            `YYABORT` to be invoked
- *          - **YYNOMEM** if parsing failed due to memory exhaustion
+ * \brief Parses the command lines without displaying nor
+ *        evaluating them.
  */
-static int my_yyparse(void);
+static int parse_only = 0;
 
+/*!
+ * \brief Number of command lines parsed.
+ */
+static size_t line_count = 0;
 
-int status = 0;
+/*!
+ * \brief Time spent parsing the command lines, in nanoseconds.
+ */
+static long long parse_time = 0;
 
+/*!
+ * \brief Time spent looking up the sampled command lines in the
+ *        table of the plans, in nanoseconds.
+ */
+static long long sample_lookup_time = 0;
 
-Expression* new_node(ExpressionType type, Expression* l, 
-                     Expression* r, char** args)
-{
-    Expression* e;
+/*!
+ * \brief Number of sampled lookups.
+ */
+static size_t sample_lookups = 0;
 
-    if ((e = (Expression*)malloc(sizeof(Expression))) == NULL)
-    {
-        perror("malloc");
-        exit(EXIT_FAILURE);
-    }
+/*!
+ * \brief Time spent parsing again the sampled command lines found
+ *        in the table of the plans, in nanoseconds.
+ */
+static long long sample_parse_time = 0;
 
-    e->type = type;
-    e->left = l;
-    e->right = r;
-    e->arguments = args;
-    return e;
-}
+/*!
+ * \brief Number of sampled command lines parsed again.
+ */
+static size_t sample_parses = 0;
 
-void delete_node(Expression* e)
-{
-    if (e == NULL)
-    {
-        return;
-    }
+/*!
+ * \brief Time spent compiling the plans, in nanoseconds.
+ */
+static long long store_time = 0;
 
-    delete_node(e->left);
-    delete_node(e->right);
+/*!
+ * \brief Time the program started at.
+ */
+static struct timespec program_start;
 
-    if (e->arguments != NULL)
-    {
-        for (int i = 0; e->arguments[i] != NULL; i++)
-        {
-            free(e->arguments[i]);
-        }
+/*!
+ * \brief Next command line of a script held in memory.
+ */
+static const char* script_cursor = NULL;
 
-        free(e->arguments);
-    }
+/*!
+ * \brief End of a script held in memory.
+ */
+static const char* script_end = NULL;
 
-    free(e);
-}
+/*!
+ * \brief Script read line by line from a pipe or a terminal.
+ */
+static FILE* script_stream = NULL;
 
-char** new_args_list(void)
-{
-    char** l = (char**)calloc(ARGS_COUNT + 1, sizeof(char*));
-    *l = NULL;
-    return l;
-}
+/*!
+ * \brief Last command line read from \ref script_stream.
+ */
+static char* stream_line = NULL;
 
-char** append_to_args_list(char** l, char* arg)
-{
-    char** new_l = l + args_list_size(l);
-    *new_l = (char*)malloc(1 + strlen(arg));
-    strcpy(*new_l++, arg);
-    *new_l = NULL;
-    return l;
-}
+/*!
+ * \brief Size of \ref stream_line.
+ */
+static size_t stream_capacity = 0;
 
-int args_list_size(char** l) 
-{
-    char** p;
-    for (p = l; *p != NULL; p++);
-    return p - l;
-}
+/*!
+ * \brief The parse_next_line() function reads the next command
+ *        line and builds its syntax tree, or finds its plan.
+ *
+ *        The program exits at the end of the input.
+ *
+ * \param e Syntax tree of the command line.
+ *
+ * \return `0` in case of success, `-1` in case of syntax error.
+ */
+static int parse_next_line(Expression** e);
 
-void end_of_file(void)
-{
-    exit(EXIT_SUCCESS);
-}
+/*!
+ * \brief The elapsed_time() function gets the time elapsed since
+ *        a given time.
+ *
+ * \param start Time to measure from.
+ *
+ * \return The time elapsed since \p start, in nanoseconds.
+ */
+static long long elapsed_time(const struct timespec* start);
+
+/*!
+ * \brief The read_line() function reads the next command line,
+ *        with `readline` or from a script read line by line.
+ *
+ * \param length Length of the command line.
+ *
+ * \return The command line, without its line feed, which is not
+ *         null-terminated, or `NULL` at the end of the input.
+ */
+static const char* read_line(size_t* length);
 
-/* Call yyparse() */
+/*!
+ * \brief The load_script_string() function makes read_line() read
+ *        the script given with the `-c` option.
+ *
+ * \param script Shell commands.
+ */
+static void load_script_string(const char* script);
 
-void yyerror(char* s)
-{
-    fprintf(stderr, "%s\n", s);
-}
+/*!
+ * \brief The load_script_file() function makes read_line() read
+ *        a script file.
+ *
+ *        A regular file is mapped in memory and split into lines
+ *        in place. Other files are read by blocks.
+ *
+ * \param path Path of the script, or `NULL` for the standard
+ *             input.
+ */
+static void load_script_file(const char* path);
+
+/*!
+ * \brief The print_statistics() function displays the number
+ *        of command lines parsed, the allocations of the arena,
+ *        the mean parse time and the counters of the tables of
+ *        the shell on the standard error output.
+ */
+static void print_statistics(void);
+
+/*!
+ * \brief The use() function displays how to use the
+ *        program and exits.
+ *
+ * \param program Name of the program.
+ */
+static void use(const char* program);
+
+
+int status = 0;
+
+Arena parse_arena;
 
 
 /*!
@@ -139,62 +223,416 @@ void yyerror(char* s)
  *
  * Builds a syntax tree and evaluates shell commands.
  *
+ * The shell commands are read from the script given as argument,
+ * from the \p command of the `-c` option, or from the standard
+ * input, with `readline` when it is a terminal.
+ *
+ * The following options are accepted:
+ *  - **-b** runs every shell command as an external command,
+ *    without the builtins
+ *  - **-c command** runs \p command as a script
+ *  - **-f** launches the shell commands with `fork` instead of
+ *    `posix_spawn`
+ *  - **-n** parses the command lines without displaying nor
+ *    evaluating them
+ *  - **-p** parses every command line, without the table of the
+ *    plans
+ *  - **-u** searches the `PATH` at each launch, without the hash
+ *    table of the shell commands
+ *  - **-s** displays the number of command lines parsed, the
+ *    allocations and the mean parse time when the program exits
+ *
  * \param argc Number of arguments of the program.
  * \param argv Arguments of the program.
  *
- * \return The following values can be returned:
- *          - [EXIT_SUCCESS](https://man7.org/linux/man-pages/man3/exit.3.html)
- *            in case of success
- *          - [EXIT_FAILURE](https://man7.org/linux/man-pages/man3/exit.3.html) 
- *            in case of error
+ * \return The value of the last shell command run, or
+ *         [EXIT_FAILURE](https://man7.org/linux/man-pages/man3/exit.3.html) 
+ *         in case of error.
  */
 int main(int argc, char** argv)
 {
-    using_history();
+    struct timespec start;
+    struct timespec end;
+    Expression*     e;
+    const char*     script = NULL;
+    int             option;
+    int             result;
+
+    clock_gettime(CLOCK_MONOTONIC, &program_start);
+
+    while ((option = getopt(argc, argv, "bc:fnpsu")) != -1)
+    {
+        switch (option)
+        {
+            case 'b':
+            {
+                builtins_disabled = 1;
+                break;
+            }
+
+            case 'c':
+            {
+                script = optarg;
+                break;
+            }
+
+            case 'f':
+            {
+                launch_mode = LAUNCH_FORK;
+                break;
+            }
+
+            case 'n':
+            {
+                parse_only = 1;
+                break;
+            }
+
+            case 'p':
+            {
+                plan_disabled = 1;
+                break;
+            }
+
+            case 's':
+            {
+                atexit(print_statistics);
+                break;
+            }
+
+            case 'u':
+            {
+                hash_disabled = 1;
+                break;
+            }
+
+            default:
+            {
+                use(argv[0]);
+            }
+        }
+    }
+
+    if (argc - optind > 1 || (script != NULL && argc > optind))
+    {
+        use(argv[0]);
+    }
+
+    /* Read scripts, and a standard input which is not a terminal, 
+       without readline */
+
+    interactive_mode = script == NULL && optind == argc && 
+                       isatty(STDIN_FILENO);
+
+    if (script != NULL)
+    {
+        load_script_string(script);
+    }
+    else if (optind < argc)
+    {
+        load_script_file(argv[optind]);
+    }
+    else if (!interactive_mode)
+    {
+        load_script_file(NULL);
+    }
+    else
+    {
+        using_history();
+    }
+
+    /* Job control only makes sense with a terminal */
+
+    jobs_init(interactive_mode ? STDIN_FILENO : -1);
+
+    arena_init(&parse_arena);
     while (1)
     {
-        if (my_yyparse() == 0)
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        result = parse_next_line(&e);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        parse_time += (end.tv_sec - start.tv_sec) * 1000000000LL +
+                      (end.tv_nsec - start.tv_nsec);
+        ++line_count;
+
+        if (result == 0)
         {
             /* Analysis successful */
 
-            print_expression(processed);
-            status = evaluate_expression(processed);
-            delete_node(processed);
+            if (!parse_only)
+            {
+                if (interactive_mode)
+                {
+                    print_expression(e);
+                }
+
+                status = evaluate_expression(e);
+            }
         }
         else
         {
-            /* Analysis error */
+            /* Analysis error: as sh, a script stops at its first
+               syntax error */
+
+            status = SYNTAX_ERROR_STATUS;
+            if (!interactive_mode)
+            {
+                exit(status);
+            }
         }
+
+        /* Report the background jobs which ended, and release the
+           syntax tree at once */
+
+        jobs_notify();
+        arena_reset(&parse_arena);
     }
 
     return EXIT_SUCCESS;
 }
 
 
-int my_yyparse(void)
+int parse_next_line(Expression** e)
+{
+    struct timespec start;
+    Expression*     sample;
+    const char*     line;
+    size_t          length;
+
+    if ((line = read_line(&length)) == NULL)
+    {
+        exit(status);
+    }
+
+    /* A command line read again is not parsed again. A sampled one
+       is timed, and parsed again when found, to measure the parse
+       time the plans save */
+
+    if (!plan_disabled && line_count % PLAN_SAMPLE != 0)
+    {
+        if ((*e = plan_lookup(line, length)) != NULL)
+        {
+            return 0;
+        }
+    }
+    else if (!plan_disabled)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        *e = plan_lookup(line, length);
+        sample_lookup_time += elapsed_time(&start);
+        ++sample_lookups;
+
+        if (*e != NULL)
+        {
+            /* Time a warm parse, as when every command line is
+               parsed */
+
+            parse_command_line(&parse_arena, line, length, &sample);
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            parse_command_line(&parse_arena, line, length, &sample);
+            sample_parse_time += elapsed_time(&start);
+            ++sample_parses;
+            return 0;
+        }
+    }
+
+    if (parse_command_line(&parse_arena, line, length, e) != 0)
+    {
+        fprintf(stderr, "syntax error\n");
+        return -1;
+    }
+
+    if (!plan_disabled)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        plan_store(line, length, *e);
+        store_time += elapsed_time(&start);
+    }
+
+    return 0;
+}
+
+long long elapsed_time(const struct timespec* start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000000000LL +
+           (now.tv_nsec - start->tv_nsec);
+}
+
+const char* read_line(size_t* length)
 {
+    const char* line;
+    const char* next;
+    char*       command;
+    ssize_t     read_length;
+
     if (interactive_mode)
     {
-        char* line = NULL;
         char buffer[1024];
         snprintf(buffer, 1024, "shelltree(%d):", status);
-        line = readline(buffer);
-        if (line != NULL)
+        if ((command = readline(buffer)) == NULL)
         {
-            int ret;
-            add_history(line);
-            strncat(line, "\n", 1);
-            ret = yyparse_string(line);
-            free(line);
-            return ret;
+            return NULL;
         }
-        else
+
+        *length = strlen(command);
+        line = arena_strndup(&parse_arena, command, *length);
+        add_history(command);
+        free(command);
+        return line;
+    }
+
+    if (script_stream != NULL)
+    {
+        read_length = getline(&stream_line, &stream_capacity, 
+                              script_stream);
+        if (read_length <= 0)
+        {
+            return NULL;
+        }
+
+        /* The last line of the script may lack its line feed */
+
+        *length = read_length;
+        if (stream_line[read_length - 1] == '\n')
+        {
+            --*length;
+        }
+
+        return stream_line;
+    }
+
+    if (script_cursor == script_end)
+    {
+        return NULL;
+    }
+
+    line = script_cursor;
+    if ((next = (const char*)memchr(line, '\n', script_end - line)) == NULL)
+    {
+        *length = script_end - line;
+        script_cursor = script_end;
+        return line;
+    }
+
+    *length = next - line;
+    script_cursor = next + 1;
+    return line;
+}
+
+
+void load_script_string(const char* script)
+{
+    script_cursor = script;
+    script_end = script + strlen(script);
+}
+
+void load_script_file(const char* path)
+{
+    struct stat file_stat;
+    char*       base;
+    FILE*       file = stdin;
+    int         fd = STDIN_FILENO;
+
+    if (path != NULL && (fd = open(path, O_RDONLY)) < 0)
+    {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+
+    if (fstat(fd, &file_stat) == 0 && S_ISREG(file_stat.st_mode) &&
+        file_stat.st_size > 0 &&
+        (base = (char*)mmap(NULL, file_stat.st_size, PROT_READ, 
+                            MAP_PRIVATE, fd, 0)) != MAP_FAILED)
+    {
+        if (fd != STDIN_FILENO)
         {
-            end_of_file();
-            return -1;
+            close(fd);
         }
+
+        madvise(base, file_stat.st_size, MADV_SEQUENTIAL);
+        script_cursor = base;
+        script_end = base + file_stat.st_size;
+        return;
+    }
+
+    /* Pipes and terminals are read by blocks */
+
+    if (path != NULL && (file = fdopen(fd, "r")) == NULL)
+    {
+        perror(path);
+        exit(EXIT_FAILURE);
     }
 
-    return yyparse();
+    setvbuf(file, NULL, _IOFBF, SCRIPT_BUFFER_SIZE);
+    script_stream = file;
+}
+
+void print_statistics(void)
+{
+    struct timespec now;
+    double          elapsed;
+    size_t          lookups;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    elapsed = (now.tv_sec - program_start.tv_sec) + 
+              (now.tv_nsec - program_start.tv_nsec) / 1e9;
+
+    fprintf(
+        stderr,
+        "Lines: [%zu] Allocations: [%zu] Blocks: [%zu] "
+        "Parse: [%.0f ns/line] Rate: [%.0f lines/s]\n",
+        line_count,
+        parse_arena.allocations,
+        parse_arena.blocks,
+        line_count > 0 ? 
+            (double)(parse_time - sample_parse_time) / line_count : 0.0,
+        elapsed > 0 ? line_count / elapsed : 0.0
+    );
+    fprintf(
+        stderr,
+        "Hash hits: [%zu] Hash misses: [%zu] Probes: [%zu]\n",
+        hash_stats.hits,
+        hash_stats.misses,
+        hash_stats.probes
+    );
+    fprintf(
+        stderr,
+        "Jobs: [%zu] Reaped: [%zu] Max jobs: [%zu]\n",
+        job_stats.launched,
+        job_stats.reaped,
+        job_stats.max_jobs
+    );
+
+    /* Each hit saves the parse time of a command line parsed again,
+       less the time spent looking up every command line and
+       compiling the plans */
+
+    lookups = plan_stats.hits + plan_stats.misses;
+    fprintf(
+        stderr,
+        "Plans: [%zu] Plan hits: [%zu] Plan misses: [%zu] "
+        "Hit rate: [%.1f %%] Parse saved: [%.1f ms]\n",
+        plan_stats.plans,
+        plan_stats.hits,
+        plan_stats.misses,
+        lookups > 0 ? 100.0 * plan_stats.hits / lookups : 0.0,
+        sample_lookups > 0 ? 
+            ((sample_parses > 0 ? plan_stats.hits * 
+                 ((double)sample_parse_time / sample_parses) : 0.0) -
+             lookups * ((double)sample_lookup_time / sample_lookups) -
+             store_time) / 1e6 : 0.0
+    );
 }
 
+void use(const char* program)
+{
+    fprintf(stderr, 
+            "Use:\n  %s [-b] [-f] [-n] [-p] [-s] [-u] "
+            "[-c <command> | <script>]\n", 
+            program);
+    exit(EXIT_FAILURE);
+}
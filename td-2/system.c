@@ -18,6 +18,8 @@
 #include <string.h>
 #include <errno.h>
 
+#include "prsio.h"
+
 
 /*!
  * \brief The use() function displays how to use the
@@ -43,21 +45,6 @@ static void use(const char* program);
  */
 static void exit_on_argv_error(int argc, char** argv);
 
-/*!
- * \brief The exit_on_error() function exits the program
- *        if the \p assertion parameter is evaluated
- *        to `TRUE`.
- *
- * If the assertion is evaluated to `TRUE` and
- * [errno](https://man7.org/linux/man-pages/man3/errno.3.html)
- * is set, then the error number and its associated message
- * are displayed. Otherwise, a generic message is displayed.
- *
- * \param assertion Assertion to be evaluated.
- */
-static void exit_on_error(int assertion);
-
-
 /*!
  * \brief The exec_command() function executes a shell
  *        command.
@@ -107,21 +94,6 @@ void exit_on_argv_error(int argc, char** argv)
     }
 }
 
-void exit_on_error(int assertion)
-{
-    if (assertion)
-    {
-        if (errno) 
-        {
-            fprintf(stderr, "[%d]: %s\n", errno, strerror(errno));
-            exit(EXIT_FAILURE);
-        }
-        
-        fprintf(stderr, "An error occured!\n");
-        exit(EXIT_FAILURE);
-    }
-}
-
 void exec_command(const char* command)
 {
     int result = system(command);
@@ -5,6 +5,9 @@
  *
  * Sequentially distributes a calculation across several processes.
  *
+ * Each process reads and writes the rational numbers through a
+ * buffered reader and a buffered writer.
+ *
  * This program uses the following system calls:
  *
  *  - [pipe(int pipefd[2])](https://man7.org/linux/man-pages/man2/pipe.2.html)
@@ -16,7 +19,7 @@
  *  - [close(int fd)](https://man7.org/linux/man-pages/man2/close.2.html)
  *
  * \author H. Decoudras
- * \version 1
+ * \version 2
  */
 
 #include <sys/types.h>
@@ -30,6 +33,8 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "prsio.h"
+
 
 /*!
  * \brief Number of child processes.
@@ -42,32 +47,18 @@
  */
 typedef void (*func_ptr)(double*);
 
-/*!
- * \brief The exit_on_error() function exits the program
- *        if the \p assertion parameter is evaluated
- *        to `TRUE`.
- *
- * If the assertion is evaluated to `TRUE` and
- * [errno](https://man7.org/linux/man-pages/man3/errno.3.html)
- * is set, then the error number and its associated message
- * are displayed. Otherwise, a generic message is displayed.
- *
- * \param assertion Assertion to be evaluated.
- */
-static void exit_on_error(int assertion);
-
-
 /*!
  * \brief The read_next_double() function reads a double
  *        from the standard input.
  *
+ * \param reader Reader of the standard input.
  * \param value Value to read.
  *
  * \return This function can return the following values:
  *          - **0** if a double has been read
  *          - **-1** if nothing has been read
  */
-static int read_next_double(double* value);
+static int read_next_double(IoReader* reader, double* value);
 
 
 /*!
@@ -128,10 +119,12 @@ static func_ptr func[] = {g1, g2, g3, g4};
  */
 int main(void)
 {
-    int     fd[N][2];
-    int     result;
-    ssize_t rw_result;
-    pid_t   wait_result;
+    IoReader    reader;
+    IoWriter    writer;
+    int         fd[N][2];
+    int         result;
+    ssize_t     rw_result;
+    pid_t       wait_result;
 
     for (int i = 0; i < N; ++i)
     {
@@ -202,13 +195,24 @@ int main(void)
                 exit_on_error(result < 0);
             }
 
-            while ((rw_result = read_next_double(&value)) != -1)
+            result = io_reader_open(&reader, STDIN_FILENO, 0);
+            exit_on_error(result < 0);
+
+            result = io_writer_open(&writer, STDOUT_FILENO, 0);
+            exit_on_error(result < 0);
+
+            while ((rw_result = read_next_double(&reader, &value)) != -1)
             {       
                 func[i](&value);
-                rw_result = write(STDOUT_FILENO, &value, sizeof(double));
+                rw_result = io_writer_write(&writer, &value, sizeof(double));
                 exit_on_error(rw_result < 0);
             } 
 
+            io_reader_close(&reader);
+
+            result = io_writer_close(&writer);
+            exit_on_error(result < 0);
+
             exit(EXIT_SUCCESS);
         }
     }
@@ -221,24 +225,10 @@ int main(void)
 }
 
 
-void exit_on_error(int assertion)
-{
-    if (assertion)
-    {
-        if (errno)
-        {
-            fprintf(stderr, "[%d]: %s\n", errno, strerror(errno));
-            exit(EXIT_FAILURE);
-        }
-
-        fprintf(stderr, "An error occured!\n");
-        exit(EXIT_FAILURE);
-    }
-}
-
-int read_next_double(double* value)
+int read_next_double(IoReader* reader, double* value)
 {
-    if (read(STDIN_FILENO, value, sizeof(double)) <= 0)
+    if (io_reader_read(reader, value, sizeof(double)) <
+        (ssize_t)sizeof(double))
     {
         return -1;
     }
@@ -5,6 +5,9 @@
  *
  * Generates a file of rational numbers.
  *
+ * The rational numbers are gathered by a buffered writer, so that
+ * they are written with few system calls.
+ *
  * This program uses the following system calls:
  * 
  *  - [open(const char\* pathname, int flags, mode_t mode)](https://man7.org/linux/man-pages/man2/open.2.html)
@@ -12,7 +15,7 @@
  *  - [close(int fd)](https://man7.org/linux/man-pages/man2/close.2.html)
  *
  * \author H. Decoudras
- * \version 1
+ * \version 2
  */
 
 #include <sys/types.h>
@@ -25,6 +28,8 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "prsio.h"
+
 /*!
  * \brief File name.
  */
@@ -55,20 +60,6 @@ static void use(const char* program);
  */
 static void exit_on_argv_error(int argc, char** argv);
 
-/*!
- * \brief The exit_on_error() function exits the program
- *        if the \p assertion parameter is evaluated
- *        to `TRUE`.
- *
- * If the assertion is evaluated to `TRUE` and
- * [errno](https://man7.org/linux/man-pages/man3/errno.3.html)
- * is set, then the error number and its associated message
- * are displayed. Otherwise, a generic message is displayed.
- *
- * \param assertion Assertion to be evaluated.
- */
-static void exit_on_error(int assertion);
-
 
 /*!
  * \brief Main entry point of the program.
@@ -106,22 +97,29 @@ int main(int argc, char** argv)
     int fd = open(FNAME, O_CREAT | O_WRONLY | O_TRUNC, 0666);
     exit_on_error(fd < 0);
 
-    double  d = 1.0;
-    ssize_t rw_result; 
+    IoWriter    writer;
+    double      d = 1.0;
+    ssize_t     rw_result;
+
+    int result = io_writer_open(&writer, fd, 0);
+    exit_on_error(result < 0);
 
     /* Write to the output file */
 
     for (int i = 0; i < k; ++i)
     {
-        rw_result = write(fd, &d, sizeof(double));
+        rw_result = io_writer_write(&writer, &d, sizeof(double));
         exit_on_error(rw_result < 0);
 
         d *= 1.333;
     }
 
+    result = io_writer_close(&writer);
+    exit_on_error(result < 0);
+
     /* Close the output file */
 
-    int result = close(fd);
+    result = close(fd);
     exit_on_error(result < 0);
 
     return EXIT_SUCCESS;
@@ -142,18 +140,3 @@ void exit_on_argv_error(int argc, char** argv)
     }
 }
 
-void exit_on_error(int assertion)
-{
-    if (assertion)
-    {
-        if (errno) 
-        {
-            fprintf(stderr,"[%d]: %s\n", errno, strerror(errno));
-            exit(EXIT_FAILURE);
-        }
-        
-        fprintf(stderr, "An error occured!\n");
-        exit(EXIT_FAILURE);
-    }
-}
-
@@ -18,7 +18,7 @@
  *  - [execvp(const char\* file, char\* const argv[])](https://man7.org/linux/man-pages/man3/exec.3.html)  
  *
  * \author H. Decoudras
- * \version 1
+ * \version 2
  */
 
 #include <sys/types.h>
@@ -32,6 +32,8 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "prsio.h"
+
 
 /*!
  * \brief Buffer size.
@@ -63,20 +65,6 @@ static void use(const char* program);
  */
 static void exit_on_argv_error(int argc, char** argv);
 
-/*!
- * \brief The exit_on_error() function exits the program
- *        if the \p assertion parameter is evaluated
- *        to `TRUE`.
- *
- * If the assertion is evaluated to `TRUE` and
- * [errno](https://man7.org/linux/man-pages/man3/errno.3.html)
- * is set, then the error number and its associated message
- * are displayed. Otherwise, a generic message is displayed.
- *
- * \param assertion Assertion to be evaluated.
- */
-static void exit_on_error(int assertion);
-
 
 /*!
  * \brief Main entry point of the program.
@@ -173,16 +161,12 @@ int main(int argc, char** argv)
         /* Read the output of the command */
 
         char buffer[BUFF_SIZE];
-        ssize_t rw_result = read(fd[0], buffer, BUFF_SIZE);
+        ssize_t rw_result = read_full(fd[0], buffer, BUFF_SIZE);
         exit_on_error(rw_result < 0);
 
         /* Write the output of the command on the standard output */
 
-        rw_result = write(
-            STDOUT_FILENO, 
-            buffer, 
-            strlen(buffer) * sizeof(char)
-        );
+        rw_result = write_full(STDOUT_FILENO, buffer, rw_result);
         exit_on_error(rw_result < 0);
 
         /* Close the read side of the pipe */
@@ -240,18 +224,3 @@ void exit_on_argv_error(int argc, char** argv)
     }
 }
 
-void exit_on_error(int assertion)
-{
-    if (assertion)
-    {
-        if (errno) 
-        {
-            fprintf(stderr, "[%d]: %s\n", errno, strerror(errno));
-            exit(EXIT_FAILURE);
-        }
-        
-        fprintf(stderr, "An error occured!\n");
-        exit(EXIT_FAILURE);
-    }
-}
-
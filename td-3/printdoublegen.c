@@ -13,8 +13,11 @@
  *  - [write(int fd, const void\* buf, size_t count)](https://man7.org/linux/man-pages/man2/write.2.html)
  *  - [close(int fd)](https://man7.org/linux/man-pages/man2/close.2.html)
  *
+ * The rational numbers are read and converted by batches of
+ * \ref BATCH_COUNT.
+ *
  * \author H. Decoudras
- * \version 1
+ * \version 3
  */
 
 #include <sys/types.h>
@@ -27,6 +30,20 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "convert.h"
+#include "prsio.h"
+
+
+/*!
+ * \brief Number of rational numbers read and displayed at once.
+ */
+#define BATCH_COUNT 4096
+
+/*!
+ * \brief Number of digits displayed after the decimal point.
+ */
+#define PRECISION 10
+
 
 /*!
  * \brief The use() function displays how to use the
@@ -52,20 +69,6 @@ static void use(const char* program);
  */
 static void exit_on_argv_error(int argc, char** argv);
 
-/*!
- * \brief The exit_on_error() function exits the program
- *        if the \p assertion parameter is evaluated
- *        to `TRUE`.
- *
- * If the assertion is evaluated to `TRUE` and
- * [errno](https://man7.org/linux/man-pages/man3/errno.3.html)
- * is set, then the error number and its associated message
- * are displayed. Otherwise, a generic message is displayed.
- *
- * \param assertion Assertion to be evaluated.
- */
-static void exit_on_error(int assertion);
-
 
 /*!
  * \brief Main entry point of the program.
@@ -94,8 +97,12 @@ int main(int argc, char** argv)
     exit_on_argv_error(argc, argv);
 
     int     fd;
-    double  i;
-    char    buffer[64];
+    double  values[BATCH_COUNT];
+    char    partial[sizeof(double)];
+    char*   buffer;
+    size_t  count;
+    size_t  tail;
+    size_t  length;
     int     result;
     ssize_t rw_result;
 
@@ -104,23 +111,38 @@ int main(int argc, char** argv)
     fd = open(argv[1], O_RDONLY);
     exit_on_error(fd < 0);
 
+    buffer = malloc(BATCH_COUNT * DOUBLE_TEXT_LENGTH);
+    exit_on_error(buffer == NULL);
+
     /* Display the numbers */
 
-    while ((rw_result = read(fd, &i, sizeof(double))))
+    values[0] = 0;
+    while ((rw_result = read_full(fd, values, sizeof(values))))
     {
         exit_on_error(rw_result < 0);
 
-        result = sprintf(buffer, "%.10lf", i);
-        buffer[result]      = '\n';
-        buffer[result + 1]  = '\0';
-        
-        rw_result = write(
-            STDOUT_FILENO, 
-            buffer, 
-            (result + 1) * sizeof(char)
-        );
+        /* A trailing partial number keeps the bytes of the previous one */
+
+        count = rw_result / sizeof(double);
+        tail = rw_result % sizeof(double);
+        if (tail > 0 && count > 0)
+        {
+            memcpy(partial, &values[count], tail);
+            values[count] = values[count - 1];
+            memcpy(&values[count], partial, tail);
+        }
+
+        count += tail > 0;
+
+        length = doubles_to_text(buffer, values, count, PRECISION, '\n');
+
+        rw_result = write_full(STDOUT_FILENO, buffer, length);
         exit_on_error(rw_result < 0);
-    }    
+
+        values[0] = values[count - 1];
+    }
+
+    free(buffer);
 
     /* Close the file */
 
@@ -145,18 +167,3 @@ void exit_on_argv_error(int argc, char** argv)
     }
 }
 
-void exit_on_error(int assertion)
-{
-    if (assertion)
-    {
-        if (errno)
-        {
-            fprintf(stderr, "[%d]: %s\n", errno, strerror(errno));
-            exit(EXIT_FAILURE);
-        }
-
-        fprintf(stderr, "An error occured!\n");
-        exit(EXIT_FAILURE);
-    }
-}
-
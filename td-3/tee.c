@@ -4,22 +4,41 @@
  * \brief Exercise 3.5
  *
  * Reads the content of the standard input and writes
- * it on the standard output and in a file.
+ * it on the standard output and in one or more files.
  *
- * This program uses the following system calls: 
+ * When the standard input is a pipe, its content is duplicated
+ * into a pipe per output with
+ * [tee(int fd_in, int fd_out, size_t len, unsigned int flags)](https://man7.org/linux/man-pages/man2/tee.2.html)
+ * and moved to each output with
+ * [splice(int fd_in, off64_t\* off_in, int fd_out, off64_t\* off_out, size_t len, unsigned int flags)](https://man7.org/linux/man-pages/man2/splice.2.html),
+ * so that it never enters the user space. Otherwise, it is read
+ * into large buffers with
+ * [readv(int fd, const struct iovec\* iov, int iovcnt)](https://man7.org/linux/man-pages/man2/readv.2.html)
+ * and written on each output with
+ * [writev(int fd, const struct iovec\* iov, int iovcnt)](https://man7.org/linux/man-pages/man2/writev.2.html).
+ *
+ * This program uses the following system calls:
  *
  *  - [open(const char\* pathname, int flags, mode_t mode)](https://man7.org/linux/man-pages/man2/open.2.html)
+ *  - [pipe2(int pipefd[2], int flags)](https://man7.org/linux/man-pages/man2/pipe.2.html)
+ *  - [fcntl(int fd, int cmd, ...)](https://man7.org/linux/man-pages/man2/fcntl.2.html)
+ *  - [tee(int fd_in, int fd_out, size_t len, unsigned int flags)](https://man7.org/linux/man-pages/man2/tee.2.html)
+ *  - [splice(int fd_in, off64_t\* off_in, int fd_out, off64_t\* off_out, size_t len, unsigned int flags)](https://man7.org/linux/man-pages/man2/splice.2.html)
  *  - [read(int fd, void\* buf, size_t count)](https://man7.org/linux/man-pages/man2/read.2.html)
+ *  - [readv(int fd, const struct iovec\* iov, int iovcnt)](https://man7.org/linux/man-pages/man2/readv.2.html)
  *  - [write(int fd, const void\* buf, size_t count)](https://man7.org/linux/man-pages/man2/write.2.html)
+ *  - [writev(int fd, const struct iovec\* iov, int iovcnt)](https://man7.org/linux/man-pages/man2/writev.2.html)
  *  - [close(int fd)](https://man7.org/linux/man-pages/man2/close.2.html)
  *
  * \author H. Decoudras
- * \version 1
+ * \version 3
  */
 
+#define _GNU_SOURCE
+
 #include <sys/types.h>
 #include <sys/stat.h>
-#include <sys/wait.h>
+#include <sys/uio.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
@@ -28,11 +47,52 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "prsio.h"
+
+
+/*!
+ * \brief Requested capacity of the standard input and of the
+ *        duplicate pipes.
+ */
+#define PIPE_SIZE (1 << 20)
+
+/*!
+ * \brief Number of buffers filled by each call to
+ *        [readv(int fd, const struct iovec\* iov, int iovcnt)](https://man7.org/linux/man-pages/man2/readv.2.html).
+ */
+#define VECTOR_COUNT 4
+
+/*!
+ * \brief Size of each buffer filled by
+ *        [readv(int fd, const struct iovec\* iov, int iovcnt)](https://man7.org/linux/man-pages/man2/readv.2.html).
+ */
+#define VECTOR_SIZE (1 << 18)
+
 
 /*!
- * \brief Size of the buffer.
+ * \struct tee_output
+ * \brief Output of the standard input.
  */
-#define BUFFER_SIZE 4096
+typedef struct tee_output
+{
+    /*!
+     * \brief File descriptor of the output.
+     */
+    int fd;
+
+    /*!
+     * \brief Pipe holding the duplicate of the standard input
+     *        not yet written on the output.
+     */
+    int duplicate[2];
+
+    /*!
+     * \brief Whether the output refused
+     *        [splice(int fd_in, off64_t\* off_in, int fd_out, off64_t\* off_out, size_t len, unsigned int flags)](https://man7.org/linux/man-pages/man2/splice.2.html),
+     *        the duplicate is then read and written.
+     */
+    int copy;
+} TeeOutput;
 
 
 /*!
@@ -60,31 +120,78 @@ static void use(const char* program);
 static void exit_on_argv_error(int argc, char** argv);
 
 /*!
- * \brief The exit_on_error() function exits the program
- *        if the \p assertion parameter is evaluated
- *        to `TRUE`.
+ * \brief The open_duplicates() function creates the duplicate
+ *        pipe of each output.
  *
- * If the assertion is evaluated to `TRUE` and
- * [errno](https://man7.org/linux/man-pages/man3/errno.3.html)
- * is set, then the error number and its associated message
- * are displayed. Otherwise, a generic message is displayed.
+ *        Each duplicate pipe must hold as much as the standard
+ *        input, so that a whole pipe of data is duplicated at
+ *        once.
  *
- * \param assertion Assertion to be evaluated.
+ * \param outputs Outputs.
+ * \param count Number of outputs.
+ *
+ * \return The capacity of the pipes, or **0** if they cannot be
+ *         created, the duplicates being closed.
  */
-static void exit_on_error(int assertion);
+static int open_duplicates(TeeOutput* outputs, size_t count);
 
+/*!
+ * \brief The drain_duplicate() function moves the content of
+ *        the duplicate pipe of an output to the output.
+ *
+ * \param output Output.
+ * \param length Number of bytes of the duplicate pipe.
+ * \param buffer Buffer of \ref VECTOR_COUNT times
+ *               \ref VECTOR_SIZE bytes, allocated when the output
+ *               refuses to splice.
+ */
+static void drain_duplicate(TeeOutput* output, size_t length,
+                            char** buffer);
 
 /*!
- * \brief Main entry point of the program. 
+ * \brief The tee_with_splice() function duplicates the standard
+ *        input, a pipe, on the outputs without copying it into the
+ *        user space.
+ *
+ *        Each round duplicates the content of the standard input
+ *        into the duplicate pipe of each output but the last one,
+ *        moves it into the last one, then empties every duplicate
+ *        pipe into its output.
+ *
+ * \param outputs Outputs.
+ * \param count Number of outputs.
+ * \param pipe_size Capacity of the pipes.
+ */
+static void tee_with_splice(TeeOutput* outputs, size_t count, int pipe_size);
+
+/*!
+ * \brief The tee_with_vectors() function reads the standard input
+ *        into \ref VECTOR_COUNT buffers of \ref VECTOR_SIZE bytes
+ *        and writes them on each output.
+ *
+ * \param outputs Outputs.
+ * \param count Number of outputs.
+ */
+static void tee_with_vectors(TeeOutput* outputs, size_t count);
+
+
+/*!
+ * \brief Main entry point of the program.
  *
  * Reads the content of the standard input and writes
- * it on the standard output and in a file.
+ * it on the standard output and in one or more files.
  *
- * This program uses the following system calls: 
+ * This program uses the following system calls:
  *
- *  - [open(const char\* pathname, int flags, mode_t mode)](https://man7.org/linux/man-pages/man2/open.2.html) 
+ *  - [open(const char\* pathname, int flags, mode_t mode)](https://man7.org/linux/man-pages/man2/open.2.html)
+ *  - [pipe2(int pipefd[2], int flags)](https://man7.org/linux/man-pages/man2/pipe.2.html)
+ *  - [fcntl(int fd, int cmd, ...)](https://man7.org/linux/man-pages/man2/fcntl.2.html)
+ *  - [tee(int fd_in, int fd_out, size_t len, unsigned int flags)](https://man7.org/linux/man-pages/man2/tee.2.html)
+ *  - [splice(int fd_in, off64_t\* off_in, int fd_out, off64_t\* off_out, size_t len, unsigned int flags)](https://man7.org/linux/man-pages/man2/splice.2.html)
  *  - [read(int fd, void\* buf, size_t count)](https://man7.org/linux/man-pages/man2/read.2.html)
+ *  - [readv(int fd, const struct iovec\* iov, int iovcnt)](https://man7.org/linux/man-pages/man2/readv.2.html)
  *  - [write(int fd, const void\* buf, size_t count)](https://man7.org/linux/man-pages/man2/write.2.html)
+ *  - [writev(int fd, const struct iovec\* iov, int iovcnt)](https://man7.org/linux/man-pages/man2/writev.2.html)
  *  - [close(int fd)](https://man7.org/linux/man-pages/man2/close.2.html)
  *
  * \param argc Number of arguments of the program.
@@ -93,47 +200,67 @@ static void exit_on_error(int assertion);
  * \return The following values can be returned:
  *          - [EXIT_SUCCESS](https://man7.org/linux/man-pages/man3/exit.3.html)
  *            in case of success
- *          - [EXIT_FAILURE](https://man7.org/linux/man-pages/man3/exit.3.html) 
+ *          - [EXIT_FAILURE](https://man7.org/linux/man-pages/man3/exit.3.html)
  *            in case of error
  */
 int main(int argc, char** argv)
 {
     exit_on_argv_error(argc, argv);
 
-    /* 
-        Open the output file in write only mode
+    size_t      count = argc;
+    TeeOutput*  outputs;
+    struct stat st;
+    int         pipe_size;
+    int         result;
 
-        Create the file if it does not exist and trunc
-        its content
-    */
+    outputs = calloc(count, sizeof(TeeOutput));
+    exit_on_error(outputs == NULL);
 
-    int fd = open(argv[1], O_CREAT | O_TRUNC | O_WRONLY, 0666);
-    exit_on_error(fd < 0);
+    /* The standard output comes first */
 
-    char    buffer[BUFFER_SIZE];
-    ssize_t count;
-    ssize_t rw_result;
+    outputs[0].fd = STDOUT_FILENO;
 
-    /* 
-        Display the content of the standard input 
-        and write it to a file  */
+    /*
+        Open the output files in write only mode
+
+        Create the files if they do not exist and trunc
+        their content
+    */
 
-    while ((count = read(STDIN_FILENO, buffer, 
-           BUFFER_SIZE * sizeof(char))) > 0)
+    for (size_t i = 1; i < count; ++i)
     {
-        rw_result = write(fd, buffer, count * sizeof(char));
-        exit_on_error(rw_result < 0);
+        outputs[i].fd = open(argv[i], O_CREAT | O_TRUNC | O_WRONLY, 0666);
+        exit_on_error(outputs[i].fd < 0);
+    }
 
-        buffer[count] = '\0';
+    /*
+        Display the content of the standard input
+        and write it to the files
+    */
 
-        rw_result = write(STDOUT_FILENO, buffer, count * sizeof(char));
-        exit_on_error(rw_result < 0);
+    result = fstat(STDIN_FILENO, &st);
+    exit_on_error(result < 0);
+
+    pipe_size = S_ISFIFO(st.st_mode) ? open_duplicates(outputs, count) : 0;
+
+    if (pipe_size > 0)
+    {
+        tee_with_splice(outputs, count, pipe_size);
+    }
+    else
+    {
+        tee_with_vectors(outputs, count);
     }
 
-    /* Close the file */
+    /* Close the files */
 
-    int result = close(fd);
-    exit_on_error(result < 0);
+    for (size_t i = 1; i < count; ++i)
+    {
+        result = close(outputs[i].fd);
+        exit_on_error(result < 0);
+    }
+
+    free(outputs);
 
     return EXIT_SUCCESS;
 }
@@ -141,30 +268,225 @@ int main(int argc, char** argv)
 
 void use(const char* program)
 {
-    fprintf(stderr, "Use:\n  %s <filename>\n", program);
+    fprintf(stderr, "Use:\n  %s <filename> [<filename> ...]\n", program);
     exit(EXIT_FAILURE);
 }
 
 void exit_on_argv_error(int argc, char** argv)
 {
-    if (argc != 2)
+    if (argc < 2)
     {
         use(argv[0]);
     }
 }
 
-void exit_on_error(int assertion)
+int open_duplicates(TeeOutput* outputs, size_t count)
+{
+    int pipe_size;
+    int result = 0;
+
+    /* Fewer and larger rounds, if allowed */
+
+    pipe_size = fcntl(STDIN_FILENO, F_SETPIPE_SZ, PIPE_SIZE);
+    if (pipe_size < 0)
+    {
+        pipe_size = fcntl(STDIN_FILENO, F_GETPIPE_SZ);
+        exit_on_error(pipe_size < 0);
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        result = pipe2(outputs[i].duplicate, O_CLOEXEC);
+        if (result == 0)
+        {
+            result = fcntl(outputs[i].duplicate[1], F_SETPIPE_SZ, pipe_size);
+            if (result < pipe_size)
+            {
+                close(outputs[i].duplicate[0]);
+                close(outputs[i].duplicate[1]);
+                result = -1;
+            }
+        }
+
+        /* Too many pipes, or too large ones */
+
+        if (result < 0)
+        {
+            for (size_t j = 0; j < i; ++j)
+            {
+                close(outputs[j].duplicate[0]);
+                close(outputs[j].duplicate[1]);
+            }
+
+            return 0;
+        }
+    }
+
+    return pipe_size;
+}
+
+void drain_duplicate(TeeOutput* output, size_t length, char** buffer)
 {
-    if (assertion)
+    ssize_t rw_result;
+
+    while (length > 0)
     {
-        if (errno)
+        if (!output->copy)
         {
-            fprintf(stderr, "[%d]: %s\n", errno, strerror(errno));
-            exit(EXIT_FAILURE);
+            rw_result = splice(output->duplicate[0], NULL, output->fd, NULL,
+                               length, SPLICE_F_MOVE);
+            if (rw_result < 0 && errno == EINVAL)
+            {
+                /* Appending files and some devices refuse to splice */
+
+                output->copy = 1;
+                continue;
+            }
+        }
+        else
+        {
+            if (*buffer == NULL)
+            {
+                *buffer = malloc((size_t)VECTOR_COUNT * VECTOR_SIZE);
+                exit_on_error(*buffer == NULL);
+            }
+
+            rw_result = read(output->duplicate[0], *buffer,
+                             length < (size_t)VECTOR_COUNT * VECTOR_SIZE ?
+                                length : (size_t)VECTOR_COUNT * VECTOR_SIZE);
+            if (rw_result > 0)
+            {
+                exit_on_error(write_full(output->fd, *buffer,
+                                         rw_result) < 0);
+            }
         }
 
-        fprintf(stderr, "An error occured!\n");
-        exit(EXIT_FAILURE);
+        if (rw_result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        exit_on_error(rw_result <= 0);
+        length -= rw_result;
     }
 }
 
+void tee_with_splice(TeeOutput* outputs, size_t count, int pipe_size)
+{
+    char*   buffer = NULL;
+    size_t  length;
+    ssize_t rw_result;
+
+    while (1)
+    {
+        /* The first duplicate sets the length of the round */
+
+        length = pipe_size;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            do
+            {
+                if (i + 1 < count)
+                {
+                    rw_result = tee(STDIN_FILENO, outputs[i].duplicate[1],
+                                    length, 0);
+                }
+                else
+                {
+                    rw_result = splice(STDIN_FILENO, NULL,
+                                       outputs[i].duplicate[1], NULL,
+                                       length, SPLICE_F_MOVE);
+                }
+            }
+            while (rw_result < 0 && errno == EINTR);
+
+            exit_on_error(rw_result < 0);
+
+            if (i == 0)
+            {
+                if (rw_result == 0)
+                {
+                    free(buffer);
+                    return;
+                }
+
+                length = rw_result;
+            }
+            else
+            {
+                /* An empty duplicate pipe holds a whole round */
+
+                errno = 0;
+                exit_on_error((size_t)rw_result != length);
+            }
+        }
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            drain_duplicate(&outputs[i], length, &buffer);
+        }
+    }
+}
+
+void tee_with_vectors(TeeOutput* outputs, size_t count)
+{
+    struct iovec    vectors[VECTOR_COUNT];
+    struct iovec    pending[VECTOR_COUNT];
+    char*           buffer;
+    int             pending_count;
+    ssize_t         remaining;
+    ssize_t         rw_result;
+
+    buffer = malloc((size_t)VECTOR_COUNT * VECTOR_SIZE);
+    exit_on_error(buffer == NULL);
+
+    while (1)
+    {
+        /* Fill the buffers from the standard input */
+
+        for (int i = 0; i < VECTOR_COUNT; ++i)
+        {
+            vectors[i].iov_base = buffer + (size_t)i * VECTOR_SIZE;
+            vectors[i].iov_len = VECTOR_SIZE;
+        }
+
+        rw_result = readv(STDIN_FILENO, vectors, VECTOR_COUNT);
+        if (rw_result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        exit_on_error(rw_result < 0);
+
+        if (rw_result == 0)
+        {
+            break;
+        }
+
+        /* Keep only the filled part of the buffers */
+
+        remaining = rw_result;
+
+        for (pending_count = 0; remaining > 0; ++pending_count)
+        {
+            if ((size_t)remaining < vectors[pending_count].iov_len)
+            {
+                vectors[pending_count].iov_len = remaining;
+            }
+
+            remaining -= vectors[pending_count].iov_len;
+        }
+
+        /* Write them on each output */
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            memcpy(pending, vectors, pending_count * sizeof(struct iovec));
+            rw_result = writev_full(outputs[i].fd, pending, pending_count);
+            exit_on_error(rw_result < 0);
+        }
+    }
+
+    free(buffer);
+}